@@ -40,7 +40,6 @@ const uint8_t kFactoryReset[] = {0x80, 0x0e, 0x00, 0x00};
 const uint8_t kLockReset[] = {0x80, 0x0e, 0x01, 0x00};
 const uint8_t kLoadMetaClear[] = {0x80, 0x10, 0x00, 0x00};
 const uint8_t kLoadMetaAppend[] = {0x80, 0x10, 0x01, 0x00};
-static const uint16_t kMaxMetadataLoadSize = 1024;
 
 EseAppResult check_apdu_status(uint8_t code[2]) {
   if (code[0] == 0x90 && code[1] == 0x00) {
@@ -282,87 +281,96 @@ ESE_API EseAppResult ese_boot_lock_get(struct EseBootSession *session,
   return ESE_APP_RESULT_FALSE;
 }
 
-EseAppResult ese_boot_meta_clear(struct EseBootSession *session) {
-  struct EseSgBuffer tx[2];
-  struct EseSgBuffer rx[1];
-  int rx_len;
-  if (!session || !session->ese || !session->active) {
-    return ESE_APP_RESULT_ERROR_ARGUMENTS;
-  }
-
-  uint8_t chan = kLoadMetaClear[0] | session->channel_id;
-  tx[0].base = &chan;
-  tx[0].len = 1;
-  tx[1].base = (uint8_t *)&kLoadMetaClear[1];
-  tx[1].len = sizeof(kLoadMetaClear) - 1;
-
-  uint8_t reply[4]; // App reply or APDU error.
-  rx[0].base = &reply[0];
-  rx[0].len = sizeof(reply);
+/* Metadata is uploaded in chunks of up to META_CHUNK_SIZE bytes, so at most
+ * META_CHUNKS_MAX appends carry kEseBootOwnerKeyMax bytes.
+ */
+#define META_CHUNK_SIZE 512
+#define META_CHUNKS_MAX 4
+/* CLA INS P1 P2 and an extended Lc. */
+#define META_APPEND_HEADER_SIZE 7
+
+static void ese_boot_meta_entry(struct EseBatchEntry *entry,
+                                const uint8_t *apdu, uint32_t apdu_len,
+                                uint8_t *reply, uint32_t reply_len) {
+  entry->tx_buf = apdu;
+  entry->tx_len = apdu_len;
+  entry->rx_buf = reply;
+  entry->rx_max = reply_len;
+  entry->policy = kEseBatchStopUnlessOk;
+}
 
-  rx_len = ese_transceive_sg(session->ese, tx, 2, rx, 1);
-  if (rx_len < 2 || ese_error(session->ese)) {
-    ALOGE("ese_boot_meta_clear: communication failure");
+/* Checks the reply to a metadata clear or append. */
+static EseAppResult ese_boot_meta_result(const struct EseBatchEntry *entry) {
+  const uint8_t *reply = entry->rx_buf;
+  if (entry->rx_len < 2) {
+    ALOGE("ese_boot_meta: communication failure");
     return ESE_APP_RESULT_ERROR_COMM_FAILED;
   }
   // Expect the full payload plus the applet status and the completion code.
-  if (rx_len < 4) {
-    ALOGE("ese_boot_meta_clear: SE exception");
-    EseAppResult ret = check_apdu_status(&reply[rx_len - 2]);
-    return ret;
+  if (entry->rx_len < 4) {
+    ALOGE("ese_boot_meta: SE exception");
+    return check_apdu_status((uint8_t *)&reply[entry->rx_len - 2]);
   }
   if (reply[0] != 0x0 || reply[1] != 0x0) {
-    ALOGE("ese_boot_meta_clear: received applet error code %.2x %.2x", reply[0],
+    ALOGE("ese_boot_meta: received applet error code %.2x %.2x", reply[0],
           reply[1]);
     return ese_make_app_result(reply[0], reply[1]);
   }
   return ESE_APP_RESULT_OK;
 }
 
-EseAppResult ese_boot_meta_append(struct EseBootSession *session,
-                                  const uint8_t *data, uint16_t dataLen) {
-  struct EseSgBuffer tx[4];
-  struct EseSgBuffer rx[1];
-  int rx_len;
-  if (!session || !session->ese || !session->active) {
-    return ESE_APP_RESULT_ERROR_ARGUMENTS;
-  }
-  if (dataLen > kMaxMetadataLoadSize) {
-    ALOGE("ese_boot_meta_append: too much data provided");
-    return ESE_APP_RESULT_ERROR_ARGUMENTS;
-  }
-
-  uint8_t chan = kLoadMetaAppend[0] | session->channel_id;
-  tx[0].base = &chan;
-  tx[0].len = 1;
-  tx[1].base = (uint8_t *)&kLoadMetaAppend[1];
-  tx[1].len = sizeof(kLoadMetaAppend) - 1;
-
-  uint8_t apdu_len[] = {0x0, (dataLen >> 8), (dataLen & 0xff)};
-  tx[2].base = &apdu_len[0];
-  tx[2].len = sizeof(apdu_len);
-  tx[3].c_base = data;
-  tx[3].len = dataLen;
-
-  uint8_t reply[4]; // App reply or APDU error.
-  rx[0].base = &reply[0];
-  rx[0].len = sizeof(reply);
-
-  rx_len = ese_transceive_sg(session->ese, tx, 4, rx, 1);
-  if (rx_len < 2 || ese_error(session->ese)) {
-    ALOGE("ese_boot_meta_append: communication failure");
+/* Replaces the applet's scratch metadata with |dataLen| bytes of |data|. */
+static EseAppResult ese_boot_meta_load(struct EseBootSession *session,
+                                       const uint8_t *data, uint16_t dataLen) {
+  uint8_t clear[sizeof(kLoadMetaClear)];
+  uint8_t appends[META_CHUNKS_MAX][META_APPEND_HEADER_SIZE + META_CHUNK_SIZE];
+  uint8_t replies[1 + META_CHUNKS_MAX][4]; // App reply or APDU error.
+  struct EseBatchEntry batch[1 + META_CHUNKS_MAX];
+  uint32_t count = 0;
+  int run;
+  int i;
+
+  ese_memcpy(clear, kLoadMetaClear, sizeof(clear));
+  clear[0] |= session->channel_id;
+  ese_boot_meta_entry(&batch[count], clear, sizeof(clear), replies[count],
+                      sizeof(replies[count]));
+  count++;
+  while (dataLen > 0) {
+    const uint16_t chunk = (META_CHUNK_SIZE < dataLen) ? META_CHUNK_SIZE : dataLen;
+    uint8_t *apdu;
+    if (count > META_CHUNKS_MAX) {
+      ALOGE("ese_boot_meta_load: too much data provided");
+      return ESE_APP_RESULT_ERROR_ARGUMENTS;
+    }
+    apdu = appends[count - 1];
+    ese_memcpy(apdu, kLoadMetaAppend, sizeof(kLoadMetaAppend));
+    apdu[0] |= session->channel_id;
+    apdu[4] = 0x0;
+    apdu[5] = chunk >> 8;
+    apdu[6] = chunk & 0xff;
+    ese_memcpy(&apdu[META_APPEND_HEADER_SIZE], data, chunk);
+    ese_boot_meta_entry(&batch[count], apdu, META_APPEND_HEADER_SIZE + chunk,
+                        replies[count], sizeof(replies[count]));
+    count++;
+    data += chunk;
+    dataLen -= chunk;
+  }
+
+  // The clear and the appends only depend on each other succeeding, so they
+  // go out back to back in one batch.
+  run = ese_transceive_batch(session->ese, batch, count);
+  if (run < 0 || ese_error(session->ese)) {
+    ALOGE("ese_boot_meta_load: communication failure");
     return ESE_APP_RESULT_ERROR_COMM_FAILED;
   }
-  // Expect the full payload plus the applet status and the completion code.
-  if (rx_len < 4) {
-    ALOGE("ese_boot_meta_append: SE exception");
-    EseAppResult ret = check_apdu_status(&reply[rx_len - 2]);
-    return ret;
+  for (i = 0; i < run; ++i) {
+    const EseAppResult res = ese_boot_meta_result(&batch[i]);
+    if (res != ESE_APP_RESULT_OK) {
+      return res;
+    }
   }
-  if (reply[0] != 0x0 || reply[1] != 0x0) {
-    ALOGE("ese_boot_meta_append: received applet error code %.2x %.2x",
-          reply[0], reply[1]);
-    return ese_make_app_result(reply[0], reply[1]);
+  if ((uint32_t)run != count) {
+    return ESE_APP_RESULT_ERROR_COMM_FAILED;
   }
   return ESE_APP_RESULT_OK;
 }
@@ -388,25 +396,12 @@ ESE_API EseAppResult ese_boot_lock_xset(struct EseBootSession *session,
 
   // Locks with metadata require a multi-step upload to meet the
   // constraints of the transport.
-  EseAppResult res = ese_boot_meta_clear(session);
+  // The first byte is the lock value itself, so we skip it.
+  EseAppResult res = ese_boot_meta_load(session, &lockData[1], dataLen - 1);
   if (res != ESE_APP_RESULT_OK) {
-    ALOGE("ese_boot_lock_xset: unable to clear scratch metadata");
+    ALOGE("ese_boot_lock_xset: unable to upload metadata");
     return res;
   }
-  // The first byte is the lock value itself, so we skip it.
-  const uint8_t *cursor = &lockData[1];
-  uint16_t remaining = dataLen - 1;
-  while (remaining > 0) {
-    uint16_t chunk = (512 < remaining) ? 512 : remaining;
-    res = ese_boot_meta_append(session, cursor, chunk);
-    ALOGI("ese_boot_lock_xset: sending chunk %x", remaining);
-    if (res != ESE_APP_RESULT_OK) {
-      ALOGE("ese_boot_lock_xset: unable to upload metadata");
-      return res;
-    }
-    remaining -= chunk;
-    cursor += chunk;
-  }
 
   uint8_t chan = kSetLockState[0] | session->channel_id;
   tx[0].base = &chan;
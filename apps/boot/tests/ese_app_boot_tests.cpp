@@ -160,3 +160,70 @@ TEST_F(BootAppTest, EseBootSessionOpenSelectFailure) {
   trans_.invocations[1].rx[1] = 0x01;
   EXPECT_EQ(ESE_APP_RESULT_ERROR_OS, ese_boot_session_open(&ese_, &session));
 };
+
+class BootAppLockXsetTest : public BootAppTest {
+ public:
+  void SetUp() {
+    BootAppTest::SetUp();
+    EXPECT_EQ(0, ese_open(&ese_, NULL));
+    session_.ese = &ese_;
+    session_.active = true;
+    session_.channel_id = 0x01;
+  }
+
+  void Expect(const std::vector<uint8_t> &tx, const std::vector<uint8_t> &rx) {
+    FakeTransceive::Invocation invocation;
+    invocation.expected_tx = tx;
+    invocation.rx = rx;
+    trans_.invocations.push_back(invocation);
+  }
+
+  // Expects a metadata append of |len| bytes starting at |data|.
+  void ExpectAppend(const uint8_t *data, uint16_t len,
+                    const std::vector<uint8_t> &rx) {
+    std::vector<uint8_t> tx = {0x81, 0x10, 0x01, 0x00, 0x00,
+                               static_cast<uint8_t>(len >> 8),
+                               static_cast<uint8_t>(len & 0xff)};
+    tx.insert(tx.end(), data, data + len);
+    Expect(tx, rx);
+  }
+
+ protected:
+  struct EseBootSession session_;
+};
+
+TEST_F(BootAppLockXsetTest, UploadsMetadataThenSets) {
+  std::vector<uint8_t> lock(1 + 600);
+  for (size_t i = 0; i < lock.size(); ++i) {
+    lock[i] = static_cast<uint8_t>(i);
+  }
+  const std::vector<uint8_t> ok = {0x00, 0x00, 0x90, 0x00};
+  Expect({0x81, 0x10, 0x00, 0x00}, ok);
+  ExpectAppend(&lock[1], 512, ok);
+  ExpectAppend(&lock[513], 88, ok);
+  Expect({0x81, 0x08, kEseBootLockIdOwner, lock[0], 0x01, 0x01}, ok);
+  EXPECT_EQ(ESE_APP_RESULT_OK,
+            ese_boot_lock_xset(&session_, kEseBootLockIdOwner, lock.data(),
+                               static_cast<uint16_t>(lock.size())));
+  EXPECT_EQ(0UL, trans_.invocations.size());
+}
+
+TEST_F(BootAppLockXsetTest, StopsAtAFailedUpload) {
+  const uint8_t lock[] = {0x01, 0xaa, 0xbb};
+  const std::vector<uint8_t> ok = {0x00, 0x00, 0x90, 0x00};
+  // The clear is rejected by the OS, so neither the append nor the set is
+  // sent.
+  Expect({0x81, 0x10, 0x00, 0x00}, {0x6a, 0x83});
+  EXPECT_EQ(ESE_APP_RESULT_ERROR_UNCONFIGURED,
+            ese_boot_lock_xset(&session_, kEseBootLockIdOwner, lock,
+                               sizeof(lock)));
+  EXPECT_EQ(0UL, trans_.invocations.size());
+
+  // An applet error does not stop the upload, but the lock is not set.
+  Expect({0x81, 0x10, 0x00, 0x00}, ok);
+  ExpectAppend(&lock[1], 2, {0x00, 0x05, 0x90, 0x00});
+  EXPECT_EQ(static_cast<EseAppResult>(ese_make_app_result(0x00, 0x05)),
+            ese_boot_lock_xset(&session_, kEseBootLockIdOwner, lock,
+                               sizeof(lock)));
+  EXPECT_EQ(0UL, trans_.invocations.size());
+}
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <weaver/WeaverEmulator.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace android {
+
+namespace {
+
+// Keep in sync with apps/weaver/card and weaver.c.
+const uint8_t kAppletAid[] = {0xA0, 0x00, 0x00, 0x04, 0x76, 0x57, 0x56,
+                              0x52, 0x43, 0x4F, 0x4D, 0x4D, 0x30};
+
+constexpr uint8_t kInsManageChannel = 0x70;
+constexpr uint8_t kInsSelect = 0xA4;
+constexpr uint8_t kInsGetNumSlots = 0x02;
+constexpr uint8_t kInsWrite = 0x04;
+constexpr uint8_t kInsRead = 0x06;
+constexpr uint8_t kInsEraseValue = 0x08;
+constexpr uint8_t kInsEraseAll = 0x0a;
+
+constexpr uint8_t kReadSuccess = 0x00;
+constexpr uint8_t kReadWrongKey = 0x7f;
+constexpr uint8_t kReadBackOff = 0x76;
+
+constexpr uint16_t kSwOk = 0x9000;
+constexpr uint16_t kSwWrongLength = 0x6700;
+constexpr uint16_t kSwChannelNotSupported = 0x6881;
+constexpr uint16_t kSwFunctionNotSupported = 0x6A81;
+constexpr uint16_t kSwFileNotFound = 0x6A82;
+constexpr uint16_t kSwIncorrectP1P2 = 0x6A86;
+constexpr uint16_t kSwInvalidSlotId = 0x6A86;
+constexpr uint16_t kSwInsNotSupported = 0x6D00;
+constexpr uint16_t kSwClaNotSupported = 0x6E00;
+
+constexpr size_t kSlotIdSize = 4;
+constexpr uint16_t kMaxFailures = 0x7fff;
+
+uint32_t status(uint8_t* rsp, uint32_t len, uint16_t sw) {
+    rsp[len] = static_cast<uint8_t>(sw >> 8);
+    rsp[len + 1] = static_cast<uint8_t>(sw);
+    return len + 2;
+}
+
+void putUint32(uint8_t* buf, uint32_t val) {
+    buf[0] = static_cast<uint8_t>(val >> 24);
+    buf[1] = static_cast<uint8_t>(val >> 16);
+    buf[2] = static_cast<uint8_t>(val >> 8);
+    buf[3] = static_cast<uint8_t>(val);
+}
+
+// Seconds a slot is throttled for after |failures| wrong keys in a row, as
+// CoreSlots.throttle() works it out.
+uint32_t throttle(uint16_t failures) {
+    if (failures == 0) {
+        return 0;
+    }
+    if (failures <= 10) {
+        return failures % 5 == 0 ? 30 : 0;
+    }
+    if (failures < 30) {
+        return 30;
+    }
+    if (failures < 140) {
+        return 30u << ((failures - 30) / 10);
+    }
+    return 24 * 60 * 60;
+}
+
+}  // namespace
+
+// A short APDU split into its fields.
+struct WeaverEmulator::Command {
+    uint8_t cla;
+    uint8_t ins;
+    uint8_t p1;
+    uint8_t p2;
+    const uint8_t* data;
+    uint32_t lc;
+    // 0 when absent, 256 for an Le byte of 00.
+    uint32_t le;
+
+    bool parse(const uint8_t* cmd, uint32_t len) {
+        if (len < 4) {
+            return false;
+        }
+        cla = cmd[0];
+        ins = cmd[1];
+        p1 = cmd[2];
+        p2 = cmd[3];
+        data = nullptr;
+        lc = 0;
+        le = 0;
+        if (len == 4) {
+            return true;
+        }
+        if (len == 5) {
+            le = cmd[4] ? cmd[4] : 256;
+            return true;
+        }
+        lc = cmd[4];
+        data = &cmd[5];
+        if (lc == 0) {
+            return false;
+        }
+        if (len == 6 + lc) {
+            le = cmd[5 + lc] ? cmd[5 + lc] : 256;
+        } else if (len != 5 + lc) {
+            return false;
+        }
+        return true;
+    }
+};
+
+WeaverEmulator::WeaverEmulator() : WeaverEmulator(Config()) {}
+
+WeaverEmulator::WeaverEmulator(const Config& config)
+        : mConfig(config),
+          mSlots(config.numSlots),
+          mChannels(std::min<size_t>(std::max<uint8_t>(config.channels, 1), 20)) {
+    mChannels[0].open = true;
+}
+
+void WeaverEmulator::attach(EseSimConfig& sim) {
+    sim.handler = &WeaverEmulator::handle;
+    sim.handler_ctx = this;
+}
+
+uint32_t WeaverEmulator::handle(void* ctx, const uint8_t* cmd, uint32_t cmdLen, uint8_t* rsp,
+                                uint32_t rspMax) {
+    return static_cast<WeaverEmulator*>(ctx)->process(cmd, cmdLen, rsp, rspMax);
+}
+
+void WeaverEmulator::advance(std::chrono::seconds time) {
+    mSkew += time;
+}
+
+uint32_t WeaverEmulator::process(const uint8_t* cmd, uint32_t cmdLen, uint8_t* rsp,
+                                 uint32_t rspMax) {
+    ++mStats.apdus;
+    // The longest answer is a successful READ.
+    if (rspMax < 1 + kValueSize + 2) {
+        return 0;
+    }
+    Command command;
+    if (!command.parse(cmd, cmdLen)) {
+        return status(rsp, 0, kSwWrongLength);
+    }
+    // First interindustry classes carry channels 0-3 and further ones 4-19.
+    const uint8_t channel = (command.cla & 0x40) ? 4 + (command.cla & 0x0f) : command.cla & 0x03;
+    if (channel >= mChannels.size() || !mChannels[channel].open) {
+        return status(rsp, 0, kSwChannelNotSupported);
+    }
+    if (!(command.cla & 0x80)) {
+        switch (command.ins) {
+        case kInsManageChannel:
+            return manageChannel(command, channel, rsp);
+        case kInsSelect:
+            return select(command, mChannels[channel], rsp);
+        default:
+            return status(rsp, 0, kSwInsNotSupported);
+        }
+    }
+    if (!mChannels[channel].selected) {
+        return status(rsp, 0, kSwClaNotSupported);
+    }
+    return applet(command, rsp);
+}
+
+uint32_t WeaverEmulator::manageChannel(const Command& command, uint8_t channel, uint8_t* rsp) {
+    if (command.p1 == 0x00) {
+        // Open the lowest free channel.
+        for (size_t i = 1; i < mChannels.size(); ++i) {
+            if (!mChannels[i].open) {
+                mChannels[i] = Channel{true, false};
+                rsp[0] = static_cast<uint8_t>(i);
+                return status(rsp, 1, kSwOk);
+            }
+        }
+        return status(rsp, 0, kSwFunctionNotSupported);
+    }
+    if (command.p1 == 0x80) {
+        const uint8_t target = command.p2 ? command.p2 : channel;
+        if (target == 0 || target >= mChannels.size() || !mChannels[target].open) {
+            return status(rsp, 0, kSwIncorrectP1P2);
+        }
+        mChannels[target] = Channel{};
+        return status(rsp, 0, kSwOk);
+    }
+    return status(rsp, 0, kSwIncorrectP1P2);
+}
+
+uint32_t WeaverEmulator::select(const Command& command, Channel& channel, uint8_t* rsp) {
+    if (command.p1 != 0x04) {
+        return status(rsp, 0, kSwIncorrectP1P2);
+    }
+    // Partial selection by a leading part of the AID is allowed.
+    if (command.lc < 5 || command.lc > sizeof(kAppletAid) ||
+        memcmp(command.data, kAppletAid, command.lc) != 0) {
+        return status(rsp, 0, kSwFileNotFound);
+    }
+    channel.selected = true;
+    return status(rsp, 0, kSwOk);
+}
+
+uint32_t WeaverEmulator::applet(const Command& command, uint8_t* rsp) {
+    if (command.p1 != 0 || command.p2 != 0) {
+        return status(rsp, 0, kSwIncorrectP1P2);
+    }
+    switch (command.ins) {
+    case kInsGetNumSlots:
+        return getNumSlots(command, rsp);
+    case kInsWrite:
+        return write(command, rsp);
+    case kInsRead:
+        return read(command, rsp);
+    case kInsEraseValue:
+        return eraseValue(command, rsp);
+    case kInsEraseAll:
+        return eraseAll(command, rsp);
+    default:
+        return status(rsp, 0, kSwInsNotSupported);
+    }
+}
+
+uint32_t WeaverEmulator::getNumSlots(const Command& command, uint8_t* rsp) {
+    if (command.le != 4) {
+        return status(rsp, 0, kSwWrongLength);
+    }
+    putUint32(rsp, mConfig.numSlots);
+    return status(rsp, 4, kSwOk);
+}
+
+uint32_t WeaverEmulator::write(const Command& command, uint8_t* rsp) {
+    if (command.lc != kSlotIdSize + kKeySize + kValueSize) {
+        return status(rsp, 0, kSwWrongLength);
+    }
+    Slot* s = slot(command.data);
+    if (s == nullptr) {
+        return status(rsp, 0, kSwInvalidSlotId);
+    }
+    ++mStats.writes;
+    const uint8_t* key = command.data + kSlotIdSize;
+    std::copy(key, key + kKeySize, s->key.begin());
+    std::copy(key + kKeySize, key + kKeySize + kValueSize, s->value.begin());
+    s->failures = 0;
+    s->backOffEnd = {};
+    nvmWrite();
+    return status(rsp, 0, kSwOk);
+}
+
+uint32_t WeaverEmulator::read(const Command& command, uint8_t* rsp) {
+    if (command.lc != kSlotIdSize + kKeySize || command.le != 1 + kValueSize) {
+        return status(rsp, 0, kSwWrongLength);
+    }
+    Slot* s = slot(command.data);
+    if (s == nullptr) {
+        return status(rsp, 0, kSwInvalidSlotId);
+    }
+    ++mStats.reads;
+    const auto time = now();
+    if (time < s->backOffEnd) {
+        // Round up so a caller waiting the time out is never early.
+        const auto remaining =
+                std::chrono::duration_cast<std::chrono::microseconds>(s->backOffEnd - time);
+        ++mStats.backOffs;
+        rsp[0] = kReadBackOff;
+        putUint32(&rsp[1], static_cast<uint32_t>((remaining.count() + 999999) / 1000000));
+        return status(rsp, 5, kSwOk);
+    }
+
+    const uint8_t* key = command.data + kSlotIdSize;
+    const bool match = std::equal(s->key.begin(), s->key.end(), key);
+    const uint16_t failures = match ? 0 : std::min<uint16_t>(s->failures + 1, kMaxFailures);
+    const uint32_t wait = throttle(failures);
+    if (failures != s->failures || wait != 0) {
+        s->failures = failures;
+        s->backOffEnd = wait ? time + std::chrono::seconds(wait)
+                             : std::chrono::steady_clock::time_point{};
+        nvmWrite();
+    }
+    if (!match) {
+        ++mStats.wrongKeys;
+        rsp[0] = kReadWrongKey;
+        putUint32(&rsp[1], wait);
+        return status(rsp, 5, kSwOk);
+    }
+    rsp[0] = kReadSuccess;
+    std::copy(s->value.begin(), s->value.end(), &rsp[1]);
+    return status(rsp, 1 + kValueSize, kSwOk);
+}
+
+uint32_t WeaverEmulator::eraseValue(const Command& command, uint8_t* rsp) {
+    if (command.lc != kSlotIdSize) {
+        return status(rsp, 0, kSwWrongLength);
+    }
+    Slot* s = slot(command.data);
+    if (s == nullptr) {
+        return status(rsp, 0, kSwInvalidSlotId);
+    }
+    s->value.fill(0);
+    nvmWrite();
+    return status(rsp, 0, kSwOk);
+}
+
+uint32_t WeaverEmulator::eraseAll(const Command& command, uint8_t* rsp) {
+    if (command.lc != 0) {
+        return status(rsp, 0, kSwWrongLength);
+    }
+    std::fill(mSlots.begin(), mSlots.end(), Slot{});
+    nvmWrite();
+    return status(rsp, 0, kSwOk);
+}
+
+WeaverEmulator::Slot* WeaverEmulator::slot(const uint8_t* id) {
+    // The API takes 32-bit IDs but the applet only has 16-bit ones.
+    if (id[0] != 0 || id[1] != 0) {
+        return nullptr;
+    }
+    const size_t index = (id[2] << 8) | id[3];
+    return index < mSlots.size() ? &mSlots[index] : nullptr;
+}
+
+void WeaverEmulator::nvmWrite() {
+    ++mStats.nvmWrites;
+    if (mConfig.nvmWriteLatency.count() > 0) {
+        std::this_thread::sleep_for(mConfig.nvmWriteLatency);
+    }
+}
+
+std::chrono::steady_clock::time_point WeaverEmulator::now() const {
+    return std::chrono::steady_clock::now() + mSkew;
+}
+
+}  // namespace android
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ESE_APP_WEAVER_EMULATOR_H_
+#define ESE_APP_WEAVER_EMULATOR_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <ese/hw/sim/sim.h>
+
+namespace android {
+
+/**
+ * Answers Weaver APDUs the way the applet in apps/weaver/card does, so the
+ * host side can be load-tested without a secure element. Attach it to a
+ * libese-hw-sim card, which passes it every command APDU.
+ *
+ * Besides the applet's GET NUM SLOTS, WRITE, READ, ERASE VALUE and ERASE ALL
+ * it plays the card's part in MANAGE CHANNEL and SELECT. Slots live in memory
+ * and are lost with the emulator. Reads with the wrong key are throttled on
+ * the applet's schedule, against the steady clock plus any time added with
+ * advance().
+ *
+ * Not thread safe: the simulated card calls it on whichever thread is
+ * transceiving, and libese callers already serialize those.
+ */
+class WeaverEmulator {
+public:
+    struct Config {
+        uint16_t numSlots = 64;
+        /** Logical channels, the basic channel included. At most 20. */
+        uint8_t channels = 4;
+        /** Time each update of a slot takes to commit, as NVM does on a card. */
+        std::chrono::microseconds nvmWriteLatency{0};
+    };
+
+    struct Stats {
+        uint32_t apdus = 0;
+        uint32_t reads = 0;
+        uint32_t writes = 0;
+        uint32_t wrongKeys = 0;
+        uint32_t backOffs = 0;
+        uint32_t nvmWrites = 0;
+    };
+
+    WeaverEmulator();
+    explicit WeaverEmulator(const Config& config);
+
+    WeaverEmulator(const WeaverEmulator&) = delete;
+    WeaverEmulator& operator=(const WeaverEmulator&) = delete;
+
+    /** Makes a card opened with |sim| pass its command APDUs to this emulator. */
+    void attach(EseSimConfig& sim);
+
+    /** Answers one command APDU; see EseSimApduHandler. */
+    uint32_t process(const uint8_t* cmd, uint32_t cmdLen, uint8_t* rsp, uint32_t rspMax);
+
+    /** Moves the backoff timers on by |time| without waiting for it. */
+    void advance(std::chrono::seconds time);
+
+    const Stats& stats() const { return mStats; }
+
+private:
+    static constexpr size_t kKeySize = 16;
+    static constexpr size_t kValueSize = 16;
+
+    struct Slot {
+        std::array<uint8_t, kKeySize> key{};
+        std::array<uint8_t, kValueSize> value{};
+        uint16_t failures = 0;
+        std::chrono::steady_clock::time_point backOffEnd;
+    };
+
+    struct Channel {
+        bool open = false;
+        bool selected = false;
+    };
+
+    struct Command;
+
+    static uint32_t handle(void* ctx, const uint8_t* cmd, uint32_t cmdLen, uint8_t* rsp,
+                           uint32_t rspMax);
+
+    uint32_t manageChannel(const Command& command, uint8_t channel, uint8_t* rsp);
+    uint32_t select(const Command& command, Channel& channel, uint8_t* rsp);
+    uint32_t applet(const Command& command, uint8_t* rsp);
+    uint32_t getNumSlots(const Command& command, uint8_t* rsp);
+    uint32_t write(const Command& command, uint8_t* rsp);
+    uint32_t read(const Command& command, uint8_t* rsp);
+    uint32_t eraseValue(const Command& command, uint8_t* rsp);
+    uint32_t eraseAll(const Command& command, uint8_t* rsp);
+
+    Slot* slot(const uint8_t* id);
+    void nvmWrite();
+    std::chrono::steady_clock::time_point now() const;
+
+    const Config mConfig;
+    std::vector<Slot> mSlots;
+    std::vector<Channel> mChannels;
+    std::chrono::seconds mSkew{0};
+    Stats mStats;
+};
+
+}  // namespace android
+
+#endif  // ESE_APP_WEAVER_EMULATOR_H_
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Weaver client operations per second against the emulated applet.
+ *
+ * range(0) selects the card: 0 answers instantly, measuring the host stack
+ * alone, and 1 puts it on a 1 MHz SPI bus with 1 ms to process each APDU and
+ * 5 ms for each NVM write.
+ */
+
+#include <chrono>
+
+#include <benchmark/benchmark.h>
+
+#include <ese/app/weaver.h>
+#include <esecpp/EseSim.h>
+#include <weaver/WeaverEmulator.h>
+
+using android::EseSim;
+using android::WeaverEmulator;
+
+namespace {
+
+const uint8_t kKey[kEseWeaverKeySize] = {1, 2, 3, 4, 5, 6, 7, 8,
+                                         9, 10, 11, 12, 13, 14, 15, 16};
+const uint8_t kValue[kEseWeaverValueSize] = {0x55};
+
+WeaverEmulator::Config CardConfig(int64_t timed) {
+  WeaverEmulator::Config config;
+  if (timed) {
+    config.nvmWriteLatency = std::chrono::milliseconds(5);
+  }
+  return config;
+}
+
+class Rig {
+ public:
+  explicit Rig(benchmark::State &state) : state_(state), card_(CardConfig(state.range(0))) {
+    card_.attach(ese_.config());
+    if (state.range(0)) {
+      ese_.config().byte_time_ns = 8000;
+      ese_.config().think_time_us = 1000;
+    }
+    ese_.init();
+    ese_weaver_session_init(&session_);
+    if (ese_.open() < 0) {
+      state.SkipWithError("unable to open the simulated card");
+    }
+  }
+  ~Rig() {
+    if (session_.active) {
+      ese_weaver_session_close(&session_);
+    }
+    ese_.close();
+  }
+
+  bool OpenSession() {
+    if (ese_weaver_session_open(ese_.ese_interface(), &session_) !=
+        ESE_APP_RESULT_OK) {
+      state_.SkipWithError("unable to open a Weaver session");
+      return false;
+    }
+    return true;
+  }
+
+  bool CloseSession() {
+    return ese_weaver_session_close(&session_) == ESE_APP_RESULT_OK;
+  }
+
+  bool Read() {
+    uint8_t value[kEseWeaverValueSize];
+    uint32_t timeout;
+    return ese_weaver_read(&session_, 0, kKey, value, &timeout) ==
+           ESE_APP_RESULT_OK;
+  }
+
+  bool Write() {
+    return ese_weaver_write(&session_, 0, kKey, kValue) == ESE_APP_RESULT_OK;
+  }
+
+  void Report() {
+    state_.SetItemsProcessed(state_.iterations());
+    state_.counters["apdus_per_op"] =
+        static_cast<double>(card_.stats().apdus) / state_.iterations();
+  }
+
+ private:
+  benchmark::State &state_;
+  WeaverEmulator card_;
+  EseSim ese_;
+  EseWeaverSession session_;
+};
+
+// A read on a session kept open across calls.
+void BM_WeaverRead(benchmark::State &state) {
+  Rig rig(state);
+  if (!rig.OpenSession() || !rig.Write()) {
+    return;
+  }
+  for (auto _ : state) {
+    if (!rig.Read()) {
+      state.SkipWithError("read failed");
+      return;
+    }
+  }
+  rig.Report();
+}
+BENCHMARK(BM_WeaverRead)->Arg(0)->Arg(1)->UseRealTime();
+
+// A read with its own channel: MANAGE CHANNEL, SELECT, READ and close.
+void BM_WeaverOpenReadClose(benchmark::State &state) {
+  Rig rig(state);
+  if (!rig.OpenSession() || !rig.Write() || !rig.CloseSession()) {
+    return;
+  }
+  for (auto _ : state) {
+    if (!rig.OpenSession() || !rig.Read() || !rig.CloseSession()) {
+      state.SkipWithError("read failed");
+      return;
+    }
+  }
+  rig.Report();
+}
+BENCHMARK(BM_WeaverOpenReadClose)->Arg(0)->Arg(1)->UseRealTime();
+
+void BM_WeaverWrite(benchmark::State &state) {
+  Rig rig(state);
+  if (!rig.OpenSession()) {
+    return;
+  }
+  for (auto _ : state) {
+    if (!rig.Write()) {
+      state.SkipWithError("write failed");
+      return;
+    }
+  }
+  rig.Report();
+}
+BENCHMARK(BM_WeaverWrite)->Arg(0)->Arg(1)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Runs the Weaver client library against the emulated applet on a
+ * simulated card.
+ */
+
+#include <string.h>
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include <ese/app/weaver.h>
+#include <esecpp/EseSim.h>
+#include <weaver/WeaverEmulator.h>
+
+using android::EseSim;
+using android::WeaverEmulator;
+
+namespace {
+
+const uint8_t KEY[kEseWeaverKeySize] = {
+  1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+const uint8_t WRONG_KEY[kEseWeaverKeySize] = {0xff};
+const uint8_t VALUE[kEseWeaverValueSize] = {
+  16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+
+struct WeaverEmulatorTest : public ::testing::Test {
+  WeaverEmulator mCard;
+  EseSim mEse;
+  EseWeaverSession mSession;
+
+  virtual void SetUp() override {
+    mCard.attach(mEse.config());
+    mEse.init();
+    ASSERT_EQ(0, mEse.open());
+    ese_weaver_session_init(&mSession);
+    ASSERT_EQ(ESE_APP_RESULT_OK,
+              ese_weaver_session_open(mEse.ese_interface(), &mSession));
+  }
+
+  virtual void TearDown() override {
+    EXPECT_EQ(ESE_APP_RESULT_OK, ese_weaver_session_close(&mSession));
+    mEse.close();
+  }
+
+  int read(uint32_t slotId, const uint8_t *key, uint8_t *value,
+           uint32_t *timeout) {
+    return ese_weaver_read(&mSession, slotId, key, value, timeout);
+  }
+};
+
+}  // namespace
+
+TEST_F(WeaverEmulatorTest, getNumSlots) {
+  uint32_t numSlots;
+  ASSERT_EQ(ESE_APP_RESULT_OK, ese_weaver_get_num_slots(&mSession, &numSlots));
+  EXPECT_EQ(uint32_t{64}, numSlots);
+}
+
+TEST_F(WeaverEmulatorTest, writeAndReadWithCorrectKey) {
+  ASSERT_EQ(ESE_APP_RESULT_OK, ese_weaver_write(&mSession, 3, KEY, VALUE));
+  uint8_t value[kEseWeaverValueSize];
+  uint32_t timeout;
+  ASSERT_EQ(ESE_APP_RESULT_OK, read(3, KEY, value, &timeout));
+  EXPECT_EQ(0, memcmp(VALUE, value, kEseWeaverValueSize));
+  EXPECT_EQ(1u, mCard.stats().nvmWrites);
+}
+
+TEST_F(WeaverEmulatorTest, wrongKeyBacksOffOnTheAppletSchedule) {
+  ASSERT_EQ(ESE_APP_RESULT_OK, ese_weaver_write(&mSession, 7, KEY, VALUE));
+  uint8_t value[kEseWeaverValueSize];
+  uint32_t timeout;
+  // Failures 1-4 cost nothing; the fifth starts a 30 second back off.
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(ESE_WEAVER_READ_WRONG_KEY, read(7, WRONG_KEY, value, &timeout));
+    EXPECT_EQ(0u, timeout);
+  }
+  ASSERT_EQ(ESE_WEAVER_READ_WRONG_KEY, read(7, WRONG_KEY, value, &timeout));
+  EXPECT_EQ(30000u, timeout);
+
+  // Even the right key is refused until the time is up.
+  ASSERT_EQ(ESE_WEAVER_READ_TIMEOUT, read(7, KEY, value, &timeout));
+  EXPECT_EQ(30000u, timeout);
+  mCard.advance(std::chrono::seconds(10));
+  ASSERT_EQ(ESE_WEAVER_READ_TIMEOUT, read(7, KEY, value, &timeout));
+  EXPECT_EQ(20000u, timeout);
+  mCard.advance(std::chrono::seconds(20));
+  ASSERT_EQ(ESE_APP_RESULT_OK, read(7, KEY, value, &timeout));
+  EXPECT_EQ(0, memcmp(VALUE, value, kEseWeaverValueSize));
+  EXPECT_EQ(2u, mCard.stats().backOffs);
+}
+
+TEST_F(WeaverEmulatorTest, writeResetsTheFailureCount) {
+  uint8_t value[kEseWeaverValueSize];
+  uint32_t timeout;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(ESE_WEAVER_READ_WRONG_KEY, read(1, WRONG_KEY, value, &timeout));
+  }
+  ASSERT_EQ(ESE_APP_RESULT_OK, ese_weaver_write(&mSession, 1, KEY, VALUE));
+  ASSERT_EQ(ESE_WEAVER_READ_WRONG_KEY, read(1, WRONG_KEY, value, &timeout));
+  EXPECT_EQ(0u, timeout);
+}
+
+TEST_F(WeaverEmulatorTest, eraseValueKeepsTheKey) {
+  ASSERT_EQ(ESE_APP_RESULT_OK, ese_weaver_write(&mSession, 2, KEY, VALUE));
+  ASSERT_EQ(ESE_APP_RESULT_OK, ese_weaver_erase_value(&mSession, 2));
+  uint8_t value[kEseWeaverValueSize];
+  uint32_t timeout;
+  ASSERT_EQ(ESE_APP_RESULT_OK, read(2, KEY, value, &timeout));
+  const uint8_t zero[kEseWeaverValueSize] = {0};
+  EXPECT_EQ(0, memcmp(zero, value, kEseWeaverValueSize));
+}
+
+TEST_F(WeaverEmulatorTest, invalidSlot) {
+  EXPECT_EQ(ese_make_os_result(0x6a, 0x86),
+            ese_weaver_write(&mSession, 64, KEY, VALUE));
+  EXPECT_EQ(ese_make_os_result(0x6a, 0x86),
+            ese_weaver_write(&mSession, 0x10000, KEY, VALUE));
+}
+
+TEST_F(WeaverEmulatorTest, channelsRunOut) {
+  // The basic channel and the session's leave two of four.
+  EseWeaverSession sessions[3];
+  for (auto &session : sessions) {
+    ese_weaver_session_init(&session);
+  }
+  ASSERT_EQ(ESE_APP_RESULT_OK,
+            ese_weaver_session_open(mEse.ese_interface(), &sessions[0]));
+  ASSERT_EQ(ESE_APP_RESULT_OK,
+            ese_weaver_session_open(mEse.ese_interface(), &sessions[1]));
+  EXPECT_EQ(ese_make_os_result(0x6a, 0x81),
+            ese_weaver_session_open(mEse.ese_interface(), &sessions[2]));
+
+  // A closed channel no longer answers and can be opened again.
+  const uint8_t channel = sessions[0].channel_id;
+  ASSERT_EQ(ESE_APP_RESULT_OK, ese_weaver_session_close(&sessions[0]));
+  sessions[0].active = true;
+  sessions[0].channel_id = channel;
+  uint32_t numSlots;
+  EXPECT_EQ(ese_make_os_result(0x68, 0x81),
+            ese_weaver_get_num_slots(&sessions[0], &numSlots));
+  sessions[0].active = false;
+  ASSERT_EQ(ESE_APP_RESULT_OK,
+            ese_weaver_session_open(mEse.ese_interface(), &sessions[2]));
+  EXPECT_EQ(channel, sessions[2].channel_id);
+  EXPECT_EQ(ESE_APP_RESULT_OK, ese_weaver_session_close(&sessions[1]));
+  EXPECT_EQ(ESE_APP_RESULT_OK, ese_weaver_session_close(&sessions[2]));
+}
+
+TEST(WeaverEmulatorNvmTest, writesTakeTheConfiguredTime) {
+  WeaverEmulator::Config config;
+  config.nvmWriteLatency = std::chrono::milliseconds(5);
+  WeaverEmulator card(config);
+  EseSim ese;
+  card.attach(ese.config());
+  ese.init();
+  ASSERT_EQ(0, ese.open());
+  EseWeaverSession session;
+  ese_weaver_session_init(&session);
+  ASSERT_EQ(ESE_APP_RESULT_OK,
+            ese_weaver_session_open(ese.ese_interface(), &session));
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(ESE_APP_RESULT_OK, ese_weaver_write(&session, 0, KEY, VALUE));
+  EXPECT_LE(std::chrono::milliseconds(5),
+            std::chrono::steady_clock::now() - start);
+  EXPECT_EQ(ESE_APP_RESULT_OK, ese_weaver_session_close(&session));
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ChannelPool.h"
+
+#include <android-base/logging.h>
+
+namespace android {
+namespace esed {
+
+namespace {
+
+// Status words meaning the channel was closed or the applet deselected
+// under us, e.g. after the card reset.
+bool channelLost(EseAppResult res) {
+    if (EseAppResultValue(res) != ESE_APP_RESULT_ERROR_OS) {
+        return false;
+    }
+    switch (EseAppResultAppValue(res)) {
+    case 0x6881: // SW_LOGICAL_CHANNEL_NOT_SUPPORTED
+    case 0x6999: // SW_APPLET_SELECT_FAILED
+    case 0x6D00: // SW_INS_NOT_SUPPORTED
+    case 0x6E00: // SW_CLA_NOT_SUPPORTED
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+ChannelPool::ChannelPool(EseConnection& connection)
+        : mConnection(connection), mEse(connection.ese()) {
+    ese_weaver_session_init(&mWeaver);
+    ese_boot_session_init(&mBoot);
+    mConnection.setCloseHook([this] { closeChannels(); });
+}
+
+ChannelPool::~ChannelPool() {
+    closeAll();
+    mConnection.setCloseHook(nullptr);
+}
+
+void ChannelPool::closeChannels() {
+    if (mWeaver.active && ese_weaver_session_close(&mWeaver) != ESE_APP_RESULT_OK) {
+        LOG(WARNING) << "Failed to close Weaver session";
+    }
+    if (mBoot.active && ese_boot_session_close(&mBoot) != ESE_APP_RESULT_OK) {
+        LOG(WARNING) << "Failed to close boot session";
+    }
+    // The card drops its logical channels when it is powered down anyway.
+    ese_weaver_session_init(&mWeaver);
+    ese_boot_session_init(&mBoot);
+}
+
+void ChannelPool::disconnect() {
+    // The transport is gone so there is no closing the channels politely.
+    ese_weaver_session_init(&mWeaver);
+    ese_boot_session_init(&mBoot);
+    mConnection.close();
+}
+
+template <typename Session>
+EseAppResult ChannelPool::acquire(Session& session,
+                                  EseAppResult (*open)(::EseInterface*, Session*),
+                                  EseAppResult (*close)(Session*), Session** out) {
+    if (!session.active) {
+        const int opened = mConnection.acquire();
+        if (opened < 0) {
+            LOG(ERROR) << "Failed to open eSE connection: " << opened;
+            return ESE_APP_RESULT_ERROR_COMM_FAILED;
+        }
+        const EseAppResult res = open(mEse.ese_interface(), &session);
+        if (res != ESE_APP_RESULT_OK) {
+            if (res == ESE_APP_RESULT_ERROR_COMM_FAILED) {
+                disconnect();
+            } else if (session.channel_id != 0) {
+                // The SELECT failed on a channel which is still open.
+                session.active = true;
+                close(&session);
+            }
+            session.active = false;
+            session.channel_id = 0;
+            return res;
+        }
+    }
+    *out = &session;
+    return ESE_APP_RESULT_OK;
+}
+
+template <typename Session>
+void ChannelPool::check(Session& session, EseAppResult (*close)(Session*), EseAppResult res) {
+    if (res == ESE_APP_RESULT_ERROR_COMM_FAILED) {
+        LOG(WARNING) << "eSE transport failed; dropping all channels";
+        disconnect();
+    } else if (channelLost(res)) {
+        LOG(WARNING) << "eSE channel " << static_cast<int>(session.channel_id) << " lost";
+        close(&session);
+        session.active = false;
+        session.channel_id = 0;
+    }
+}
+
+EseAppResult ChannelPool::weaver(EseWeaverSession** session) {
+    return acquire(mWeaver, ese_weaver_session_open, ese_weaver_session_close, session);
+}
+
+EseAppResult ChannelPool::boot(EseBootSession** session) {
+    return acquire(mBoot, ese_boot_session_open, ese_boot_session_close, session);
+}
+
+void ChannelPool::weaverResult(EseAppResult res) {
+    check(mWeaver, ese_weaver_session_close, res);
+}
+
+void ChannelPool::bootResult(EseAppResult res) {
+    check(mBoot, ese_boot_session_close, res);
+}
+
+void ChannelPool::closeAll() {
+    mConnection.close();
+}
+
+} // namespace esed
+} // namespace android
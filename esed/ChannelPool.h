@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_ESED_CHANNEL_POOL_H
+#define ANDROID_ESED_CHANNEL_POOL_H
+
+#include <esecpp/EseConnection.h>
+#include <esecpp/EseInterface.h>
+#include <ese/app/boot.h>
+#include <ese/app/weaver.h>
+
+namespace android {
+namespace esed {
+
+using ::android::EseConnection;
+using ::android::EseInterface;
+
+/**
+ * Keeps a logical channel per applet open, with the applet selected, for as
+ * long as the connection stays open. Weaver and boot each hold their own
+ * channel so a call only costs its own command APDUs once the channel is warm.
+ *
+ * Callers report the result of each applet command back to the pool. A
+ * transport failure drops the connection and every channel with it; a status
+ * word saying the channel or applet is gone drops just that channel. The
+ * channels are closed whenever the connection is, e.g. when it goes idle.
+ *
+ * Not thread safe: use from the thread which has the eSE to itself.
+ */
+class ChannelPool {
+public:
+    explicit ChannelPool(EseConnection& connection);
+    ~ChannelPool();
+
+    ChannelPool(const ChannelPool&) = delete;
+    ChannelPool& operator=(const ChannelPool&) = delete;
+
+    /**
+     * Points |session| at the pooled channel, opening the eSE and the channel
+     * first if needed. |session| is only valid on ESE_APP_RESULT_OK.
+     */
+    EseAppResult weaver(EseWeaverSession** session);
+    EseAppResult boot(EseBootSession** session);
+
+    /** Reports the result of a command sent on the pooled channel. */
+    void weaverResult(EseAppResult res);
+    void bootResult(EseAppResult res);
+
+    /** Closes every channel, then the connection. */
+    void closeAll();
+
+private:
+    template <typename Session>
+    EseAppResult acquire(Session& session, EseAppResult (*open)(::EseInterface*, Session*),
+                         EseAppResult (*close)(Session*), Session** out);
+    template <typename Session>
+    void check(Session& session, EseAppResult (*close)(Session*), EseAppResult res);
+    void closeChannels();
+    void disconnect();
+
+    EseConnection& mConnection;
+    EseInterface& mEse;
+    EseWeaverSession mWeaver;
+    EseBootSession mBoot;
+};
+
+}  // namespace esed
+}  // namespace android
+
+#endif  // ANDROID_ESED_CHANNEL_POOL_H
@@ -16,11 +16,12 @@
 
 #include "OemLock.h"
 
+#include <tuple>
 #include <vector>
 
 #include <android-base/logging.h>
 #include <ese/app/boot.h>
-#include "ScopedEseConnection.h"
+#include "ChannelPool.h"
 
 namespace android {
 namespace esed {
@@ -28,6 +29,8 @@ namespace esed {
 // libhidl
 using ::android::hardware::Void;
 
+using Priority = ::android::TransceiveArbiter::Priority;
+
 // Methods from ::android::hardware::oemlock::V1_0::IOemLock follow.
 Return<void> OemLock::getName(getName_cb _hidl_cb) {
   _hidl_cb(OemLockStatus::OK, {"01"});
@@ -36,9 +39,14 @@ Return<void> OemLock::getName(getName_cb _hidl_cb) {
 
 Return<OemLockSecureStatus> OemLock::setOemUnlockAllowedByCarrier(
         bool allowed, const hidl_vec<uint8_t>& signature) {
+    return static_cast<OemLockSecureStatus>(mArbiter.run(Priority::NORMAL, [&](EseInterface&) {
+        return static_cast<int>(setOemUnlockAllowedByCarrierOnEse(allowed, signature));
+    }));
+}
+
+OemLockSecureStatus OemLock::setOemUnlockAllowedByCarrierOnEse(
+        bool allowed, const hidl_vec<uint8_t>& signature) {
     LOG(INFO) << "Running OemLock::setOemUnlockAllowedByCarrier: " << allowed;
-    ScopedEseConnection ese{mEse};
-    ese.init();
     // In general, setting the carrier lock to locked is only done in factory,
     // but there is no reason the HAL could not be used in factory to do it.
     // As such, the signature would actually be a specially formatted string of
@@ -52,25 +60,21 @@ Return<OemLockSecureStatus> OemLock::setOemUnlockAllowedByCarrier(
     // xset expects the lock value as the first byte.
     data.insert(data.cbegin(), lock_byte);
 
-   // Open SE session for applet
-    EseBootSession session;
-    ese_boot_session_init(&session);
-    EseAppResult res = ese_boot_session_open(mEse.ese_interface(), &session);
+    // Get the pooled session for the applet
+    EseBootSession* session;
+    EseAppResult res = mChannels.boot(&session);
     if (res != ESE_APP_RESULT_OK) {
         LOG(ERROR) << "Failed to open a boot session: " << res;
         return OemLockSecureStatus::FAILED;
     }
-    res = ese_boot_lock_xset(&session, kEseBootLockIdCarrier,
+    res = ese_boot_lock_xset(session, kEseBootLockIdCarrier,
                              data.data(), data.size());
     if (res != ESE_APP_RESULT_OK) {
         LOG(ERROR) << "Failed to change lock state (allowed="
                    << allowed << "): " << res;
     }
 
-    // Try and close the session without perturbing our result value.
-    if (ese_boot_session_close(&session) != ESE_APP_RESULT_OK) {
-        LOG(WARNING) << "Failed to close boot session";
-    }
+    mChannels.bootResult(res);
 
     if (EseAppResultValue(res) == ESE_APP_RESULT_ERROR_APPLET) {
         // 0004 and 0005 are invalid signature and invalid nonce respectively.
@@ -82,68 +86,70 @@ Return<OemLockSecureStatus> OemLock::setOemUnlockAllowedByCarrier(
 }
 
 Return<void> OemLock::isOemUnlockAllowedByCarrier(isOemUnlockAllowedByCarrier_cb _hidl_cb) {
+    OemLockStatus status = OemLockStatus::FAILED;
+    bool allowed = false;
+    mArbiter.run(Priority::NORMAL, [&](EseInterface&) {
+        std::tie(status, allowed) = isOemUnlockAllowedByCarrierOnEse();
+        return 0;
+    });
+    _hidl_cb(status, allowed);
+    return Void();
+}
+
+std::tuple<OemLockStatus, bool> OemLock::isOemUnlockAllowedByCarrierOnEse() {
     LOG(VERBOSE) << "Running OemLock::isOemUnlockAllowedByCarrier";
-    ScopedEseConnection ese{mEse};
-    ese.init();
-    // Open SE session for applet
-    EseBootSession session;
-    ese_boot_session_init(&session);
-    EseAppResult res = ese_boot_session_open(mEse.ese_interface(), &session);
+    // Get the pooled session for the applet
+    EseBootSession* session;
+    EseAppResult res = mChannels.boot(&session);
     if (res != ESE_APP_RESULT_OK) {
         LOG(ERROR) << "Failed to open a boot session: " << res;
-        _hidl_cb(OemLockStatus::FAILED, false);
-        return Void();
+        return {OemLockStatus::FAILED, false};
     }
     std::vector<uint8_t> data;
     data.resize(1024);
     uint16_t actualData = 0;
-    res = ese_boot_lock_xget(&session, kEseBootLockIdCarrier,
+    res = ese_boot_lock_xget(session, kEseBootLockIdCarrier,
                              &data[0], data.size(),
                              &actualData);
     if (res != ESE_APP_RESULT_OK || actualData == 0) {
         LOG(ERROR) << "Failed to get lock state: " << res;
     }
 
-    // Try and close the session without perturbing our result value.
-    if (ese_boot_session_close(&session) != ESE_APP_RESULT_OK) {
-        LOG(WARNING) << "Failed to close boot session";
-    }
+    mChannels.bootResult(res);
 
     if (res != ESE_APP_RESULT_OK) {
         // Fail closed.
-        _hidl_cb(OemLockStatus::FAILED, false);
-        return Void();
+        return {OemLockStatus::FAILED, false};
     }
     // if data[0] == 1, lock == true, so allowed == false.
-    _hidl_cb(OemLockStatus::OK, data[0] != 0 ? false : true);
-    return Void();
+    return {OemLockStatus::OK, data[0] != 0 ? false : true};
 }
 
 Return<OemLockStatus> OemLock::setOemUnlockAllowedByDevice(bool allowed) {
+    return static_cast<OemLockStatus>(mArbiter.run(Priority::NORMAL, [&](EseInterface&) {
+        return static_cast<int>(setOemUnlockAllowedByDeviceOnEse(allowed));
+    }));
+}
+
+OemLockStatus OemLock::setOemUnlockAllowedByDeviceOnEse(bool allowed) {
     LOG(INFO) << "Running OemLock::setOemUnlockAllowedByDevice: " << allowed;
-    ScopedEseConnection ese{mEse};
-    ese.init();
     // "allowed" == unlocked == 0.
     uint8_t lock_byte = allowed ? 0 : 1;
 
-   // Open SE session for applet
-    EseBootSession session;
-    ese_boot_session_init(&session);
-    EseAppResult res = ese_boot_session_open(mEse.ese_interface(), &session);
+    // Get the pooled session for the applet
+    EseBootSession* session;
+    EseAppResult res = mChannels.boot(&session);
     if (res != ESE_APP_RESULT_OK) {
         LOG(ERROR) << "Failed to open a boot session: " << res;
         return OemLockStatus::FAILED;
     }
-    res = ese_boot_lock_set(&session, kEseBootLockIdDevice, lock_byte);
+    res = ese_boot_lock_set(session, kEseBootLockIdDevice, lock_byte);
     if (res != ESE_APP_RESULT_OK) {
         LOG(ERROR) << "Failed to change device lock state (allowed="
                    << allowed << "): " << res;
     }
 
-    // Try and close the session without perturbing our result value.
-    if (ese_boot_session_close(&session) != ESE_APP_RESULT_OK) {
-        LOG(WARNING) << "Failed to close boot session";
-    }
+    mChannels.bootResult(res);
 
     if (res != ESE_APP_RESULT_OK) {
         return OemLockStatus::FAILED;
@@ -152,37 +158,39 @@ Return<OemLockStatus> OemLock::setOemUnlockAllowedByDevice(bool allowed) {
 }
 
 Return<void> OemLock::isOemUnlockAllowedByDevice(isOemUnlockAllowedByDevice_cb _hidl_cb) {
+    OemLockStatus status = OemLockStatus::FAILED;
+    bool allowed = false;
+    mArbiter.run(Priority::NORMAL, [&](EseInterface&) {
+        std::tie(status, allowed) = isOemUnlockAllowedByDeviceOnEse();
+        return 0;
+    });
+    _hidl_cb(status, allowed);
+    return Void();
+}
+
+std::tuple<OemLockStatus, bool> OemLock::isOemUnlockAllowedByDeviceOnEse() {
     LOG(VERBOSE) << "Running OemLock::isOemUnlockAllowedByDevice";
-    ScopedEseConnection ese{mEse};
-    ese.init();
-    // Open SE session for applet
-    EseBootSession session;
-    ese_boot_session_init(&session);
-    EseAppResult res = ese_boot_session_open(mEse.ese_interface(), &session);
+    // Get the pooled session for the applet
+    EseBootSession* session;
+    EseAppResult res = mChannels.boot(&session);
     if (res != ESE_APP_RESULT_OK) {
         LOG(ERROR) << "Failed to open a boot session: " << res;
-        _hidl_cb(OemLockStatus::FAILED, false);
-        return Void();
+        return {OemLockStatus::FAILED, false};
     }
     uint8_t lock_byte = 0;
-    res = ese_boot_lock_get(&session, kEseBootLockIdDevice, &lock_byte);
+    res = ese_boot_lock_get(session, kEseBootLockIdDevice, &lock_byte);
     if (res != ESE_APP_RESULT_OK) {
         LOG(ERROR) << "Failed to get device lock state: " << res;
     }
 
-    // Try and close the session without perturbing our result value.
-    if (ese_boot_session_close(&session) != ESE_APP_RESULT_OK) {
-        LOG(WARNING) << "Failed to close boot session";
-    }
+    mChannels.bootResult(res);
 
     if (res != ESE_APP_RESULT_OK) {
         // Fail closed.
-        _hidl_cb(OemLockStatus::FAILED, false);
-        return Void();
+        return {OemLockStatus::FAILED, false};
     }
     // if data[0] == 1, lock == true, so allowed == false.
-    _hidl_cb(OemLockStatus::OK, lock_byte != 0 ? false : true);
-    return Void();
+    return {OemLockStatus::OK, lock_byte != 0 ? false : true};
 }
 
 }  // namespace esed
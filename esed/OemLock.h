@@ -21,12 +21,16 @@
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 
-#include <esecpp/EseInterface.h>
+#include <tuple>
+
+#include <esecpp/TransceiveArbiter.h>
+
+#include "ChannelPool.h"
 
 namespace android {
 namespace esed {
 
-using ::android::EseInterface;
+using ::android::TransceiveArbiter;
 using ::android::hardware::oemlock::V1_0::IOemLock;
 using ::android::hardware::oemlock::V1_0::OemLockSecureStatus;
 using ::android::hardware::oemlock::V1_0::OemLockStatus;
@@ -34,7 +38,8 @@ using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 
 struct OemLock : public IOemLock {
-    OemLock(EseInterface& ese) : mEse(ese) {}
+    OemLock(ChannelPool& channels, TransceiveArbiter& arbiter)
+            : mChannels(channels), mArbiter(arbiter) {}
 
     // Methods from ::android::hardware::oemlock::V1_0::IOemLock follow.
     Return<void> getName(getName_cb _hidl_cb) override;
@@ -49,7 +54,15 @@ struct OemLock : public IOemLock {
     Return<void> isOemUnlockAllowedByDevice(isOemUnlockAllowedByDevice_cb _hidl_cb) override;
 
 private:
-    EseInterface& mEse;
+    // Run on the arbiter's thread, which has the eSE to itself.
+    OemLockSecureStatus setOemUnlockAllowedByCarrierOnEse(bool allowed,
+                                                          const hidl_vec<uint8_t>& signature);
+    std::tuple<OemLockStatus, bool> isOemUnlockAllowedByCarrierOnEse();
+    OemLockStatus setOemUnlockAllowedByDeviceOnEse(bool allowed);
+    std::tuple<OemLockStatus, bool> isOemUnlockAllowedByDeviceOnEse();
+
+    ChannelPool& mChannels;
+    TransceiveArbiter& mArbiter;
 };
 
 }  // namespace esed
@@ -22,7 +22,7 @@
 #include <android-base/logging.h>
 
 #include <ese/app/weaver.h>
-#include "ScopedEseConnection.h"
+#include "ChannelPool.h"
 
 namespace android {
 namespace esed {
@@ -30,56 +30,60 @@ namespace esed {
 // libhidl
 using ::android::hardware::Void;
 
-// HAL
-using ::android::hardware::weaver::V1_0::WeaverConfig;
-using ::android::hardware::weaver::V1_0::WeaverReadResponse;
-using ::android::hardware::weaver::V1_0::WeaverReadStatus;
+using Priority = ::android::TransceiveArbiter::Priority;
 
 // Methods from ::android::hardware::weaver::V1_0::IWeaver follow.
 Return<void> Weaver::getConfig(getConfig_cb _hidl_cb) {
+    WeaverStatus status = WeaverStatus::FAILED;
+    WeaverConfig config;
+    mArbiter.run(Priority::NORMAL, [&](EseInterface&) {
+        std::tie(status, config) = getConfigOnEse();
+        return 0;
+    });
+    _hidl_cb(status, config);
+    return Void();
+}
+
+std::tuple<WeaverStatus, WeaverConfig> Weaver::getConfigOnEse() {
     LOG(VERBOSE) << "Running Weaver::getNumSlots";
-    // Open SE session for applet
-    ScopedEseConnection ese{mEse};
-    ese.init();
-    EseWeaverSession ws;
-    ese_weaver_session_init(&ws);
-    EseAppResult res = ese_weaver_session_open(mEse.ese_interface(), &ws);
+    // Get the pooled session for the applet
+    EseWeaverSession* ws;
+    EseAppResult res = mChannels.weaver(&ws);
     if (EseAppResultValue(res) == ESE_APP_RESULT_ERROR_OS) {
         switch (EseAppResultAppValue(res)) {
         case 0x6999: // SW_APPLET_SELECT_FAILED
         case 0x6A82: // SW_FILE_NOT_FOUND
             // No applet means no Weaver storage. Report no slots to prompt
             // fallback to software mode.
-            _hidl_cb(WeaverStatus::OK, WeaverConfig{0, 0, 0});
-            return Void();
+            return {WeaverStatus::OK, WeaverConfig{0, 0, 0}};
         }
+        return {WeaverStatus::FAILED, WeaverConfig{}};
     } else if (res != ESE_APP_RESULT_OK) {
         // Transient error
-        _hidl_cb(WeaverStatus::FAILED, WeaverConfig{});
-        return Void();
+        return {WeaverStatus::FAILED, WeaverConfig{}};
     }
 
     // Call the applet
     uint32_t numSlots;
-    if (ese_weaver_get_num_slots(&ws, &numSlots) != ESE_APP_RESULT_OK) {
-        _hidl_cb(WeaverStatus::FAILED, WeaverConfig{});
-        return Void();
-    }
-
-    // Try and close the session
-    if (ese_weaver_session_close(&ws) != ESE_APP_RESULT_OK) {
-        LOG(WARNING) << "Failed to close Weaver session";
+    res = ese_weaver_get_num_slots(ws, &numSlots);
+    mChannels.weaverResult(res);
+    if (res != ESE_APP_RESULT_OK) {
+        return {WeaverStatus::FAILED, WeaverConfig{}};
     }
 
-    _hidl_cb(WeaverStatus::OK, WeaverConfig{numSlots, kEseWeaverKeySize, kEseWeaverValueSize});
-    return Void();
+    return {WeaverStatus::OK, WeaverConfig{numSlots, kEseWeaverKeySize, kEseWeaverValueSize}};
 }
 
 Return<WeaverStatus> Weaver::write(uint32_t slotId, const hidl_vec<uint8_t>& key,
                            const hidl_vec<uint8_t>& value) {
+    return static_cast<WeaverStatus>(mArbiter.run(Priority::BULK, [&](EseInterface&) {
+        return static_cast<int>(writeOnEse(slotId, key, value));
+    }));
+}
+
+WeaverStatus Weaver::writeOnEse(uint32_t slotId, const hidl_vec<uint8_t>& key,
+                                const hidl_vec<uint8_t>& value) {
     LOG(INFO) << "Running Weaver::write on slot " << slotId;
-    ScopedEseConnection ese{mEse};
-    ese.init();
     // Validate the key and value sizes
     if (key.size() != kEseWeaverKeySize) {
         LOG(ERROR) << "Key size must be " << kEseWeaverKeySize << ", not" << key.size() << " bytes";
@@ -91,51 +95,56 @@ Return<WeaverStatus> Weaver::write(uint32_t slotId, const hidl_vec<uint8_t>& key
         return WeaverStatus::FAILED;
     }
 
-    // Open SE session for applet
-    EseWeaverSession ws;
-    ese_weaver_session_init(&ws);
-    if (ese_weaver_session_open(mEse.ese_interface(), &ws) != ESE_APP_RESULT_OK) {
+    // Get the pooled session for the applet
+    EseWeaverSession* ws;
+    if (mChannels.weaver(&ws) != ESE_APP_RESULT_OK) {
         return WeaverStatus::FAILED;
     }
 
     // Call the applet
-    if (ese_weaver_write(&ws, slotId, key.data(), value.data()) != ESE_APP_RESULT_OK) {
+    const EseAppResult res = ese_weaver_write(ws, slotId, key.data(), value.data());
+    mChannels.weaverResult(res);
+    if (res != ESE_APP_RESULT_OK) {
         return WeaverStatus::FAILED;
     }
 
-    // Try and close the session
-    if (ese_weaver_session_close(&ws) != ESE_APP_RESULT_OK) {
-        LOG(WARNING) << "Failed to close Weaver session";
-    }
-
     return WeaverStatus::OK;
 }
 
 Return<void> Weaver::read(uint32_t slotId, const hidl_vec<uint8_t>& key, read_cb _hidl_cb) {
+    // Reads gate unlocking the device so they go ahead of everything else.
+    WeaverReadStatus status = WeaverReadStatus::FAILED;
+    WeaverReadResponse response;
+    mArbiter.run(Priority::CRITICAL, [&](EseInterface&) {
+        std::tie(status, response) = readOnEse(slotId, key);
+        return 0;
+    });
+    _hidl_cb(status, response);
+    return Void();
+}
+
+std::tuple<WeaverReadStatus, WeaverReadResponse> Weaver::readOnEse(uint32_t slotId,
+                                                                  const hidl_vec<uint8_t>& key) {
     LOG(VERBOSE) << "Running Weaver::read on slot " << slotId;
 
     // Validate the key size
     if (key.size() != kEseWeaverKeySize) {
         LOG(ERROR) << "Key size must be " << kEseWeaverKeySize << ", not" << key.size() << " bytes";
-        _hidl_cb(WeaverReadStatus::FAILED, WeaverReadResponse{});
-        return Void();
+        return {WeaverReadStatus::FAILED, WeaverReadResponse{}};
     }
 
-    // Open SE session for applet
-    ScopedEseConnection ese{mEse};
-    ese.init();
-    EseWeaverSession ws;
-    ese_weaver_session_init(&ws);
-    if (ese_weaver_session_open(mEse.ese_interface(), &ws) != ESE_APP_RESULT_OK) {
-        _hidl_cb(WeaverReadStatus::FAILED, WeaverReadResponse{});
-        return Void();
+    // Get the pooled session for the applet
+    EseWeaverSession* ws;
+    if (mChannels.weaver(&ws) != ESE_APP_RESULT_OK) {
+        return {WeaverReadStatus::FAILED, WeaverReadResponse{}};
     }
 
     // Call the applet
     hidl_vec<uint8_t> value;
     value.resize(kEseWeaverValueSize);
     uint32_t timeout;
-    const int res = ese_weaver_read(&ws, slotId, key.data(), value.data(), &timeout);
+    const int res = ese_weaver_read(ws, slotId, key.data(), value.data(), &timeout);
+    mChannels.weaverResult(static_cast<EseAppResult>(res));
     WeaverReadStatus status;
     switch (res) {
         case ESE_APP_RESULT_OK:
@@ -157,13 +166,7 @@ Return<void> Weaver::read(uint32_t slotId, const hidl_vec<uint8_t>& key, read_cb
             break;
     }
 
-    // Try and close the session
-    if (ese_weaver_session_close(&ws) != ESE_APP_RESULT_OK) {
-        LOG(WARNING) << "Failed to close Weaver session";
-    }
-
-    _hidl_cb(status, WeaverReadResponse{timeout, value});
-    return Void();
+    return {status, WeaverReadResponse{timeout, value}};
 }
 
 }  // namespace esed
@@ -21,19 +21,27 @@
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 
-#include <esecpp/EseInterface.h>
+#include <tuple>
+
+#include <esecpp/TransceiveArbiter.h>
+
+#include "ChannelPool.h"
 
 namespace android {
 namespace esed {
 
-using ::android::EseInterface;
+using ::android::TransceiveArbiter;
 using ::android::hardware::weaver::V1_0::IWeaver;
+using ::android::hardware::weaver::V1_0::WeaverConfig;
+using ::android::hardware::weaver::V1_0::WeaverReadResponse;
+using ::android::hardware::weaver::V1_0::WeaverReadStatus;
 using ::android::hardware::weaver::V1_0::WeaverStatus;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 
 struct Weaver : public IWeaver {
-    Weaver(EseInterface& ese) : mEse(ese) {};
+    Weaver(ChannelPool& channels, TransceiveArbiter& arbiter)
+            : mChannels(channels), mArbiter(arbiter) {};
 
     // Methods from ::android::hardware::weaver::V1_0::IWeaver follow.
     Return<void> getConfig(getConfig_cb _hidl_cb) override;
@@ -42,7 +50,15 @@ struct Weaver : public IWeaver {
     Return<void> read(uint32_t slotId, const hidl_vec<uint8_t>& key, read_cb _hidl_cb) override;
 
 private:
-    EseInterface& mEse;
+    // Run on the arbiter's thread, which has the eSE to itself.
+    std::tuple<WeaverStatus, WeaverConfig> getConfigOnEse();
+    WeaverStatus writeOnEse(uint32_t slotId, const hidl_vec<uint8_t>& key,
+                            const hidl_vec<uint8_t>& value);
+    std::tuple<WeaverReadStatus, WeaverReadResponse> readOnEse(uint32_t slotId,
+                                                               const hidl_vec<uint8_t>& key);
+
+    ChannelPool& mChannels;
+    TransceiveArbiter& mArbiter;
 };
 
 }  // namespace esed
@@ -27,9 +27,15 @@
 #include <esecpp/NxpPn80tNqNci.h>
 using EseInterfaceImpl = android::NxpPn80tNqNci;
 
+#include <esecpp/EseConnection.h>
+#include <esecpp/TransceiveArbiter.h>
+
+#include "ChannelPool.h"
 #include "Weaver.h"
 
+using android::EseConnection;
 using android::OK;
+using android::TransceiveArbiter;
 using android::sp;
 using android::status_t;
 using android::hardware::configureRpcThreadpool;
@@ -37,6 +43,8 @@ using android::hardware::joinRpcThreadpool;
 
 using namespace std::chrono_literals;
 
+using android::esed::ChannelPool;
+
 // HALs
 using android::esed::Weaver;
 
@@ -71,13 +79,27 @@ int main(int /* argc */, char** /* argv */) {
     ese.close();
 
 
-    // This will be a single threaded daemon. This is important as libese is not
-    // thread safe so we use binder to synchronize requests for us.
+    // Keep the eSE powered, and the applet channels open, across HAL calls
+    // while they come in bursts, e.g. the Weaver reads of an unlock, and power
+    // it down once nothing has used it for the idle window.
+    const std::chrono::milliseconds idleWindow{android::base::GetUintProperty<uint32_t>(
+            "ro.vendor.ese.idle_window_ms", 5000)};
+    EseConnection connection{ese, idleWindow};
+    ChannelPool channels{connection};
+
+    // libese is not thread safe so every use of the eSE goes through the
+    // arbiter, which lets HAL calls wait on each other by priority rather than
+    // in binder arrival order.
+    TransceiveArbiter arbiter{ese};
+    arbiter.setIdleTask(connection.idleWindow(),
+                        [&connection](android::EseInterface&) { connection.close(); });
+
+    constexpr size_t kBinderThreads = 4;
     constexpr bool thisThreadWillJoinPool = true;
-    configureRpcThreadpool(1, thisThreadWillJoinPool);
+    configureRpcThreadpool(kBinderThreads, thisThreadWillJoinPool);
 
     // Create Weaver HAL instance
-    sp<Weaver> weaver = new Weaver{ese};
+    sp<Weaver> weaver = new Weaver{channels, arbiter};
     const status_t status = weaver->registerAsService();
     if (status != OK) {
         LOG(ERROR) << "Failed to register Weaver as a service (status: " << status << ")";
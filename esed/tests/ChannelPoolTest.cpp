@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../ChannelPool.h"
+
+namespace android {
+namespace esed {
+namespace {
+
+// A card which hands out logical channels and answers the Weaver and boot
+// commands used below with success.
+struct FakeCard {
+    int apdus = 0;
+    int opens = 0;
+    std::vector<uint8_t> channels;  // Open channel numbers.
+    uint8_t lastChannel = 0;
+    std::vector<uint8_t> swOverride;  // Sent once in place of 90 00 if set.
+};
+FakeCard* gCard;
+
+uint32_t CardTransceive(struct ::EseInterface*, const struct EseSgBuffer* tx, uint32_t txSegs,
+                        struct EseSgBuffer* rx, uint32_t rxSegs) {
+    uint8_t apdu[64];
+    ese_sg_to_buf(tx, txSegs, 0, sizeof(apdu), apdu);
+    std::vector<uint8_t> reply;
+    ++gCard->apdus;
+    if (apdu[1] == 0x70 && apdu[2] == 0x00) {
+        gCard->channels.push_back(++gCard->lastChannel);
+        reply = {gCard->lastChannel};
+    } else if (apdu[1] == 0x70 && apdu[2] == 0x80) {
+        auto& open = gCard->channels;
+        open.erase(std::remove(open.begin(), open.end(), apdu[3]), open.end());
+    } else if (apdu[1] == 0x02) {
+        reply = {0x00, 0x00, 0x00, 0x40};
+    } else if (apdu[1] == 0x06) {
+        reply.assign(1 + kEseWeaverValueSize, 0x00);
+    }
+    if (!gCard->swOverride.empty()) {
+        reply = gCard->swOverride;
+        gCard->swOverride.clear();
+    } else {
+        reply.push_back(0x90);
+        reply.push_back(0x00);
+    }
+    return ese_sg_from_buf(rx, rxSegs, 0, reply.size(), reply.data());
+}
+
+struct EseOperations CardOps() {
+    struct EseOperations ops = {};
+    ops.name = "fake card";
+    ops.transceive = &CardTransceive;
+    return ops;
+}
+const struct EseOperations kCardOps = CardOps();
+const struct EseOperations* const FAKE_CARD_ops = &kCardOps;
+
+struct FakeEse : public EseInterface {
+    void init() override {
+        mEse = &mInterface;
+        ese_init(mEse, FAKE_CARD);
+    }
+    int open() override {
+        ++gCard->opens;
+        return ese_open(mEse, nullptr);
+    }
+    void close() override {
+        if (mEse != nullptr) {
+            ese_close(mEse);
+            mEse = nullptr;
+        }
+    }
+    ::EseInterface mInterface;
+};
+
+class ChannelPoolTest : public ::testing::Test {
+protected:
+    void SetUp() override { gCard = &mCard; }
+
+    EseAppResult readSlot() {
+        EseWeaverSession* ws;
+        EseAppResult res = mPool.weaver(&ws);
+        if (res != ESE_APP_RESULT_OK) {
+            return res;
+        }
+        const uint8_t key[kEseWeaverKeySize] = {0};
+        uint8_t value[kEseWeaverValueSize];
+        uint32_t timeout;
+        res = static_cast<EseAppResult>(ese_weaver_read(ws, 0, key, value, &timeout));
+        mPool.weaverResult(res);
+        return res;
+    }
+
+    FakeCard mCard;
+    FakeEse mEse;
+    EseConnection mConnection{mEse, std::chrono::milliseconds(0)};
+    ChannelPool mPool{mConnection};
+};
+
+} // namespace
+
+TEST_F(ChannelPoolTest, ReusesChannelAcrossCalls) {
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(ESE_APP_RESULT_OK, readSlot());
+    }
+    // MANAGE CHANNEL OPEN and SELECT once, then one APDU per read rather
+    // than four.
+    EXPECT_EQ(2 + 4, mCard.apdus);
+    EXPECT_EQ(1, mCard.opens);
+    mPool.closeAll();
+    EXPECT_TRUE(mCard.channels.empty());
+}
+
+TEST_F(ChannelPoolTest, WeaverAndBootHoldTheirOwnChannels) {
+    EseWeaverSession* ws;
+    EseBootSession* bs;
+    ASSERT_EQ(ESE_APP_RESULT_OK, mPool.weaver(&ws));
+    ASSERT_EQ(ESE_APP_RESULT_OK, mPool.boot(&bs));
+    EXPECT_NE(ws->channel_id, bs->channel_id);
+    EXPECT_EQ(2u, mCard.channels.size());
+    EXPECT_EQ(1, mCard.opens);
+}
+
+TEST_F(ChannelPoolTest, LostChannelIsReopened) {
+    ASSERT_EQ(ESE_APP_RESULT_OK, readSlot());
+    mCard.swOverride = {0x6e, 0x00};
+    EXPECT_NE(ESE_APP_RESULT_OK, readSlot());
+    const int before = mCard.apdus;
+    EXPECT_EQ(ESE_APP_RESULT_OK, readSlot());
+    EXPECT_EQ(before + 3, mCard.apdus);
+    EXPECT_EQ(1u, mCard.channels.size());
+    EXPECT_EQ(1, mCard.opens);
+}
+
+TEST_F(ChannelPoolTest, IdleCloseReleasesChannels) {
+    ASSERT_EQ(ESE_APP_RESULT_OK, readSlot());
+    mConnection.close();
+    EXPECT_TRUE(mCard.channels.empty());
+    // The next call opens the eSE and a channel again.
+    EXPECT_EQ(ESE_APP_RESULT_OK, readSlot());
+    EXPECT_EQ(2, mCard.opens);
+    EXPECT_EQ(1u, mCard.channels.size());
+}
+
+TEST_F(ChannelPoolTest, TransportFailureReopensEse) {
+    ASSERT_EQ(ESE_APP_RESULT_OK, readSlot());
+    mPool.weaverResult(ESE_APP_RESULT_ERROR_COMM_FAILED);
+    EXPECT_EQ(ESE_APP_RESULT_OK, readSlot());
+    EXPECT_EQ(2, mCard.opens);
+}
+
+} // namespace esed
+} // namespace android
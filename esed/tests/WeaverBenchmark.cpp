@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <esecpp/EseConnection.h>
+#include <esecpp/EseSim.h>
+#include <esecpp/TransceiveArbiter.h>
+#include <weaver/WeaverEmulator.h>
+
+#include "../ChannelPool.h"
+#include "../Weaver.h"
+
+namespace android {
+namespace esed {
+namespace {
+
+// Load on the Weaver HAL from one or more binder threads, served by the
+// emulated applet. range(0) selects the card: 0 answers instantly, leaving
+// the cost of esed and libese alone, and 1 puts it on a 1 MHz SPI bus with
+// 1 ms to process each APDU and 5 ms for each NVM write.
+
+WeaverEmulator::Config cardConfig(bool timed) {
+    WeaverEmulator::Config config;
+    if (timed) {
+        config.nvmWriteLatency = std::chrono::milliseconds(5);
+    }
+    return config;
+}
+
+const std::vector<uint8_t> kKey(kEseWeaverKeySize, 0x11);
+const std::vector<uint8_t> kValue(kEseWeaverValueSize, 0x22);
+
+// esed as main() puts it together, on a simulated card.
+struct Esed {
+    explicit Esed(bool timed) : card(cardConfig(timed)) {
+        card.attach(ese.config());
+        if (timed) {
+            ese.config().byte_time_ns = 8000;
+            ese.config().think_time_us = 1000;
+        }
+        arbiter.setIdleTask(connection.idleWindow(),
+                            [this](EseInterface&) { connection.close(); });
+    }
+
+    WeaverEmulator card;
+    EseSim ese;
+    EseConnection connection{ese, std::chrono::milliseconds(5000)};
+    ChannelPool channels{connection};
+    TransceiveArbiter arbiter{ese};
+    sp<Weaver> weaver{new Weaver{channels, arbiter}};
+};
+
+// Shared by the threads of a run: the first one in sets it up and the last
+// one out tears it down.
+std::mutex gLock;
+int gThreads = 0;
+std::unique_ptr<Esed> gEsed;
+
+Esed& join(bool timed) {
+    std::lock_guard<std::mutex> lock(gLock);
+    if (gThreads++ == 0) {
+        gEsed.reset(new Esed(timed));
+        gEsed->weaver->write(0, kKey, kValue);
+    }
+    return *gEsed;
+}
+
+void leave() {
+    std::lock_guard<std::mutex> lock(gLock);
+    if (--gThreads == 0) {
+        gEsed.reset();
+    }
+}
+
+void BM_WeaverHalRead(benchmark::State& state) {
+    Esed& esed = join(state.range(0) != 0);
+    const hidl_vec<uint8_t> key{kKey};
+    for (auto _ : state) {
+        WeaverReadStatus status = WeaverReadStatus::FAILED;
+        esed.weaver->read(0, key, [&status](WeaverReadStatus s, const WeaverReadResponse&) {
+            status = s;
+        });
+        if (status != WeaverReadStatus::OK) {
+            state.SkipWithError("read failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    leave();
+}
+BENCHMARK(BM_WeaverHalRead)->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_WeaverHalWrite(benchmark::State& state) {
+    Esed& esed = join(state.range(0) != 0);
+    const hidl_vec<uint8_t> key{kKey};
+    const hidl_vec<uint8_t> value{kValue};
+    for (auto _ : state) {
+        if (esed.weaver->write(1, key, value) != WeaverStatus::OK) {
+            state.SkipWithError("write failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    leave();
+}
+BENCHMARK(BM_WeaverHalWrite)->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
+
+}  // namespace
+}  // namespace esed
+}  // namespace android
+
+BENCHMARK_MAIN();
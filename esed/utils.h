@@ -17,8 +17,11 @@
 #ifndef ESED_PN81A_UTILS_H_
 #define ESED_PN81A_UTILS_H_
 
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include <hidl/Status.h>
 
@@ -34,9 +37,40 @@ namespace pn81a {
 using ::android::hardware::Status;
 
 
+/**
+ * The bytes of a response, as received into the calling thread's response buffer.
+ */
+struct ResponseBytes {
+    const uint8_t* first;
+    const uint8_t* last;
+
+    const uint8_t* begin() const { return first; }
+    const uint8_t* end() const { return last; }
+};
+
 // libapdu
 using ::android::CommandApdu;
-using ResponseApdu = ::android::ResponseApdu<const std::vector<uint8_t>>;
+using ResponseApdu = ::android::ResponseApdu<const ResponseBytes>;
+
+/**
+ * Returns the calling thread's response buffer, holding at least enough room for the response to
+ * |command|: the data it asks for with Le and the status word. Anything short of an extended
+ * response gets the 258 bytes a short Le can ask for, so only an extended command grows the buffer
+ * past that.
+ *
+ * The buffer belongs to the thread and is reused by each command it sends; it only grows, so the
+ * contents left by an earlier response are not cleared and only growth pays to zero-fill.
+ */
+inline std::vector<uint8_t>& responseBuffer(const CommandApdu& command) {
+    constexpr size_t STATUS_SIZE = 2;
+    constexpr size_t SHORT_LE_MAX = std::numeric_limits<uint8_t>::max() + 1;
+    thread_local std::vector<uint8_t> buffer;
+    const size_t size = std::max(command.le(), SHORT_LE_MAX) + STATUS_SIZE;
+    if (buffer.size() < size) {
+        buffer.resize(size);
+    }
+    return buffer;
+}
 
 /**
  * Reads a 32-bit integer from an iterator.
@@ -74,14 +108,15 @@ OutputIt writeBigEndian(const uint32_t value, OutputIt first) {
  * Transceive a command with the eSE and perform common error checking. When the
  * handler is called, it has been checked that the transmission to and reception
  * from the eSE was successful and that the response is in a valid format.
+ *
+ * The response is received into the thread's responseBuffer() so the handler must not transceive
+ * again, or keep the ResponseApdu, once it returns.
  */
 template<typename T, T OK, T FAILED>
 T transceive(::android::esed::EseInterface& ese, const CommandApdu& command,
                   std::function<T(const ResponseApdu&)> handler = {}) {
-    // +1 for max size of extended response, +2 for status bytes
-    constexpr size_t MAX_RESPONSE_SIZE = std::numeric_limits<uint16_t>::max() + 1 + 2;
-    std::vector<uint8_t> responseBuffer(MAX_RESPONSE_SIZE);
-    const int ret = ese.transceive(command.vector(), responseBuffer);
+    std::vector<uint8_t>& buffer = responseBuffer(command);
+    const int ret = ese.transceive(command.vector(), buffer);
 
     // Check eSE communication was successful
     if (ret < 0) {
@@ -94,17 +129,12 @@ T transceive(::android::esed::EseInterface& ese, const CommandApdu& command,
         LOG(ERROR) << errMsg;
         return FAILED;
     }
+    // At most buffer.size() bytes are received into the buffer, so ret is in range
     const size_t recvd = static_cast<size_t>(ret);
 
-    // Need to recalculate the maximum response size if this fails
-    if (recvd > MAX_RESPONSE_SIZE) {
-        LOG(ERROR) << "eSE response was longer than the buffer, check the buffer size.";
-        return FAILED;
-    }
-    responseBuffer.resize(recvd);
-
     // Check for ISO 7816-4 APDU response format errors
-    ResponseApdu apdu{responseBuffer};
+    const ResponseBytes bytes{buffer.data(), buffer.data() + recvd};
+    ResponseApdu apdu{bytes};
     if (!apdu.ok()) {
         LOG(ERROR) << "eSE response was invalid.";
         return FAILED;
@@ -16,40 +16,21 @@
 
 #include <apdu/apdu.h>
 
-#include <limits>
+#include <algorithm>
 
 namespace android {
 
 CommandApdu::CommandApdu(const uint8_t cla, const uint8_t ins, const uint8_t p1, const uint8_t p2,
-        const size_t lc, const size_t le) {
-    constexpr size_t headerSize = 4;
-    constexpr size_t shortLcMax = std::numeric_limits<uint8_t>::max();
-    constexpr size_t shortLeMax = std::numeric_limits<uint8_t>::max() + 1;
-    //constexpr size_t extendedLcMax = std::numeric_limits<uint16_t>::max();
-    constexpr size_t extendedLeMax = std::numeric_limits<uint16_t>::max() + 1;
+        const size_t lc, const size_t le) : mLe(le) {
+    const CommandTemplate command{cla, ins, p1, p2, lc, le};
+    mExtended = command.extended();
+    mCommand.resize(command.size(), 0);
 
-    const bool extended = lc > shortLcMax || le > shortLeMax;
-    const bool hasLc = lc > 0;
-    const bool hasLe = le > 0;
-    const size_t lcSize = hasLc ? (extended ? 3 : 1) : 0;
-    const size_t leSize = hasLe ? (extended ? (hasLc ? 2 : 3) : 1) : 0;
-    const size_t commandSize = headerSize + lcSize + lc + leSize;
-    mCommand.resize(commandSize, 0);
-
-    // All cases have the header
-    auto it = mCommand.begin();
-    *it++ = cla;
-    *it++ = ins;
-    *it++ = p1;
-    *it++ = p2;
+    // All cases have the header and cases 3 & 4 its Lc
+    auto it = std::copy_n(command.header(), command.headerSize(), mCommand.begin());
 
     // Cases 3 & 4 send data
-    if (hasLc) {
-        if (extended) {
-            *it++ = 0;
-            *it++ = 0xff & (lc >> 8);
-        }
-        *it++ = 0xff & lc;
+    if (lc > 0) {
         mDataBegin = it;
         it += lc;
         mDataEnd = it;
@@ -58,18 +39,7 @@ CommandApdu::CommandApdu(const uint8_t cla, const uint8_t ins, const uint8_t p1,
     }
 
     // Cases 2 & 4 expect data back
-    if (hasLe) {
-        if (extended) {
-            if (!hasLc) {
-                *it++ = 0;
-            }
-            const bool isLeMax = le == extendedLeMax;
-            *it++ = (isLeMax ? 0 : 0xff & (le >> 8));
-            *it++ = (isLeMax ? 0 : 0xff & le);
-        } else {
-            *it++ = (le == shortLeMax ? 0 : 0xff & le);
-        }
-    }
+    std::copy_n(command.trailer(), command.trailerSize(), it);
 }
 
 } // namespace android
@@ -17,13 +17,104 @@
 #ifndef APDU_H_
 #define APDU_H_
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <iterator>
 #include <vector>
 
+#include <ese/ese_sg.h>
+
 namespace android {
 
+/**
+ * The fixed part of a command: the header, the Lc encoding and the Le encoding. Constructing one
+ * with constexpr encodes it at compile time, leaving only the logical channel and the data to be
+ * filled in when the command is sent.
+ *
+ * Lc and Le are encoded as CommandApdu encodes them, so the data size is also fixed. An Lc above
+ * MAX_LC or an Le above MAX_LE cannot be encoded: a constexpr template fails to compile and any
+ * other aborts the process.
+ */
+class CommandTemplate {
+public:
+    /** CLA, INS, P1, P2 and an extended Lc. */
+    static constexpr size_t MAX_HEADER_SIZE = 7;
+    /** An extended Le without an Lc. */
+    static constexpr size_t MAX_TRAILER_SIZE = 3;
+    /** The largest extended Lc and Le. */
+    static constexpr size_t MAX_LC = 65535;
+    static constexpr size_t MAX_LE = 65536;
+
+    constexpr CommandTemplate(uint8_t cla, uint8_t ins, uint8_t p1, uint8_t p2)
+            : CommandTemplate(cla, ins, p1, p2, 0, 0) {}
+    constexpr CommandTemplate(uint8_t cla, uint8_t ins, uint8_t p1, uint8_t p2, size_t lc,
+                              size_t le)
+            : mHeader{cla, ins, p1, p2, lcByte(checked(lc, MAX_LC), le, 0), lcByte(lc, le, 1),
+                      lcByte(lc, le, 2)},
+              mTrailer{leByte(lc, checked(le, MAX_LE), 0), leByte(lc, le, 1), leByte(lc, le, 2)},
+              mHeaderSize(4 + lcSize(lc, le)), mTrailerSize(leSize(lc, le)), mLc(lc), mLe(le) {}
+
+    /** The header followed by Lc, with the CLA for the basic channel. */
+    constexpr const uint8_t* header() const { return mHeader; }
+    constexpr size_t headerSize() const { return mHeaderSize; }
+    /** Le, which follows the data. */
+    constexpr const uint8_t* trailer() const { return mTrailer; }
+    constexpr size_t trailerSize() const { return mTrailerSize; }
+
+    constexpr size_t lc() const { return mLc; }
+    constexpr size_t le() const { return mLe; }
+    constexpr bool extended() const { return isExtended(mLc, mLe); }
+    constexpr size_t size() const { return mHeaderSize + mLc + mTrailerSize; }
+
+    /**
+     * The CLA byte that sends this command on logical |channel|, numbered 0 to 19. Channels 0-3
+     * use the first interindustry encoding and 4-19 the further one, keeping the proprietary and
+     * command chaining bits. The template's secure messaging bits are only kept on channels 0-3.
+     */
+    constexpr uint8_t cla(uint8_t channel) const {
+        return channel < 4 ? (mHeader[0] & 0xbc) | channel
+                           : (mHeader[0] & 0x90) | 0x40 | ((channel - 4) & 0x0f);
+    }
+
+private:
+    // std::abort() is not constexpr, so reaching it at compile time is an error.
+    static constexpr size_t checked(size_t n, size_t max) {
+        return n <= max ? n : (std::abort(), n);
+    }
+    static constexpr bool isExtended(size_t lc, size_t le) { return lc > 0xff || le > 0x100; }
+    static constexpr size_t lcSize(size_t lc, size_t le) {
+        return lc == 0 ? 0 : (isExtended(lc, le) ? 3 : 1);
+    }
+    static constexpr size_t leSize(size_t lc, size_t le) {
+        return le == 0 ? 0 : (isExtended(lc, le) ? (lc == 0 ? 3 : 2) : 1);
+    }
+    static constexpr uint8_t lcByte(size_t lc, size_t le, size_t i) {
+        return i >= lcSize(lc, le) ? 0
+             : !isExtended(lc, le) ? 0xff & lc
+             : i == 0 ? 0
+             : i == 1 ? 0xff & (lc >> 8)
+             : 0xff & lc;
+    }
+    // The maximum Le, 256 or 65536, is encoded as zero by truncation.
+    static constexpr uint8_t leByte(size_t lc, size_t le, size_t i) {
+        return i >= leSize(lc, le) ? 0
+             : !isExtended(lc, le) ? 0xff & le
+             : lc == 0 && i == 0 ? 0
+             : i == leSize(lc, le) - 2 ? 0xff & (le >> 8)
+             : 0xff & le;
+    }
+
+    uint8_t mHeader[MAX_HEADER_SIZE];
+    uint8_t mTrailer[MAX_TRAILER_SIZE];
+    size_t mHeaderSize;
+    size_t mTrailerSize;
+    size_t mLc;
+    size_t mLe;
+};
+
 /**
  * Helper to build an APDU command. If a data section is needed, it is left empty with dataBegin
  * and dataEnd able to return iterators to where the data should be filled in.
@@ -52,14 +143,122 @@ public:
     size_t size() const { return mCommand.size(); }
     size_t dataSize() const { return std::distance(mDataBegin, mDataEnd); }
 
+    /** The most response data the command asks for, excluding the status word. */
+    size_t le() const { return mLe; }
+    /** Whether Lc or Le needed the extended encoding. */
+    bool extended() const { return mExtended; }
+
     const std::vector<uint8_t>& vector() const { return mCommand; }
 
 private:
     std::vector<uint8_t> mCommand;
+    size_t mLe;
+    bool mExtended;
     std::vector<uint8_t>::iterator mDataBegin;
     std::vector<uint8_t>::iterator mDataEnd;
 };
 
+/**
+ * A command built from a CommandTemplate into inline storage of up to MAX_DATA bytes of data, so
+ * it never touches the heap. The data is filled in between dataBegin and dataEnd.
+ *
+ * makeFixedCommandApdu() checks the template fits when it is compiled.
+ */
+template<size_t MAX_DATA>
+class FixedCommandApdu {
+public:
+    /** |command| must have no more than MAX_DATA bytes of data; the process aborts if not. */
+    explicit FixedCommandApdu(const CommandTemplate& command, uint8_t channel = 0)
+            : mSize(command.size()), mDataOffset(command.headerSize()), mLc(command.lc()),
+              mLe(command.le()) {
+        if (command.lc() > MAX_DATA) {
+            std::abort();
+        }
+        std::copy_n(command.header(), command.headerSize(), mCommand.begin());
+        mCommand[0] = command.cla(channel);
+        std::copy_n(command.trailer(), command.trailerSize(), dataEnd());
+    }
+
+    using iterator = uint8_t*;
+    using const_iterator = const uint8_t*;
+
+    iterator begin() { return mCommand.data(); }
+    iterator end() { return mCommand.data() + mSize; }
+    const_iterator begin() const { return mCommand.data(); }
+    const_iterator end() const { return mCommand.data() + mSize; }
+
+    iterator dataBegin() { return begin() + mDataOffset; }
+    iterator dataEnd() { return dataBegin() + mLc; }
+    const_iterator dataBegin() const { return begin() + mDataOffset; }
+    const_iterator dataEnd() const { return dataBegin() + mLc; }
+
+    size_t size() const { return mSize; }
+    size_t dataSize() const { return mLc; }
+    size_t le() const { return mLe; }
+
+    /** The whole command as a single segment for ese_transceive_sg(). */
+    EseSgBuffer segment() const {
+        EseSgBuffer sg;
+        sg.c_base = mCommand.data();
+        sg.len = static_cast<uint32_t>(mSize);
+        return sg;
+    }
+
+private:
+    std::array<uint8_t, CommandTemplate::MAX_HEADER_SIZE + MAX_DATA
+                                + CommandTemplate::MAX_TRAILER_SIZE> mCommand;
+    size_t mSize;
+    size_t mDataOffset;
+    size_t mLc;
+    size_t mLe;
+};
+
+/** Builds |COMMAND| into a FixedCommandApdu, failing to compile if its data would not fit. */
+template<size_t MAX_DATA, const CommandTemplate& COMMAND>
+FixedCommandApdu<MAX_DATA> makeFixedCommandApdu(uint8_t channel = 0) {
+    static_assert(COMMAND.lc() <= MAX_DATA, "the command's data does not fit in MAX_DATA");
+    return FixedCommandApdu<MAX_DATA>{COMMAND, channel};
+}
+
+/**
+ * A command as the segments ese_transceive_sg() sends: the header, written with the channel, then
+ * the caller's data and the template's Le from where they are, so the data is not copied before
+ * it reaches the wire. |command| and |data| must outlive the segments.
+ */
+class CommandSegments {
+public:
+    static constexpr uint32_t MAX_SEGMENTS = 3;
+
+    /** |data| holds the command's Lc bytes and may be null if there are none. */
+    CommandSegments(const CommandTemplate& command, uint8_t channel, const uint8_t* data)
+            : mCount(0) {
+        std::copy_n(command.header(), command.headerSize(), mHeader.begin());
+        mHeader[0] = command.cla(channel);
+        add(mHeader.data(), command.headerSize());
+        add(data, command.lc());
+        add(command.trailer(), command.trailerSize());
+    }
+
+    CommandSegments(const CommandSegments&) = delete;
+    CommandSegments& operator=(const CommandSegments&) = delete;
+
+    const EseSgBuffer* segments() const { return mSegments.data(); }
+    uint32_t count() const { return mCount; }
+
+private:
+    void add(const uint8_t* base, size_t len) {
+        if (len > 0) {
+            mSegments[mCount].c_base = base;
+            mSegments[mCount].len = static_cast<uint32_t>(len);
+            ++mCount;
+        }
+    }
+
+    std::array<uint8_t, CommandTemplate::MAX_HEADER_SIZE> mHeader;
+    std::array<EseSgBuffer, MAX_SEGMENTS> mSegments;
+    uint32_t mCount;
+};
+
 /**
  * Helper to deconstruct a response APDU. This wraps a reference to an iterable byte container.
  */
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <array>
+
+#include <benchmark/benchmark.h>
+
+#include <apdu/apdu.h>
+
+using android::CommandApdu;
+using android::CommandSegments;
+using android::CommandTemplate;
+using android::FixedCommandApdu;
+
+namespace {
+
+// Building a Weaver READ, 4 bytes of slot ID and a 16 byte key, on channel 1.
+
+constexpr CommandTemplate kRead{0x80, 0x06, 0x00, 0x00, 20, 16};
+const std::array<uint8_t, 20> kData{{0, 0, 0, 7, 1, 2, 3, 4, 5, 6, 7, 8,
+                                     9, 10, 11, 12, 13, 14, 15, 16}};
+
+void BM_CommandApdu(benchmark::State& state) {
+    for (auto _ : state) {
+        CommandApdu command{0x81, 0x06, 0x00, 0x00, kData.size(), 16};
+        std::copy(kData.begin(), kData.end(), command.dataBegin());
+        benchmark::DoNotOptimize(command.vector().data());
+    }
+}
+BENCHMARK(BM_CommandApdu);
+
+void BM_FixedCommandApdu(benchmark::State& state) {
+    for (auto _ : state) {
+        FixedCommandApdu<32> command{kRead, 1};
+        std::copy(kData.begin(), kData.end(), command.dataBegin());
+        benchmark::DoNotOptimize(command.segment().c_base);
+    }
+}
+BENCHMARK(BM_FixedCommandApdu);
+
+void BM_CommandSegments(benchmark::State& state) {
+    for (auto _ : state) {
+        CommandSegments command{kRead, 1, kData.data()};
+        benchmark::DoNotOptimize(command.segments());
+    }
+}
+BENCHMARK(BM_CommandSegments);
+
+} // namespace
+
+BENCHMARK_MAIN();
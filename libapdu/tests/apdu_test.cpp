@@ -23,6 +23,9 @@
 #include <apdu/apdu.h>
 
 using android::CommandApdu;
+using android::CommandSegments;
+using android::CommandTemplate;
+using android::FixedCommandApdu;
 using android::ResponseApdu;
 
 /* CommandApdu */
@@ -145,6 +148,117 @@ TEST(CommandApduTest, Case4e_maxLe) {
     ASSERT_TRUE(std::equal(apdu.begin(), apdu.end(), expected.begin(), expected.end()));
 }
 
+TEST(CommandApduTest, leAndExtended) {
+    EXPECT_EQ(0u, (CommandApdu{1, 2, 3, 4}.le()));
+    EXPECT_FALSE((CommandApdu{1, 2, 3, 4}.extended()));
+    EXPECT_EQ(256u, (CommandApdu{1, 2, 3, 4, 0, 256}.le()));
+    EXPECT_FALSE((CommandApdu{1, 2, 3, 4, 0, 256}.extended()));
+    EXPECT_EQ(257u, (CommandApdu{1, 2, 3, 4, 0, 257}.le()));
+    EXPECT_TRUE((CommandApdu{1, 2, 3, 4, 0, 257}.extended()));
+    EXPECT_EQ(3u, (CommandApdu{1, 2, 3, 4, 300, 3}.le()));
+    EXPECT_TRUE((CommandApdu{1, 2, 3, 4, 300, 3}.extended()));
+}
+
+/* CommandTemplate */
+
+// CommandApdu is encoded by CommandTemplate, so the cases above cover both.
+constexpr CommandTemplate kCase4e{0x80, 3, 5, 7, 527, 349};
+static_assert(kCase4e.size() == 4 + 3 + 527 + 2, "encoded at compile time");
+static_assert(kCase4e.header()[5] == 2 && kCase4e.trailer()[1] == 93, "encoded at compile time");
+
+TEST(CommandTemplateTest, maxLcAndLe) {
+    constexpr CommandTemplate largest{1, 2, 3, 4, CommandTemplate::MAX_LC, CommandTemplate::MAX_LE};
+    static_assert(largest.header()[5] == 0xff && largest.header()[6] == 0xff, "");
+    static_assert(largest.trailer()[0] == 0 && largest.trailer()[1] == 0, "");
+}
+
+TEST(CommandTemplateDeathTest, rejectsLcOrLeTooLarge) {
+    EXPECT_DEATH((CommandTemplate{1, 2, 3, 4, CommandTemplate::MAX_LC + 1, 0}), "");
+    EXPECT_DEATH((CommandTemplate{1, 2, 3, 4, 0, CommandTemplate::MAX_LE + 1}), "");
+    EXPECT_DEATH((CommandApdu{1, 2, 3, 4, 20, CommandTemplate::MAX_LE + 1}), "");
+}
+
+TEST(CommandTemplateTest, channelCla) {
+    constexpr CommandTemplate proprietary{0x80, 2, 0, 0};
+    constexpr CommandTemplate interindustry{0x00, 0xa4, 4, 0};
+    static_assert(proprietary.cla(0) == 0x80, "");
+    EXPECT_EQ(0x83, proprietary.cla(3));
+    EXPECT_EQ(0xc0, proprietary.cla(4));
+    EXPECT_EQ(0xcf, proprietary.cla(19));
+    EXPECT_EQ(0x01, interindustry.cla(1));
+    EXPECT_EQ(0x0e, (CommandTemplate{0x0c, 0xa4, 4, 0}.cla(2)));
+    EXPECT_EQ(0x45, interindustry.cla(9));
+    // Command chaining survives on every channel.
+    constexpr CommandTemplate chained{0x90, 0xe8, 0, 0};
+    EXPECT_EQ(0x92, chained.cla(2));
+    EXPECT_EQ(0xd0, chained.cla(4));
+    EXPECT_EQ(0xdf, chained.cla(19));
+}
+
+/* FixedCommandApdu */
+
+TEST(FixedCommandApduTest, matchesCommandApdu) {
+    constexpr CommandTemplate kWrite{0x80, 4, 0, 0, 36, 0};
+    FixedCommandApdu<64> fixed{kWrite, 2};
+    CommandApdu apdu{0x82, 4, 0, 0, 36, 0};
+    ASSERT_EQ(36u, fixed.dataSize());
+    for (size_t i = 0; i < fixed.dataSize(); ++i) {
+        fixed.dataBegin()[i] = apdu.dataBegin()[i] = static_cast<uint8_t>(i);
+    }
+    ASSERT_EQ(apdu.size(), fixed.size());
+    EXPECT_TRUE(std::equal(fixed.begin(), fixed.end(), apdu.begin(), apdu.end()));
+
+    const EseSgBuffer sg = fixed.segment();
+    EXPECT_EQ(&*fixed.begin(), sg.c_base);
+    EXPECT_EQ(fixed.size(), sg.len);
+}
+
+TEST(FixedCommandApduTest, case2eMaxLe) {
+    const FixedCommandApdu<0> fixed{CommandTemplate{0x80, 6, 7, 8, 0, 65536}};
+    const std::vector<uint8_t> expected{0x80, 6, 7, 8, 0, 0, 0};
+    ASSERT_EQ(expected.size(), fixed.size());
+    EXPECT_TRUE(std::equal(fixed.begin(), fixed.end(), expected.begin(), expected.end()));
+    EXPECT_EQ(65536u, fixed.le());
+}
+
+constexpr CommandTemplate kUpdate{0x80, 0xd6, 0, 0, 16, 0};
+
+TEST(FixedCommandApduTest, makeChecksAtCompileTime) {
+    auto fixed = android::makeFixedCommandApdu<16, kUpdate>(1);
+    ASSERT_EQ(16u, fixed.dataSize());
+    EXPECT_EQ(0x81, *fixed.begin());
+    EXPECT_EQ(4u + 1 + 16, fixed.size());
+}
+
+TEST(FixedCommandApduDeathTest, abortsWhenTheDataDoesNotFit) {
+    EXPECT_DEATH(FixedCommandApdu<8>{kUpdate}, "");
+}
+
+/* CommandSegments */
+
+TEST(CommandSegmentsTest, sendsTheDataInPlace) {
+    static constexpr CommandTemplate kRead{0x80, 6, 0, 0, 20, 16};
+    const std::array<uint8_t, 20> data{{1, 2, 3}};
+    const CommandSegments command{kRead, 1, data.data()};
+    ASSERT_EQ(3u, command.count());
+    const EseSgBuffer* sg = command.segments();
+    const std::vector<uint8_t> header{0x81, 6, 0, 0, 20};
+    ASSERT_EQ(header.size(), sg[0].len);
+    EXPECT_TRUE(std::equal(sg[0].c_base, sg[0].c_base + sg[0].len, header.begin()));
+    EXPECT_EQ(data.data(), sg[1].c_base);
+    EXPECT_EQ(data.size(), sg[1].len);
+    ASSERT_EQ(1u, sg[2].len);
+    EXPECT_EQ(16, sg[2].c_base[0]);
+}
+
+TEST(CommandSegmentsTest, headerOnly) {
+    static constexpr CommandTemplate kEraseAll{0x80, 0x0a, 0, 0};
+    const CommandSegments command{kEraseAll, 5, nullptr};
+    ASSERT_EQ(1u, command.count());
+    EXPECT_EQ(4u, command.segments()[0].len);
+    EXPECT_EQ(0xc1, command.segments()[0].c_base[0]);
+}
+
 /* ResponseApdu */
 
 TEST(ResponseApduTest, bad) {
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <esecpp/EseConnection.h>
+
+namespace android {
+
+int EseConnection::acquire() {
+    if (mOpen) {
+        // A sticky error means the interface needs a fresh open.
+        if (!mEse.error()) {
+            return 0;
+        }
+        close();
+    }
+    mEse.init();
+    const int res = mEse.open();
+    ++mOpens;
+    if (res < 0) {
+        mEse.close();
+        return res;
+    }
+    mOpen = true;
+    return 0;
+}
+
+void EseConnection::close() {
+    if (!mOpen) {
+        return;
+    }
+    if (mCloseHook) {
+        mCloseHook();
+    }
+    mEse.close();
+    mOpen = false;
+}
+
+} // namespace android
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <esecpp/ResponseCompletion.h>
+
+#include <algorithm>
+
+namespace android {
+namespace {
+
+constexpr uint8_t SW1_BYTES_AVAILABLE = 0x61;
+constexpr uint8_t SW1_WRONG_LE = 0x6c;
+constexpr uint8_t INS_GET_RESPONSE = 0xc0;
+constexpr uint32_t STATUS_SIZE = 2;
+constexpr uint32_t HEADER_SIZE = 4;
+constexpr uint32_t SHORT_LE_MAX = 256;
+
+// The interindustry CLA for the logical channel |cla| was sent on.
+uint8_t getResponseCla(const uint8_t cla) {
+    return (cla & 0x40) ? 0x40 | (cla & 0x0f) : cla & 0x03;
+}
+
+// Copies a short command into |out| with Le set to |le|. Returns false for
+// extended commands, which 6Cxx does not apply to.
+bool withLe(const uint8_t* tx, const uint32_t txLen, const uint8_t le, std::vector<uint8_t>& out) {
+    if (txLen < HEADER_SIZE) {
+        return false;
+    }
+    uint32_t bodyLen = HEADER_SIZE;
+    if (txLen > HEADER_SIZE + 1) {
+        const uint8_t lc = tx[HEADER_SIZE];
+        if (lc == 0 || txLen < HEADER_SIZE + 1 + lc || txLen > HEADER_SIZE + 1 + lc + 1) {
+            return false;
+        }
+        bodyLen = HEADER_SIZE + 1 + lc;
+    }
+    out.assign(tx, tx + bodyLen);
+    out.push_back(le);
+    return true;
+}
+
+bool statusIs(const uint8_t* rsp, const int len, const uint8_t sw1) {
+    return len >= static_cast<int>(STATUS_SIZE) && rsp[len - STATUS_SIZE] == sw1;
+}
+
+// Sends |tx| and, on 6Cxx, sends it again with the Le the card asked for.
+int transceiveCorrectingLe(::EseInterface* ese, const uint8_t* tx, const uint32_t txLen,
+                           uint8_t* rx, const uint32_t rxMax) {
+    const int ret = ese_transceive(ese, tx, txLen, rx, rxMax);
+    if (ret != static_cast<int>(STATUS_SIZE) || rx[0] != SW1_WRONG_LE) {
+        return ret;
+    }
+    std::vector<uint8_t> corrected;
+    if (!withLe(tx, txLen, rx[1], corrected)) {
+        return ret;
+    }
+    return ese_transceive(ese, corrected.data(), static_cast<uint32_t>(corrected.size()), rx,
+                          rxMax);
+}
+
+} // namespace
+
+int transceiveComplete(::EseInterface* ese, const uint8_t* tx, const uint32_t txLen, uint8_t* rx,
+                       const uint32_t rxMax) {
+    int ret = transceiveCorrectingLe(ese, tx, txLen, rx, rxMax);
+    if (ret < 0 || txLen == 0) {
+        return ret;
+    }
+
+    // Data already gathered into |rx|, ahead of the latest response.
+    uint32_t gathered = 0;
+    uint32_t getResponses = 0;
+    uint8_t getResponse[] = {getResponseCla(tx[0]), INS_GET_RESPONSE, 0x00, 0x00, 0x00};
+    while (statusIs(rx + gathered, ret, SW1_BYTES_AVAILABLE)) {
+        const uint32_t received = static_cast<uint32_t>(ret) - STATUS_SIZE;
+        // A GET RESPONSE that brings nothing would go on forever. Only the
+        // command's own reply may be a bare 61xx.
+        if (getResponses > 0 && received == 0) {
+            break;
+        }
+        gathered += received;
+        const uint32_t room = rxMax - gathered - STATUS_SIZE;
+        if (room == 0) {
+            return static_cast<int>(gathered + STATUS_SIZE);
+        }
+        const uint8_t available = rx[gathered + 1];
+        const uint32_t le = std::min(available == 0 ? SHORT_LE_MAX : available, room);
+        getResponse[sizeof(getResponse) - 1] = static_cast<uint8_t>(le);
+        ++getResponses;
+        ret = transceiveCorrectingLe(ese, getResponse, sizeof(getResponse), rx + gathered,
+                                     rxMax - gathered);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return static_cast<int>(gathered) + ret;
+}
+
+} // namespace android
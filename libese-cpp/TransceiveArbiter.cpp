@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <esecpp/TransceiveArbiter.h>
+
+namespace android {
+
+TransceiveArbiter::TransceiveArbiter(EseInterface& ese)
+        : mEse(ese), mWorker(&TransceiveArbiter::loop, this) {}
+
+TransceiveArbiter::~TransceiveArbiter() {
+    mStopping = true;
+    wake();
+    mWorker.join();
+}
+
+std::future<int> TransceiveArbiter::submit(Priority priority, Job job) {
+    Request* request = new Request{nullptr, std::move(job), std::promise<int>()};
+    std::future<int> result = request->result.get_future();
+    Queue& queue = mQueues[static_cast<size_t>(priority)];
+    Request* head = queue.head.load(std::memory_order_relaxed);
+    do {
+        request->next = head;
+    } while (!queue.head.compare_exchange_weak(head, request));
+    // Pairs with the worker setting mSleeping and then re-checking idle().
+    if (mSleeping) {
+        wake();
+    }
+    return result;
+}
+
+std::future<int> TransceiveArbiter::transceive(Priority priority, const std::vector<uint8_t>& tx,
+                                               std::vector<uint8_t>& rx) {
+    return submit(priority, [&tx, &rx](EseInterface& ese) { return ese.transceive(tx, rx); });
+}
+
+void TransceiveArbiter::setIdleTask(std::chrono::milliseconds after, IdleTask task) {
+    std::lock_guard<std::mutex> lock(mParkLock);
+    mIdleAfter = after;
+    mIdleTask = std::move(task);
+}
+
+bool TransceiveArbiter::idle() const {
+    for (const Queue& queue : mQueues) {
+        if (queue.pending != nullptr || queue.head.load() != nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TransceiveArbiter::wake() {
+    std::lock_guard<std::mutex> lock(mParkLock);
+    mSleeping = false;
+    mPark.notify_one();
+}
+
+TransceiveArbiter::Request* TransceiveArbiter::next() {
+    size_t chosen = kPriorities;
+    for (size_t i = 0; i < kPriorities; ++i) {
+        Queue& queue = mQueues[i];
+        if (queue.pending == nullptr) {
+            // Take everything pushed so far and put it back in arrival order.
+            Request* taken = queue.head.exchange(nullptr, std::memory_order_acquire);
+            while (taken != nullptr) {
+                Request* next = taken->next;
+                taken->next = queue.pending;
+                queue.pending = taken;
+                taken = next;
+            }
+        }
+        if (queue.pending == nullptr) {
+            continue;
+        }
+        if (chosen == kPriorities) {
+            chosen = i;
+        } else if (queue.skips >= kMaxSkips && mQueues[chosen].skips < kMaxSkips) {
+            chosen = i;
+        }
+    }
+    if (chosen == kPriorities) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < kPriorities; ++i) {
+        if (i != chosen && mQueues[i].pending != nullptr) {
+            ++mQueues[i].skips;
+        }
+    }
+    Queue& queue = mQueues[chosen];
+    queue.skips = 0;
+    Request* request = queue.pending;
+    queue.pending = request->next;
+    return request;
+}
+
+void TransceiveArbiter::loop() {
+    bool idleTaskDue = false;
+    while (true) {
+        Request* request = next();
+        if (request != nullptr) {
+            request->result.set_value(request->job(mEse));
+            delete request;
+            idleTaskDue = true;
+            continue;
+        }
+        if (mStopping) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mParkLock);
+        mSleeping = true;
+        if (!idle() || mStopping) {
+            mSleeping = false;
+            continue;
+        }
+        if (idleTaskDue && mIdleTask) {
+            if (!mPark.wait_for(lock, mIdleAfter, [this] { return !mSleeping; })) {
+                mSleeping = false;
+                idleTaskDue = false;
+                IdleTask task = mIdleTask;
+                lock.unlock();
+                task(mEse);
+            }
+            continue;
+        }
+        mPark.wait(lock, [this] { return !mSleeping; });
+    }
+}
+
+} // namespace android
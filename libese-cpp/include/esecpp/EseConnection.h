@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ESECPP_ESE_CONNECTION_H_
+#define ESECPP_ESE_CONNECTION_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include <esecpp/EseInterface.h>
+
+namespace android {
+
+/**
+ * Keeps an EseInterface open from one request to the next so that a burst
+ * of requests pays for a single power-up and end-of-session cooldown.
+ *
+ * Requests call acquire(), which only opens the interface if it is not
+ * open already. The owner calls close() once nothing has used the
+ * interface for idleWindow(), e.g. from TransceiveArbiter::setIdleTask(),
+ * so the chip is still powered down whenever the device is idle.
+ *
+ * Not thread safe: use from the thread which has the eSE to itself.
+ */
+class EseConnection {
+public:
+    EseConnection(EseInterface& ese, std::chrono::milliseconds idleWindow)
+            : mEse(ese), mIdleWindow(idleWindow) {}
+    ~EseConnection() { close(); }
+
+    EseConnection(const EseConnection&) = delete;
+    EseConnection& operator=(const EseConnection&) = delete;
+
+    /** Opens the interface unless it is open. Returns 0 or open()'s error. */
+    int acquire();
+
+    /** Runs the close hook and closes the interface if it is open. */
+    void close();
+
+    /**
+     * |hook| runs with the interface still open just before it is closed,
+     * e.g. to release state held on the card.
+     */
+    void setCloseHook(std::function<void()> hook) { mCloseHook = std::move(hook); }
+
+    bool isOpen() const { return mOpen; }
+    std::chrono::milliseconds idleWindow() const { return mIdleWindow; }
+    /** The number of times the interface has been opened. */
+    uint32_t opens() const { return mOpens; }
+
+    EseInterface& ese() { return mEse; }
+
+private:
+    EseInterface& mEse;
+    const std::chrono::milliseconds mIdleWindow;
+    std::function<void()> mCloseHook;
+    bool mOpen = false;
+    uint32_t mOpens = 0;
+};
+
+} // namespace android
+
+#endif // ESECPP_ESE_CONNECTION_H_
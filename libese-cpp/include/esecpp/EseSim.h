@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ESECPP_ESE_SIM_H_
+#define ESECPP_ESE_SIM_H_
+
+#include <esecpp/EseInterface.h>
+#include <ese/hw/sim/sim.h>
+
+namespace android {
+
+/**
+ * The in-process simulated card from libese-hw-sim, for tests and benchmarks
+ * which need the whole host stack without hardware.
+ */
+struct EseSim : public EseInterface {
+    EseSim() : mConfig() {}
+    explicit EseSim(const EseSimConfig& config) : mConfig(config) {}
+    ~EseSim() { close(); }
+
+    void init() override;
+    int open() override;
+    void close() override;
+
+    /** Used by the next open(). */
+    EseSimConfig& config() { return mConfig; }
+
+    /** The card's counters, or nullptr while it is closed. */
+    const EseSimStats* stats() const;
+
+private:
+    EseSimConfig mConfig;
+    bool mOpen = false;
+};
+
+} // namespace android
+
+#endif // ESECPP_ESE_SIM_H_
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ESECPP_RESPONSE_COMPLETION_H_
+#define ESECPP_RESPONSE_COMPLETION_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <esecpp/EseInterface.h>
+
+namespace android {
+
+/**
+ * Sends a command APDU and completes its response, for callers which opt in
+ * rather than handling 61xx and 6Cxx themselves:
+ *
+ *  - 6Cxx resends a short command with Le set to xx.
+ *  - 61xx fetches the rest with GET RESPONSE on the command's logical
+ *    channel, for as long as the card has more.
+ *
+ * Each piece is received straight into |rx| after the data before it, so
+ * |rx| ends up holding all of the data and the final status word, as if the
+ * card had sent it in one response. If |rx| fills up first, the data so far
+ * is returned with the 61xx status which says how much is left.
+ *
+ * The exchanges must not be interleaved with other commands on the same
+ * channel: under a TransceiveArbiter, make them from a single job.
+ *
+ * Returns the number of bytes in |rx| or -1 if a transceive failed.
+ */
+int transceiveComplete(::EseInterface* ese, const uint8_t* tx, uint32_t txLen, uint8_t* rx,
+                       uint32_t rxMax);
+
+/** As above, into the whole of |rx|. */
+inline int transceiveComplete(EseInterface& ese, const std::vector<uint8_t>& tx,
+                              std::vector<uint8_t>& rx) {
+    return transceiveComplete(ese.ese_interface(), tx.data(), static_cast<uint32_t>(tx.size()),
+                              rx.data(), static_cast<uint32_t>(rx.size()));
+}
+
+} // namespace android
+
+#endif // ESECPP_RESPONSE_COMPLETION_H_
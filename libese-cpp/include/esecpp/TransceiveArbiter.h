@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ESECPP_TRANSCEIVE_ARBITER_H_
+#define ESECPP_TRANSCEIVE_ARBITER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <esecpp/EseInterface.h>
+
+namespace android {
+
+/**
+ * Shares one EseInterface between many threads.
+ *
+ * Requests are pushed onto a lock-free queue per priority class and run one
+ * at a time, in submission order within a class, by a single worker thread
+ * which is the only thread to touch the interface. A request is a job
+ * rather than a single APDU so that a whole applet session (select, commands,
+ * close) runs without being interleaved with another caller's.
+ *
+ * Higher classes are served first, but a waiting class is never passed over
+ * more than kMaxSkips times in a row, so bulk work cannot be starved.
+ */
+class TransceiveArbiter {
+public:
+    enum class Priority : uint8_t {
+        CRITICAL = 0,  // e.g. Weaver reads gating an unlock
+        NORMAL,
+        BULK,          // e.g. metadata uploads
+    };
+    static constexpr size_t kPriorities = 3;
+    static constexpr uint32_t kMaxSkips = 4;
+
+    using Job = std::function<int(EseInterface&)>;
+    using IdleTask = std::function<void(EseInterface&)>;
+
+    explicit TransceiveArbiter(EseInterface& ese);
+    /** Runs any requests already submitted, then stops the worker. */
+    ~TransceiveArbiter();
+
+    TransceiveArbiter(const TransceiveArbiter&) = delete;
+    TransceiveArbiter& operator=(const TransceiveArbiter&) = delete;
+
+    /** Queues |job|; the future holds its return value. */
+    std::future<int> submit(Priority priority, Job job);
+
+    /** Queues a single APDU. |tx| and |rx| must outlive the future. */
+    std::future<int> transceive(Priority priority, const std::vector<uint8_t>& tx,
+                                std::vector<uint8_t>& rx);
+
+    /** Blocks until |job| has run. Must not be called from within a job. */
+    int run(Priority priority, Job job) { return submit(priority, std::move(job)).get(); }
+
+    /**
+     * Runs |task| on the worker once nothing has been submitted for |after|
+     * since the last request finished, e.g. to release resources held
+     * between requests. It runs at most once per burst of requests.
+     */
+    void setIdleTask(std::chrono::milliseconds after, IdleTask task);
+
+private:
+    struct Request {
+        Request* next;
+        Job job;
+        std::promise<int> result;
+    };
+
+    struct Queue {
+        // Pushed by any thread, newest first.
+        std::atomic<Request*> head{nullptr};
+        // Owned by the worker, oldest first.
+        Request* pending = nullptr;
+        uint32_t skips = 0;
+    };
+
+    Request* next();
+    bool idle() const;
+    void wake();
+    void loop();
+
+    EseInterface& mEse;
+    Queue mQueues[kPriorities];
+    std::atomic<bool> mStopping{false};
+    std::atomic<bool> mSleeping{false};
+    std::mutex mParkLock;
+    std::condition_variable mPark;
+    // Guarded by mParkLock.
+    std::chrono::milliseconds mIdleAfter{0};
+    IdleTask mIdleTask;
+    std::thread mWorker;
+};
+
+} // namespace android
+
+#endif // ESECPP_TRANSCEIVE_ARBITER_H_
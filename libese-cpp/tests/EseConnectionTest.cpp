@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <esecpp/EseConnection.h>
+#include <esecpp/TransceiveArbiter.h>
+
+using namespace std::chrono_literals;
+
+namespace android {
+namespace {
+
+// Counts power cycles; open() fails while |failOpen| is set.
+struct PowerEse : public EseInterface {
+    void init() override {}
+    int open() override {
+        ++opens;
+        powered = !failOpen;
+        return failOpen ? -1 : 0;
+    }
+    void close() override {
+        powered = false;
+        stickyError = false;
+    }
+    bool error() override { return stickyError; }
+    std::atomic<bool> powered{false};
+    std::atomic<int> opens{0};
+    bool failOpen = false;
+    bool stickyError = false;
+};
+
+class EseConnectionTest : public ::testing::Test {
+protected:
+    PowerEse mEse;
+    EseConnection mConnection{mEse, 20ms};
+};
+
+} // namespace
+
+TEST_F(EseConnectionTest, OpensOncePerBurst) {
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(0, mConnection.acquire());
+    }
+    EXPECT_EQ(1, mEse.opens);
+    EXPECT_EQ(1u, mConnection.opens());
+    mConnection.close();
+    EXPECT_FALSE(mEse.powered);
+    EXPECT_EQ(0, mConnection.acquire());
+    EXPECT_EQ(2, mEse.opens);
+}
+
+TEST_F(EseConnectionTest, CloseHookRunsBeforePowerDown) {
+    int calls = 0;
+    mConnection.setCloseHook([&] {
+        EXPECT_TRUE(mEse.powered);
+        ++calls;
+    });
+    mConnection.close();
+    EXPECT_EQ(0, calls);
+    ASSERT_EQ(0, mConnection.acquire());
+    mConnection.close();
+    mConnection.close();
+    EXPECT_EQ(1, calls);
+}
+
+TEST_F(EseConnectionTest, ErrorForcesReopen) {
+    ASSERT_EQ(0, mConnection.acquire());
+    mEse.stickyError = true;
+    EXPECT_EQ(0, mConnection.acquire());
+    EXPECT_EQ(2, mEse.opens);
+    EXPECT_TRUE(mEse.powered);
+}
+
+TEST_F(EseConnectionTest, FailedOpenStaysClosed) {
+    mEse.failOpen = true;
+    EXPECT_EQ(-1, mConnection.acquire());
+    EXPECT_FALSE(mConnection.isOpen());
+    mEse.failOpen = false;
+    EXPECT_EQ(0, mConnection.acquire());
+    EXPECT_TRUE(mConnection.isOpen());
+}
+
+TEST_F(EseConnectionTest, ArbiterIdleTaskPowersDown) {
+    TransceiveArbiter arbiter{mEse};
+    arbiter.setIdleTask(mConnection.idleWindow(),
+                        [this](EseInterface&) { mConnection.close(); });
+    const auto request = [this](EseInterface&) { return mConnection.acquire(); };
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(0, arbiter.run(TransceiveArbiter::Priority::NORMAL, request));
+    }
+    EXPECT_EQ(1, mEse.opens);
+    for (int i = 0; i < 100 && mEse.powered; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    EXPECT_FALSE(mEse.powered);
+    EXPECT_EQ(0, arbiter.run(TransceiveArbiter::Priority::NORMAL, request));
+    EXPECT_EQ(2, mEse.opens);
+}
+
+} // namespace android
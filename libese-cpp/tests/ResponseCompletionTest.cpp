@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <esecpp/EseSim.h>
+#include <esecpp/ResponseCompletion.h>
+
+namespace android {
+namespace {
+
+constexpr uint8_t INS_GET_DATA = 0xca;
+constexpr uint8_t INS_READ = 0xb0;
+constexpr uint8_t INS_GET_RESPONSE = 0xc0;
+
+// Holds |mData| and hands it out the way cards on short APDUs do: GET DATA
+// wants Le to match it exactly (6Cxx otherwise), READ answers with the first
+// |mChunk| bytes and 61xx, and GET RESPONSE gives out up to Le more.
+class SplittingCard {
+public:
+    SplittingCard(size_t size, size_t chunk) : mData(size), mChunk(chunk) {
+        for (size_t i = 0; i < size; ++i) {
+            mData[i] = static_cast<uint8_t>(i * 7);
+        }
+    }
+
+    void attach(EseSimConfig& config) {
+        config.handler = &SplittingCard::handle;
+        config.handler_ctx = this;
+    }
+
+    const std::vector<uint8_t>& data() const { return mData; }
+
+    std::vector<uint8_t> mClas;
+    std::vector<uint8_t> mIns;
+    bool mStall = false;
+
+private:
+    static uint32_t handle(void* ctx, const uint8_t* cmd, uint32_t cmdLen, uint8_t* rsp,
+                           uint32_t) {
+        return static_cast<SplittingCard*>(ctx)->process(cmd, cmdLen, rsp);
+    }
+
+    uint32_t process(const uint8_t* cmd, uint32_t cmdLen, uint8_t* rsp) {
+        mClas.push_back(cmd[0]);
+        mIns.push_back(cmd[1]);
+        const size_t le = cmdLen == 5 ? (cmd[4] == 0 ? 256 : cmd[4]) : 0;
+        switch (cmd[1]) {
+        case INS_GET_DATA:
+            if (le != mData.size()) {
+                return status(rsp, 0x6c, static_cast<uint8_t>(mData.size()));
+            }
+            mSent = 0;
+            return send(rsp, le);
+        case INS_READ:
+            mSent = 0;
+            return send(rsp, mChunk);
+        case INS_GET_RESPONSE:
+            return send(rsp, mStall ? 0 : le);
+        default:
+            return status(rsp, 0x6d, 0x00);
+        }
+    }
+
+    uint32_t send(uint8_t* rsp, size_t max) {
+        const size_t len = std::min(max, mData.size() - mSent);
+        std::memcpy(rsp, mData.data() + mSent, len);
+        mSent += len;
+        const size_t left = mData.size() - mSent;
+        if (left == 0) {
+            return len + status(rsp + len, 0x90, 0x00);
+        }
+        return len + status(rsp + len, 0x61, static_cast<uint8_t>(std::min<size_t>(left, 256)));
+    }
+
+    static uint32_t status(uint8_t* rsp, uint8_t sw1, uint8_t sw2) {
+        rsp[0] = sw1;
+        rsp[1] = sw2;
+        return 2;
+    }
+
+    std::vector<uint8_t> mData;
+    size_t mChunk;
+    size_t mSent = 0;
+};
+
+class ResponseCompletionTest : public ::testing::Test {
+protected:
+    void start(SplittingCard& card) {
+        card.attach(mEse.config());
+        mEse.init();
+        ASSERT_EQ(0, mEse.open());
+    }
+
+    // Checks |rx| holds all of |card|'s data and 9000.
+    void expectComplete(const SplittingCard& card, const std::vector<uint8_t>& rx, int len) {
+        ASSERT_EQ(static_cast<int>(card.data().size() + 2), len);
+        EXPECT_TRUE(std::equal(card.data().begin(), card.data().end(), rx.begin()));
+        EXPECT_EQ(0x90, rx[len - 2]);
+        EXPECT_EQ(0x00, rx[len - 1]);
+    }
+
+    EseSim mEse;
+};
+
+} // namespace
+
+TEST_F(ResponseCompletionTest, PassesCompleteResponsesThrough) {
+    SplittingCard card(100, 100);
+    start(card);
+    std::vector<uint8_t> rx(300);
+    const int len = transceiveComplete(mEse, {0x00, INS_READ, 0x00, 0x00, 0x00}, rx);
+    expectComplete(card, rx, len);
+    EXPECT_EQ(1u, card.mIns.size());
+}
+
+TEST_F(ResponseCompletionTest, GathersGetResponses) {
+    SplittingCard card(1000, 200);
+    start(card);
+    std::vector<uint8_t> rx(1002);
+    const int len = transceiveComplete(mEse, {0x00, INS_READ, 0x00, 0x00, 0x00}, rx);
+    expectComplete(card, rx, len);
+    // 800 bytes after the first 200: 256 + 256 + 256 + 32.
+    const std::vector<uint8_t> expected{INS_READ, INS_GET_RESPONSE, INS_GET_RESPONSE,
+                                        INS_GET_RESPONSE, INS_GET_RESPONSE};
+    EXPECT_EQ(expected, card.mIns);
+}
+
+TEST_F(ResponseCompletionTest, CorrectsLe) {
+    SplittingCard card(20, 20);
+    start(card);
+    std::vector<uint8_t> rx(258);
+    const int len = transceiveComplete(mEse, {0x00, INS_GET_DATA, 0x00, 0x00, 0x00}, rx);
+    expectComplete(card, rx, len);
+    EXPECT_EQ(2u, card.mIns.size());
+}
+
+TEST_F(ResponseCompletionTest, StopsWhenTheBufferIsFull) {
+    SplittingCard card(1000, 200);
+    start(card);
+    std::vector<uint8_t> rx(300);
+    const int len = transceiveComplete(mEse, {0x00, INS_READ, 0x00, 0x00, 0x00}, rx);
+    ASSERT_EQ(300, len);
+    EXPECT_TRUE(std::equal(rx.begin(), rx.begin() + 298, card.data().begin()));
+    EXPECT_EQ(0x61, rx[298]);
+}
+
+TEST_F(ResponseCompletionTest, StaysOnTheCommandsChannel) {
+    SplittingCard card(300, 10);
+    start(card);
+    std::vector<uint8_t> rx(302);
+    expectComplete(card, rx,
+                   transceiveComplete(mEse, {0x82, INS_READ, 0x00, 0x00, 0x00}, rx));
+    expectComplete(card, rx,
+                   transceiveComplete(mEse, {0xc5, INS_READ, 0x00, 0x00, 0x00}, rx));
+    const std::vector<uint8_t> expected{0x82, 0x02, 0x02, 0xc5, 0x45, 0x45};
+    EXPECT_EQ(expected, card.mClas);
+}
+
+TEST_F(ResponseCompletionTest, GivesUpWhenNothingArrives) {
+    SplittingCard card(1000, 200);
+    card.mStall = true;
+    start(card);
+    std::vector<uint8_t> rx(1002);
+    const int len = transceiveComplete(mEse, {0x00, INS_READ, 0x00, 0x00, 0x00}, rx);
+    ASSERT_EQ(202, len);
+    EXPECT_EQ(0x61, rx[200]);
+    EXPECT_EQ(2u, card.mIns.size());
+}
+
+TEST_F(ResponseCompletionTest, FollowsABare61xx) {
+    SplittingCard card(300, 0);
+    start(card);
+    std::vector<uint8_t> rx(302);
+    const int len = transceiveComplete(mEse, {0x00, INS_READ, 0x00, 0x00, 0x00}, rx);
+    expectComplete(card, rx, len);
+    const std::vector<uint8_t> expected{INS_READ, INS_GET_RESPONSE, INS_GET_RESPONSE};
+    EXPECT_EQ(expected, card.mIns);
+}
+
+TEST_F(ResponseCompletionTest, GivesUpWhenABare61xxNeverFills) {
+    SplittingCard card(1000, 0);
+    card.mStall = true;
+    start(card);
+    std::vector<uint8_t> rx(1002);
+    const int len = transceiveComplete(mEse, {0x00, INS_READ, 0x00, 0x00, 0x00}, rx);
+    ASSERT_EQ(2, len);
+    EXPECT_EQ(0x61, rx[0]);
+    EXPECT_EQ(2u, card.mIns.size());
+}
+
+} // namespace android
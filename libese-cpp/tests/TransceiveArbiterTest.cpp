@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <esecpp/TransceiveArbiter.h>
+
+namespace android {
+namespace {
+
+using Priority = TransceiveArbiter::Priority;
+
+// Echoes the command and fails the test if it is ever entered concurrently.
+struct ExclusiveEse : public EseInterface {
+    void init() override {}
+    int open() override { return 0; }
+    void close() override {}
+    int transceive(const std::vector<uint8_t>& tx, std::vector<uint8_t>& rx) override {
+        EXPECT_FALSE(busy.exchange(true));
+        std::copy(tx.begin(), tx.end(), rx.begin());
+        ++calls;
+        busy = false;
+        return static_cast<int>(tx.size());
+    }
+    std::atomic<bool> busy{false};
+    std::atomic<int> calls{0};
+};
+
+class TransceiveArbiterTest : public ::testing::Test {
+protected:
+    // Holds the worker inside a job until release() so that the order of the
+    // requests queued behind it is decided by the arbiter alone.
+    void hold() {
+        mHeld = mArbiter.submit(Priority::NORMAL, [this](EseInterface&) {
+            mGate.get_future().wait();
+            return 0;
+        });
+    }
+    void release() {
+        mGate.set_value();
+        mHeld.wait();
+    }
+    std::future<int> record(Priority priority, int tag) {
+        return mArbiter.submit(priority, [this, tag](EseInterface&) {
+            mOrder.push_back(tag);
+            return tag;
+        });
+    }
+
+    ExclusiveEse mEse;
+    TransceiveArbiter mArbiter{mEse};
+    std::promise<void> mGate;
+    std::future<int> mHeld;
+    std::vector<int> mOrder;
+};
+
+} // namespace
+
+TEST_F(TransceiveArbiterTest, HigherClassesRunFirst) {
+    hold();
+    std::vector<std::future<int>> results;
+    results.push_back(record(Priority::BULK, 1));
+    results.push_back(record(Priority::NORMAL, 2));
+    results.push_back(record(Priority::BULK, 3));
+    results.push_back(record(Priority::CRITICAL, 4));
+    results.push_back(record(Priority::CRITICAL, 5));
+    release();
+    for (auto& result : results) {
+        result.wait();
+    }
+    EXPECT_EQ(std::vector<int>({4, 5, 2, 1, 3}), mOrder);
+    EXPECT_EQ(2, results[1].get());
+}
+
+TEST_F(TransceiveArbiterTest, LowerClassesAreNotStarved) {
+    hold();
+    std::vector<std::future<int>> results;
+    results.push_back(record(Priority::BULK, 0));
+    for (int i = 1; i <= 8; ++i) {
+        results.push_back(record(Priority::CRITICAL, i));
+    }
+    release();
+    for (auto& result : results) {
+        result.wait();
+    }
+    ASSERT_EQ(9u, mOrder.size());
+    EXPECT_EQ(0, mOrder[TransceiveArbiter::kMaxSkips]);
+}
+
+TEST_F(TransceiveArbiterTest, SerializesConcurrentCallers) {
+    constexpr int kThreads = 8;
+    constexpr int kRequests = 200;
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{0};
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([this, t, &mismatches] {
+            const auto priority = static_cast<Priority>(t % TransceiveArbiter::kPriorities);
+            for (int i = 0; i < kRequests; ++i) {
+                const std::vector<uint8_t> tx = {0x80, 0xca, static_cast<uint8_t>(t),
+                                                 static_cast<uint8_t>(i)};
+                std::vector<uint8_t> rx(tx.size());
+                if (mArbiter.transceive(priority, tx, rx).get() != 4 || rx != tx) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(0, mismatches.load());
+    EXPECT_EQ(kThreads * kRequests, mEse.calls.load());
+}
+
+TEST_F(TransceiveArbiterTest, IdleTaskRunsOncePerBurst) {
+    std::atomic<int> idles{0};
+    mArbiter.setIdleTask(std::chrono::milliseconds(20), [&idles](EseInterface&) { ++idles; });
+    for (int burst = 0; burst < 2; ++burst) {
+        for (int i = 0; i < 3; ++i) {
+            record(Priority::NORMAL, i).wait();
+        }
+        EXPECT_EQ(burst, idles.load());
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        EXPECT_EQ(burst + 1, idles.load());
+    }
+}
+
+} // namespace android
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Stresses one echo eSE from many threads. One thread issues single-APDU
+ * critical requests while the rest issue four-APDU bulk sessions. Compares
+ * a plain mutex, which is what a one-thread binder pool amounts to, with the
+ * arbiter, and reports the mean latency of each class.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <esecpp/TransceiveArbiter.h>
+
+ESE_INCLUDE_HW(ESE_HW_ECHO);
+
+namespace android {
+namespace {
+
+using Priority = TransceiveArbiter::Priority;
+
+constexpr int kRequestsPerThread = 4;
+constexpr int kBulkApdus = 4;
+
+struct EchoEse : public EseInterface {
+    ~EchoEse() { close(); }
+    void init() override {
+        mEse = new ::EseInterface;
+        ese_init(mEse, ESE_HW_ECHO);
+    }
+    int open() override { return ese_open(mEse, nullptr); }
+    void close() override {
+        if (mEse != nullptr) {
+            ese_close(mEse);
+            delete mEse;
+            mEse = nullptr;
+        }
+    }
+};
+
+int Session(EseInterface& ese, int apdus) {
+    const std::vector<uint8_t> tx = {0x80, 0xca, 0x00, 0x00, 0x00};
+    std::vector<uint8_t> rx(16);
+    int ret = 0;
+    for (int i = 0; i < apdus && ret >= 0; ++i) {
+        ret = ese.transceive(tx, rx);
+    }
+    return ret;
+}
+
+struct Latency {
+    std::atomic<int64_t> totalUs{0};
+    std::atomic<int64_t> count{0};
+    void add(std::chrono::steady_clock::duration d) {
+        totalUs += std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        ++count;
+    }
+    double meanMs() const { return count ? totalUs / 1000.0 / count : 0.0; }
+};
+
+// |submit(priority, apdus)| runs one request to completion.
+template <typename Submit>
+void Stress(benchmark::State& state, Submit submit) {
+    const int threads = static_cast<int>(state.range(0));
+    Latency critical, bulk;
+    for (auto _ : state) {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                const bool isCritical = t == 0;
+                for (int i = 0; i < kRequestsPerThread; ++i) {
+                    const auto start = std::chrono::steady_clock::now();
+                    submit(isCritical ? Priority::CRITICAL : Priority::BULK,
+                           isCritical ? 1 : kBulkApdus);
+                    (isCritical ? critical : bulk).add(std::chrono::steady_clock::now() - start);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    state.counters["critical_ms"] = critical.meanMs();
+    state.counters["bulk_ms"] = bulk.meanMs();
+}
+
+void BM_MutexStress(benchmark::State& state) {
+    EchoEse ese;
+    ese.init();
+    ese.open();
+    std::mutex lock;
+    Stress(state, [&](Priority, int apdus) {
+        std::lock_guard<std::mutex> guard(lock);
+        return Session(ese, apdus);
+    });
+}
+BENCHMARK(BM_MutexStress)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+void BM_ArbiterStress(benchmark::State& state) {
+    EchoEse ese;
+    ese.init();
+    ese.open();
+    TransceiveArbiter arbiter(ese);
+    Stress(state, [&](Priority priority, int apdus) {
+        return arbiter.run(priority, [apdus](EseInterface& e) { return Session(e, apdus); });
+    });
+}
+BENCHMARK(BM_ArbiterStress)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
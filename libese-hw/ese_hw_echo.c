@@ -31,12 +31,14 @@ struct EchoState {
   int recvd;
 };
 
-#define ECHO_STATE(ese) (*(struct EchoState **)(&ese->pad[1]))
+/* The front of pad[] holds the struct Teq1CardState. */
+#define ECHO_STATE(ese) \
+  (*(struct EchoState **)(&ese->pad[ESE_INTERFACE_STATE_PAD / 2]))
 
 static int echo_open(struct EseInterface *ese, void *hw_opts) {
   struct EchoState *es = hw_opts; /* shorter than __attribute */
   struct EchoState **es_ptr;
-  if (sizeof(ese->pad) < sizeof(struct EchoState *)) {
+  if (sizeof(ese->pad) / 2 < sizeof(struct EchoState *)) {
     /* This is a compile-time correctable error only. */
     ALOGE("Pad size too small to use Echo HW (%zu < %zu)", sizeof(ese->pad),
           sizeof(struct EchoState *));
@@ -128,28 +130,15 @@ static int echo_poll(struct EseInterface *ese, uint8_t poll_for, float timeout,
   return -1;
 }
 
-int echo_preprocess(const struct Teq1ProtocolOptions *const opts,
-                    struct Teq1Frame *frame, int tx) {
-  if (tx) {
-    /* Recompute the LRC with the NAD of 0x00 */
-    frame->header.NAD = 0x00;
-    frame->INF[frame->header.LEN] = teq1_compute_LRC(frame);
-    frame->header.NAD = opts->node_address;
-    ALOGV("interface is preprocessing outbound frame");
-  } else {
-    /* Replace the NAD with 0x00 so the LRC check passes. */
-    frame->header.NAD = 0x00;
-    ALOGV("interface is preprocessing inbound frame");
-  }
-  return 0;
-}
-
 static const struct Teq1ProtocolOptions kTeq1Options = {
     .host_address = 0xAA,
     .node_address = 0xBB,
     .bwt = 3.14152f,
     .etu = 1.0f,
-    .preprocess = &echo_preprocess,
+    .preprocess = NULL,
+    /* The echo card checks the LRC with a NAD of 0x00. */
+    .lrc_nad_override = true,
+    .lrc_nad = 0x00,
 };
 
 uint32_t echo_transceive(struct EseInterface *ese,
@@ -27,4 +27,6 @@ static const struct NxpSpiBoard nxp_boards_hikey_spidev = {
   .mode = 0,
   .bits = 8,
   .speed = 1000000L,
+  .poll_delay_usecs = 0,
+  .emulated = 0,
 };
@@ -27,6 +27,42 @@ struct NxpState {
   void *handle;
 };
 
+/* Bytes read past the start-of-frame NAD, waiting to be received. */
+#define NXP_PN80T_READ_AHEAD_SIZE (TEQ1FRAME_SIZE)
+struct NxpReadAhead {
+  uint32_t start;
+  uint32_t end;
+  uint8_t buf[NXP_PN80T_READ_AHEAD_SIZE];
+};
+
+/* Running estimate of the response time for one CLA/INS. */
+struct NxpPollStat {
+  uint16_t key;
+  uint8_t samples;
+  /* Polls the last exchange took; the estimate is for the last of them. */
+  uint8_t polls;
+  uint32_t expect_usec;
+};
+
+/* Response time estimates, hashed on CLA/INS with the channel bits masked. */
+#define NXP_PN80T_POLL_STATS_SLOTS 32
+struct NxpPollStats {
+  struct NxpPollStat slots[NXP_PN80T_POLL_STATS_SLOTS];
+  /* 1 + the slot of the command being exchanged, or 0. */
+  uint32_t pending;
+  /* Polls so far in the exchange and how long the latest one took. */
+  uint32_t polls;
+  uint32_t sample_usec;
+};
+
+/* What nxp_pn80t_close() left behind, for the next nxp_pn80t_open(). */
+struct NxpPowerState {
+  /* Non-zero while the eSE is left powered for its cooldown timers. */
+  uint32_t powered;
+  /* ese_monotonic_usec() at which the longest cooldown timer expires. */
+  uint64_t cooldown_end_usec;
+};
+
 /* pad[0] is reserved for T=1. Lazily go to the middle. */
 #define NXP_PN80T_STATE(ese)                                                   \
   ((struct NxpState *)(&ese->pad[ESE_INTERFACE_STATE_PAD / 2]))
@@ -35,9 +71,15 @@ void nxp_pn80t_close(struct EseInterface *ese);
 uint32_t nxp_pn80t_transceive(struct EseInterface *ese,
                               const struct EseSgBuffer *tx_buf, uint32_t tx_len,
                               struct EseSgBuffer *rx_buf, uint32_t rx_len);
+uint32_t nxp_pn80t_transceive_batch(struct EseInterface *ese,
+                                    struct EseBatchEntry *entries,
+                                    uint32_t count);
 int nxp_pn80t_poll(struct EseInterface *ese, uint8_t poll_for, float timeout,
                    int complete);
 int nxp_pn80t_reset(struct EseInterface *ese);
+/* Copies up to |len| buffered bytes into |buf|. Returns the bytes copied. */
+uint32_t nxp_pn80t_read_ahead(struct EseInterface *ese, uint8_t *buf,
+                              uint32_t len);
 int nxp_pn80t_open(struct EseInterface *ese, void *board);
 
 enum NxpPn80tError {
@@ -21,6 +21,13 @@ typedef void *(pn80t_platform_initialize_t)(void *);
 typedef int (pn80t_platform_release_t)(void *);
 typedef int (pn80t_platform_toggle_t)(void *, int);
 typedef int (pn80t_platform_wait_t)(void *, long usec);
+typedef int (pn80t_platform_wait_for_data_t)(void *, long *usec);
+struct NxpReadAhead;
+typedef struct NxpReadAhead *(pn80t_platform_read_ahead_t)(void *);
+struct NxpPollStats;
+typedef struct NxpPollStats *(pn80t_platform_poll_stats_t)(void *);
+struct NxpPowerState;
+typedef struct NxpPowerState *(pn80t_platform_power_state_t)(void *);
 
 /* Pn80tPlatform
  *
@@ -46,6 +53,31 @@ struct Pn80tPlatform {
   pn80t_platform_toggle_t *const toggle_bootloader;  /* CLEAR_N */
   /* Required: provides a usleep() equivalent. */
   pn80t_platform_wait_t *const wait;
+  /* Optional: blocks until the eSE has data to read or |*usec| elapses.
+   * On return, |*usec| holds the unused portion of the timeout.
+   * Returns 1 when data is readable, 0 on timeout, and < 0 on error.
+   * If NULL, polling falls back to reading one byte per |wait| interval.
+   */
+  pn80t_platform_wait_for_data_t *const wait_for_data;
+  /* Optional: returns a read-ahead buffer owned by the handle.
+   * If provided, polling reads a few bytes per attempt and, once the NAD
+   * appears, the rest of the frame sized from its LEN. The platform's
+   * hw_receive must drain nxp_pn80t_read_ahead() first.
+   */
+  pn80t_platform_read_ahead_t *const read_ahead;
+  /* Optional: returns zero-initialized poll statistics owned by the handle.
+   * If provided, polling is scheduled around the response time last seen
+   * for the command's CLA/INS instead of at a fixed interval.
+   */
+  pn80t_platform_poll_stats_t *const poll_stats;
+  /* Optional: returns zero-initialized power state which outlives the handle,
+   * e.g. one per device.
+   * If provided, a close which leaves the eSE powered for its cooldown timers
+   * is remembered, and an open before the cooldown ends probes the eSE with
+   * an S(RESYNC) instead of starting over. If the probe goes unanswered, the
+   * open carries on as if the eSE were cold, without pulsing reset.
+   */
+  pn80t_platform_power_state_t *const power_state;
 };
 
 #endif
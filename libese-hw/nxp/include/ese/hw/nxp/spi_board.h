@@ -24,13 +24,24 @@ typedef enum {
   kBoardGpioMax,
 } BoardGpio;
 
-/* Allow GPIO assignment and configuration to vary without a new device definition. */
+/* Allow GPIO assignment and configuration to vary without a new device definition.
+ *
+ * |dev_path| may name any node speaking the spidev ioctl interface.  Set
+ * |emulated| for a userspace emulation: the mode, bits and speed ioctls are
+ * then skipped, as such nodes need not implement them.
+ *
+ * |poll_delay_usecs| is the inter-frame delay inserted between the end of a
+ * frame and the first poll read, which are submitted as a single message.
+ * spidev limits it to 65535; initialization fails for anything longer.
+ */
 struct NxpSpiBoard {
   const char *dev_path;
   int gpios[kBoardGpioMax];
   uint8_t mode;
   uint32_t bits;
   uint32_t speed;
+  uint32_t poll_delay_usecs;
+  int emulated;
 };
 
 #endif  /* ESE_HW_NXP_SPI_BOARD_H_ */
@@ -16,28 +16,11 @@
  * Support SPI communication with NXP PN553/PN80T secure element.
  */
 
-#include "include/ese/hw/nxp/pn80t/common.h"
+#include <string.h>
 
-int nxp_pn80t_preprocess(const struct Teq1ProtocolOptions *const opts,
-                         struct Teq1Frame *frame, int tx) {
-  if (tx) {
-    /* Recompute the LRC with the NAD of 0x00 */
-    frame->header.NAD = 0x00;
-    frame->INF[frame->header.LEN] = teq1_compute_LRC(frame);
-    frame->header.NAD = opts->node_address;
-    ALOGV("interface is preprocessing outbound frame");
-  } else {
-    /* Replace the NAD with 0x00 so the LRC check passes. */
-    ALOGV("interface is preprocessing inbound frame (%x->%x)",
-          frame->header.NAD, 0x00);
-    if (frame->header.NAD != opts->host_address) {
-      ALOGV("Rewriting from unknown NAD: %x", frame->header.NAD);
-    }
-    frame->header.NAD = 0x00;
-    ALOGV("Frame length: %x", frame->header.LEN);
-  }
-  return 0;
-}
+#include <ese/ese_tlv.h>
+
+#include "include/ese/hw/nxp/pn80t/common.h"
 
 static const struct Teq1ProtocolOptions kTeq1Options = {
     .host_address = 0xA5,
@@ -47,9 +30,19 @@ static const struct Teq1ProtocolOptions kTeq1Options = {
      * for polling and 7 * etu (7ms) is a long time to wait
      * between poll attempts so we divided by 7. */
     .etu = 0.00015f, /* elementary time unit, in seconds */
-    .preprocess = &nxp_pn80t_preprocess,
+    .preprocess = NULL,
+    /* The card computes the LRC with a NAD of 0x00. */
+    .lrc_nad_override = true,
+    .lrc_nad = 0x00,
+    .ifsd = IFSC,
 };
 
+/* Time for a chip left powered to answer S(RESYNC). Long enough to cover a
+ * wake-up from deep power-down, which the probe itself triggers, and the
+ * frame times on top.
+ */
+#define RESYNC_PROBE_TIMEOUT 0.05f
+
 int nxp_pn80t_open(struct EseInterface *ese, void *board) {
   struct NxpState *ns;
   const struct Pn80tPlatform *platform;
@@ -73,6 +66,27 @@ int nxp_pn80t_open(struct EseInterface *ese, void *board) {
     ese_set_error(ese, kNxpPn80tErrorPlatformInit);
     return -1;
   }
+  /* Still powered from the last session and inside its cooldown window:
+   * carry on without touching power if the chip answers S(RESYNC), which
+   * also restarts T=1 on both ends. If it does not, reset is still left
+   * released for the cooldown, so fall through to the usual power-up, which
+   * never pulls it, and let T=1 recover the session as it would after any
+   * other open.
+   */
+  if (platform->power_state) {
+    struct NxpPowerState *power = platform->power_state(ns->handle);
+    const bool warm =
+        power->powered && ese_monotonic_usec() < power->cooldown_end_usec;
+    power->powered = 0;
+    if (warm) {
+      if (teq1_resync(ese, &kTeq1Options, RESYNC_PROBE_TIMEOUT) == 0) {
+        ALOGV("%s: resumed within the cooldown window", __func__);
+        return 0;
+      }
+      ALOGI("%s: no answer to RESYNC; starting a new session", __func__);
+      ese->error.is_err = false;
+    }
+  }
   /* Toggle all required power GPIOs.
    * Each platform may prefer to handle the power
    * muxing specific. E.g., if NFC is in use, it would
@@ -125,39 +139,390 @@ int nxp_pn80t_reset(struct EseInterface *ese) {
   return 0;
 }
 
+static struct NxpPollStats *nxp_pn80t_get_poll_stats(struct EseInterface *ese) {
+  const struct Pn80tPlatform *platform = ese->ops->opts;
+  if (!platform->poll_stats) {
+    return NULL;
+  }
+  return platform->poll_stats(NXP_PN80T_STATE(ese)->handle);
+}
+
+/* Channel bits are masked so that every logical channel shares a slot. */
+static uint16_t nxp_pn80t_poll_key(uint8_t cla, uint8_t ins) {
+  cla &= (cla & 0x40) ? 0xf0 : 0xfc;
+  return (uint16_t)((cla << 8) | ins);
+}
+
+/* Returns the 1-based index of the slot for |key|, claiming it if needed. */
+static uint32_t nxp_pn80t_poll_slot(struct NxpPollStats *stats, uint16_t key) {
+  const uint32_t index = (uint16_t)(key * 40503u) >> 11;
+  struct NxpPollStat *slot = &stats->slots[index % NXP_PN80T_POLL_STATS_SLOTS];
+  if (slot->key != key) {
+    slot->key = key;
+    slot->samples = 0;
+    slot->polls = 0;
+    slot->expect_usec = 0;
+  }
+  return (uint32_t)(slot - stats->slots) + 1;
+}
+
+/* Marks the command in |tx_buf| as the one the next poll is waiting on. */
+static void nxp_pn80t_poll_expect(struct EseInterface *ese,
+                                  const struct EseSgBuffer *tx_buf,
+                                  uint32_t tx_len) {
+  struct NxpPollStats *stats = nxp_pn80t_get_poll_stats(ese);
+  uint8_t header[2];
+  if (!stats) {
+    return;
+  }
+  stats->pending = 0;
+  stats->polls = 0;
+  if (ese_sg_to_buf(tx_buf, tx_len, 0, sizeof(header), header) !=
+      sizeof(header)) {
+    return;
+  }
+  stats->pending =
+      nxp_pn80t_poll_slot(stats, nxp_pn80t_poll_key(header[0], header[1]));
+}
+
+/*
+ * Paces the poll attempts of one poll call.  Without poll statistics,
+ * attempts are one |interval| apart.  With them, the poll which waits for
+ * a command's final reply has its first wait skip to 3/4 of the expected
+ * response time, attempts stay |interval| apart until 3/2 of it, and then
+ * back off exponentially.  No wait runs past the timeout.  Time is taken
+ * from ese_monotonic_usec(), so it includes the reads and the platform's
+ * wake-up latency as well as the waits.
+ */
+struct NxpPollSchedule {
+  uint64_t start_usec;
+  long interval;
+  long timeout;
+  long remaining;
+  long expect;  /* < 0 when not adaptive */
+  long backoff;
+  long last_step;
+};
+
+/* Dense polling lasts at least this many intervals. */
+#define NXP_PN80T_POLL_DENSE_MIN 4
+/* Backed-off waits are capped at this many intervals. */
+#define NXP_PN80T_POLL_BACKOFF_MAX 8
+
+static void nxp_pn80t_schedule_init(struct EseInterface *ese,
+                                    struct NxpPollSchedule *sched,
+                                    float timeout) {
+  struct NxpPollStats *stats = nxp_pn80t_get_poll_stats(ese);
+  sched->start_usec = ese_monotonic_usec();
+  sched->interval = (long)(7.0f * kTeq1Options.etu * 1000000.0f);
+  sched->timeout = (long)(timeout * 1000000.0f);
+  sched->remaining = sched->timeout;
+  sched->backoff = sched->interval;
+  sched->last_step = 0;
+  sched->expect = -1;
+  if (stats) {
+    sched->expect = 0;
+    if (stats->pending) {
+      const struct NxpPollStat *slot = &stats->slots[stats->pending - 1];
+      /* Earlier polls wait for ACKs or WTX requests, which come quickly. */
+      if (++stats->polls == slot->polls) {
+        sched->expect = slot->expect_usec;
+      }
+    }
+  }
+}
+
+/* Returns the usecs to wait before the next attempt or 0 to give up. */
+static long nxp_pn80t_schedule_next(struct NxpPollSchedule *sched) {
+  const long elapsed = (long)(ese_monotonic_usec() - sched->start_usec);
+  long step = sched->interval;
+  sched->remaining = sched->timeout - elapsed;
+  if (sched->remaining <= sched->interval) {
+    return 0;
+  }
+  if (sched->expect >= 0) {
+    const long dense_start = sched->expect - sched->expect / 4;
+    long dense_end = sched->expect + sched->expect / 2;
+    if (dense_end < NXP_PN80T_POLL_DENSE_MIN * sched->interval) {
+      dense_end = NXP_PN80T_POLL_DENSE_MIN * sched->interval;
+    }
+    if (elapsed + sched->interval < dense_start) {
+      step = dense_start - elapsed;
+    } else if (elapsed >= dense_end) {
+      step = sched->backoff;
+      if (sched->backoff < NXP_PN80T_POLL_BACKOFF_MAX * sched->interval) {
+        sched->backoff *= 2;
+      }
+    }
+    if (step > sched->remaining) {
+      step = sched->remaining;
+    }
+  }
+  sched->remaining -= step;
+  sched->last_step = step;
+  return step;
+}
+
+/* Remembers how long this poll took to see its reply.  Only the sample of
+ * the exchange's last poll, the one for the final I-block, is kept.
+ */
+static void nxp_pn80t_schedule_done(struct EseInterface *ese,
+                                    const struct NxpPollSchedule *sched,
+                                    int found) {
+  struct NxpPollStats *stats = nxp_pn80t_get_poll_stats(ese);
+  uint64_t elapsed;
+  uint64_t landed;
+  if (!stats || !stats->pending || !found) {
+    return;
+  }
+  /* The reply landed somewhere within the last wait. */
+  elapsed = ese_monotonic_usec() - sched->start_usec;
+  landed = (uint64_t)(sched->last_step / 2);
+  stats->sample_usec = (uint32_t)(elapsed > landed ? elapsed - landed : 0);
+}
+
+/* Folds the final reply's time into the pending command's estimate once the
+ * exchange is over, along with how many polls it took to get there.
+ */
+static void nxp_pn80t_poll_learn(struct EseInterface *ese) {
+  struct NxpPollStats *stats = nxp_pn80t_get_poll_stats(ese);
+  struct NxpPollStat *slot;
+  if (!stats || !stats->pending) {
+    return;
+  }
+  slot = &stats->slots[stats->pending - 1];
+  stats->pending = 0;
+  if (ese_error(ese) || stats->polls == 0) {
+    return;
+  }
+  if (slot->samples == 0 || slot->polls != stats->polls) {
+    slot->expect_usec = stats->sample_usec;
+    slot->samples = 0;
+  } else {
+    slot->expect_usec = (slot->expect_usec * 3 + stats->sample_usec) / 4;
+  }
+  slot->polls = stats->polls < UINT8_MAX ? (uint8_t)stats->polls : UINT8_MAX;
+  if (slot->samples < UINT8_MAX) {
+    slot->samples++;
+  }
+}
+
+static int nxp_pn80t_poll_ready(struct EseInterface *ese, uint8_t poll_for,
+                                float timeout, int complete) {
+  struct NxpState *ns = NXP_PN80T_STATE(ese);
+  const struct Pn80tPlatform *platform = ese->ops->opts;
+  struct NxpPollSchedule sched;
+  long step;
+  uint8_t byte = 0xff;
+  nxp_pn80t_schedule_init(ese, &sched, timeout);
+  ALOGV("interface waiting for start of frame/host node address: %x",
+        poll_for);
+  while (sched.remaining > 0) {
+    const int ready = platform->wait_for_data(ns->handle, &sched.remaining);
+    if (ready < 0) {
+      ALOGE("failed to wait for data");
+      ese_set_error(ese, kNxpPn80tErrorPollRead);
+      return -1;
+    }
+    if (ready == 0) {
+      break;
+    }
+    ese->stats.poll_iterations++;
+    if (ese->ops->hw_receive(ese, &byte, 1, complete) != 1) {
+      ALOGE("failed to read one byte");
+      ese_set_error(ese, kNxpPn80tErrorPollRead);
+      return -1;
+    }
+    if (byte == poll_for) {
+      ALOGV("Polled for byte seen: %x with %ldus remaining.", poll_for,
+            sched.remaining);
+      ALOGV("RX[0]: %.2X", byte);
+      nxp_pn80t_schedule_done(ese, &sched, 1);
+      return 1;
+    }
+    ALOGV("No match (saw %x)", byte);
+    /* The device may report readiness while clocking out filler bytes so
+     * pace the retries as the spin loop would.
+     */
+    step = nxp_pn80t_schedule_next(&sched);
+    if (!step) {
+      break;
+    }
+    platform->wait(ns->handle, step);
+  }
+  nxp_pn80t_schedule_done(ese, &sched, 0);
+  ese->stats.poll_timeouts++;
+  ALOGW("polling timed out.");
+  return -1;
+}
+
+static struct NxpReadAhead *nxp_pn80t_get_read_ahead(struct EseInterface *ese) {
+  const struct Pn80tPlatform *platform = ese->ops->opts;
+  if (!platform->read_ahead) {
+    return NULL;
+  }
+  return platform->read_ahead(NXP_PN80T_STATE(ese)->handle);
+}
+
+uint32_t nxp_pn80t_read_ahead(struct EseInterface *ese, uint8_t *buf,
+                              uint32_t len) {
+  struct NxpReadAhead *ra = nxp_pn80t_get_read_ahead(ese);
+  uint32_t avail;
+  if (!ra || ra->start >= ra->end) {
+    return 0;
+  }
+  avail = ra->end - ra->start;
+  if (len > avail) {
+    len = avail;
+  }
+  memcpy(buf, &ra->buf[ra->start], len);
+  ra->start += len;
+  return len;
+}
+
+/* Bytes read per poll attempt: the NAD, PCB and LEN of a frame which is
+ * already waiting.
+ */
+#define NXP_PN80T_POLL_PROBE_SIZE 3
+
+/*
+ * Buffers the rest of the frame whose NAD was just seen: the |have| bytes
+ * which followed it in the probe, the remainder of the header and then,
+ * sized from LEN, the INF and LRC in one read.
+ */
+static int nxp_pn80t_read_rest(struct EseInterface *ese,
+                               struct NxpReadAhead *ra, const uint8_t *head,
+                               uint32_t have, int complete) {
+  uint32_t len;
+  memcpy(ra->buf, head, have);
+  if (have < 2 &&
+      ese->ops->hw_receive(ese, &ra->buf[have], 2 - have, complete) !=
+          2 - have) {
+    return -1;
+  }
+  len = (uint32_t)ra->buf[1] + 1;
+  if (ese->ops->hw_receive(ese, &ra->buf[2], len, complete) != len) {
+    return -1;
+  }
+  ra->start = 0;
+  ra->end = 2 + len;
+  return 0;
+}
+
+/*
+ * Reads a small probe per attempt until the NAD appears and keeps the rest
+ * of the frame after it for the following hw_receive() calls.
+ */
+static int nxp_pn80t_poll_buffered(struct EseInterface *ese,
+                                   struct NxpReadAhead *ra, uint8_t poll_for,
+                                   float timeout, int complete) {
+  struct NxpState *ns = NXP_PN80T_STATE(ese);
+  const struct Pn80tPlatform *platform = ese->ops->opts;
+  struct NxpPollSchedule sched;
+  uint8_t probe[NXP_PN80T_POLL_PROBE_SIZE];
+  long step;
+  const uint8_t *nad;
+  nxp_pn80t_schedule_init(ese, &sched, timeout);
+  /* Nothing past the end of a frame is ever read ahead, so leftovers are
+   * the tail of a frame the caller gave up on. They have to go before the
+   * reads below, which would drain them first.
+   */
+  ra->start = ra->end = 0;
+  ALOGV("interface reading ahead for start of frame/host node address: %x",
+        poll_for);
+  while (sched.remaining > 0) {
+    if (platform->wait_for_data) {
+      const int ready = platform->wait_for_data(ns->handle, &sched.remaining);
+      if (ready < 0) {
+        ALOGE("failed to wait for data");
+        ese_set_error(ese, kNxpPn80tErrorPollRead);
+        return -1;
+      }
+      if (ready == 0) {
+        break;
+      }
+    }
+    ese->stats.poll_iterations++;
+    if (ese->ops->hw_receive(ese, probe, sizeof(probe), complete) !=
+        sizeof(probe)) {
+      ALOGE("failed to read ahead");
+      ese_set_error(ese, kNxpPn80tErrorPollRead);
+      return -1;
+    }
+    nad = memchr(probe, poll_for, sizeof(probe));
+    if (nad) {
+      ALOGV("Polled for byte seen: %x at offset %u.", poll_for,
+            (uint32_t)(nad - probe));
+      if (nxp_pn80t_read_rest(ese, ra, nad + 1,
+                              (uint32_t)(probe + sizeof(probe) - nad - 1),
+                              complete) < 0) {
+        ALOGE("failed to read ahead");
+        ese_set_error(ese, kNxpPn80tErrorPollRead);
+        return -1;
+      }
+      nxp_pn80t_schedule_done(ese, &sched, 1);
+      return 1;
+    }
+    step = nxp_pn80t_schedule_next(&sched);
+    if (!step) {
+      break;
+    }
+    platform->wait(ns->handle, step);
+  }
+  nxp_pn80t_schedule_done(ese, &sched, 0);
+  ese->stats.poll_timeouts++;
+  ALOGW("polling timed out.");
+  return -1;
+}
+
 int nxp_pn80t_poll(struct EseInterface *ese, uint8_t poll_for, float timeout,
                    int complete) {
   struct NxpState *ns = NXP_PN80T_STATE(ese);
   const struct Pn80tPlatform *platform = ese->ops->opts;
   /* Attempt to read a 8-bit character once per 8-bit character transmission
-   * window (in seconds).
+   * window (in seconds) unless the schedule knows better.
    */
-  int intervals = (int)(0.5f + timeout / (7.0f * kTeq1Options.etu));
+  struct NxpPollSchedule sched;
+  long step;
   uint8_t byte = 0xff;
+  struct NxpReadAhead *ra = nxp_pn80t_get_read_ahead(ese);
+  if (ra) {
+    return nxp_pn80t_poll_buffered(ese, ra, poll_for, timeout, complete);
+  }
+  /* If the platform can notify us of readiness, sleep until then. */
+  if (platform->wait_for_data) {
+    return nxp_pn80t_poll_ready(ese, poll_for, timeout, complete);
+  }
+  nxp_pn80t_schedule_init(ese, &sched, timeout);
   ALOGV("interface polling for start of frame/host node address: %x", poll_for);
-  /* If we had interrupts, we could just get notified by the driver. */
   do {
     /*
      * In practice, if complete=true, then no transmission
      * should attempt again until after 1000usec.
      */
+    ese->stats.poll_iterations++;
     if (ese->ops->hw_receive(ese, &byte, 1, complete) != 1) {
       ALOGE("failed to read one byte");
       ese_set_error(ese, kNxpPn80tErrorPollRead);
       return -1;
     }
     if (byte == poll_for) {
-      ALOGV("Polled for byte seen: %x with %d intervals remaining.", poll_for,
-            intervals);
+      ALOGV("Polled for byte seen: %x with %ldus remaining.", poll_for,
+            sched.remaining);
       ALOGV("RX[0]: %.2X", byte);
+      nxp_pn80t_schedule_done(ese, &sched, 1);
       return 1;
     } else {
       ALOGV("No match (saw %x)", byte);
     }
-    platform->wait(ns->handle,
-                   7.0f * kTeq1Options.etu * 1000000.0f); /* s -> us */
-    ALOGV("poll interval %d: no match.", intervals);
-  } while (intervals-- > 0);
+    step = nxp_pn80t_schedule_next(&sched);
+    if (step) {
+      platform->wait(ns->handle, step);
+      ALOGV("poll wait %ldus: no match.", step);
+    }
+  } while (step);
+  nxp_pn80t_schedule_done(ese, &sched, 0);
+  ese->stats.poll_timeouts++;
   ALOGW("polling timed out.");
   return -1;
 }
@@ -173,6 +538,7 @@ int nxp_pn80t_poll(struct EseInterface *ese, uint8_t poll_for, float timeout,
 #define SECURE_TIMER 0xF1
 #define ATTACK_COUNTER 0xF2
 #define RESTRICTED_MODE_PENALTY 0xF3
+#define COOLDOWN_TIMERS 0xE5
 uint32_t nxp_pn80t_send_cooldown(struct EseInterface *ese, bool end) {
   struct NxpState *ns = NXP_PN80T_STATE(ese);
   const struct Pn80tPlatform *platform = ese->ops->opts;
@@ -208,36 +574,37 @@ uint32_t nxp_pn80t_send_cooldown(struct EseInterface *ese, bool end) {
   ALOGI("Requested power-down delay times (sec):");
   /* For each tag type, walk the response to extract the value. */
   uint32_t max_wait = 0;
-  if (bytes_read >= 0x8 && rx_buf[0] == 0xe5 && rx_buf[1] == 0x12) {
-    uint8_t *tag_ptr = &rx_buf[2];
-    while (tag_ptr < (rx_buf + bytes_read)) {
-      const uint8_t tag = *tag_ptr;
-      const uint8_t length = *(tag_ptr + 1);
-
-      /* The cooldown timers are 32-bit values. */
-      if (length == sizeof(uint32_t)) {
-        const uint32_t *const value_ptr = (uint32_t *)(tag_ptr + 2);
-        uint32_t cooldown = ese_be32toh(*value_ptr);
-        switch (tag) {
-        case RESTRICTED_MODE_PENALTY:
-          /* This timer is in minutes, so convert it to seconds. */
-          cooldown *= 60;
-        /* Fallthrough */
-        case SECURE_TIMER:
-        case ATTACK_COUNTER:
-          ALOGI("- Timer 0x%.2X: %d", tag, cooldown);
-          if (cooldown > max_wait) {
-            max_wait = cooldown;
-            /* Wait 25ms Guard time to make sure eSE is in DPD mode */
-            platform->wait(ns->handle, 25000);
-          }
-          break;
-        default:
-          /* Ignore -- not a known tag. */
-          break;
-        }
+  const struct EseSgBuffer rx = {.base = rx_buf, .len = bytes_read};
+  struct EseTlvReader reader;
+  struct EseTlv tlv;
+  ese_tlv_reader_init(&reader, &rx, 1);
+  if (ese_tlv_next(&reader, &tlv) != kEseTlvOk || tlv.tag != COOLDOWN_TIMERS) {
+    return 0;
+  }
+  ese_tlv_children(&tlv, &reader);
+  while (ese_tlv_next(&reader, &tlv) == kEseTlvOk) {
+    uint32_t cooldown;
+    /* The cooldown timers are 32-bit values. */
+    if (tlv.length != sizeof(uint32_t) || !ese_tlv_value_u32(&tlv, &cooldown)) {
+      continue;
+    }
+    switch (tlv.tag) {
+    case RESTRICTED_MODE_PENALTY:
+      /* This timer is in minutes, so convert it to seconds. */
+      cooldown *= 60;
+    /* Fallthrough */
+    case SECURE_TIMER:
+    case ATTACK_COUNTER:
+      ALOGI("- Timer 0x%.2X: %d", tlv.tag, cooldown);
+      if (cooldown > max_wait) {
+        max_wait = cooldown;
+        /* Wait 25ms Guard time to make sure eSE is in DPD mode */
+        platform->wait(ns->handle, 25000);
       }
-      tag_ptr += 2 + length;
+      break;
+    default:
+      /* Ignore -- not a known tag. */
+      break;
     }
   }
   return max_wait;
@@ -270,6 +637,7 @@ uint32_t nxp_pn80t_handle_interface_call(struct EseInterface *ese,
     ALOGI("interface command received: reset");
     /* Force a hard reset by setting an error on the hw. */
     ese_set_error(ese, 0);
+    ese->stats.hw_resets++;
     if (nxp_pn80t_reset(ese) < 0) {
       /* Warning, state unchanged error. */
       ok[0] = 0x62;
@@ -308,12 +676,66 @@ uint32_t nxp_pn80t_transceive(struct EseInterface *ese,
                               const struct EseSgBuffer *tx_buf, uint32_t tx_len,
                               struct EseSgBuffer *rx_buf, uint32_t rx_len) {
 
-  const uint32_t recvd =
+  uint32_t recvd =
       nxp_pn80t_handle_interface_call(ese, tx_buf, tx_len, rx_buf, rx_len);
   if (recvd > 0) {
     return recvd;
   }
-  return teq1_transceive(ese, &kTeq1Options, tx_buf, tx_len, rx_buf, rx_len);
+  nxp_pn80t_poll_expect(ese, tx_buf, tx_len);
+  recvd = teq1_transceive(ese, &kTeq1Options, tx_buf, tx_len, rx_buf, rx_len);
+  nxp_pn80t_poll_learn(ese);
+  return recvd;
+}
+
+/*
+ * Entries go straight to T=1: the interface commands handled above are not
+ * recognized in a batch, and the poll statistics slot is only looked up
+ * again when the CLA/INS changes from the previous entry.
+ */
+uint32_t nxp_pn80t_transceive_batch(struct EseInterface *ese,
+                                    struct EseBatchEntry *entries,
+                                    uint32_t count) {
+  struct NxpPollStats *stats = nxp_pn80t_get_poll_stats(ese);
+  uint32_t pending = 0;
+  uint16_t key = 0;
+  uint32_t i;
+  for (i = 0; i < count; ++i) {
+    struct EseBatchEntry *entry = &entries[i];
+    const struct EseSgBuffer tx = {
+        .c_base = entry->tx_buf, .len = entry->tx_len,
+    };
+    struct EseSgBuffer rx = {
+        .base = entry->rx_buf, .len = entry->rx_max,
+    };
+    const uint64_t start = ese_monotonic_usec();
+    uint32_t recvd;
+    if (stats) {
+      if (entry->tx_len < 2) {
+        pending = 0;
+      } else {
+        const uint16_t next =
+            nxp_pn80t_poll_key(entry->tx_buf[0], entry->tx_buf[1]);
+        if (!pending || next != key) {
+          key = next;
+          pending = nxp_pn80t_poll_slot(stats, key);
+        }
+      }
+      stats->pending = pending;
+      stats->polls = 0;
+    }
+    recvd = teq1_transceive(ese, &kTeq1Options, &tx, 1, &rx, 1);
+    nxp_pn80t_poll_learn(ese);
+    ese_stats_record(&ese->stats.transceive_latency,
+                     ese_monotonic_usec() - start);
+    if (ese_error(ese)) {
+      return i + 1;
+    }
+    entry->rx_len = (int)recvd;
+    if (ese_batch_entry_stops(entry)) {
+      return i + 1;
+    }
+  }
+  return count;
 }
 
 void nxp_pn80t_close(struct EseInterface *ese) {
@@ -334,6 +756,11 @@ void nxp_pn80t_close(struct EseInterface *ese) {
     if (platform->toggle_ven) {
       platform->toggle_ven(ns->handle, 0);
     }
+  } else if (platform->power_state) {
+    struct NxpPowerState *power = platform->power_state(ns->handle);
+    power->powered = 1;
+    power->cooldown_end_usec =
+        ese_monotonic_usec() + (uint64_t)wait_sec * 1000000ULL;
   }
 
   platform->release(ns->handle);
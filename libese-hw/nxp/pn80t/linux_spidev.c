@@ -33,6 +33,10 @@
 struct Handle {
   int spi_fd;
   struct NxpSpiBoard *board;
+  /* First poll byte read along with the last complete frame. */
+  int poll_pending;
+  uint8_t poll_byte;
+  struct NxpPollStats poll_stats;
 };
 
 int gpio_set(int num, int val) {
@@ -46,7 +50,7 @@ int gpio_set(int num, int val) {
                num) >= (int)sizeof(val_path)) {
     return -1;
   }
-  printf("Gpio @ %s\n", val_path);
+  ALOGV("Gpio @ %s", val_path);
   fd = open(val_path, O_WRONLY);
   if (fd < 0) {
     return -1;
@@ -61,19 +65,19 @@ int gpio_set(int num, int val) {
 
 int platform_toggle_ven(void *blob, int val) {
   struct Handle *handle = blob;
-  printf("Toggling VEN: %d\n", val);
+  ALOGV("Toggling VEN: %d", val);
   return gpio_set(handle->board->gpios[kBoardGpioNfcVen], val);
 }
 
 int platform_toggle_reset(void *blob, int val) {
   struct Handle *handle = blob;
-  printf("Toggling RST: %d\n", val);
+  ALOGV("Toggling RST: %d", val);
   return gpio_set(handle->board->gpios[kBoardGpioEseRst], val);
 }
 
 int platform_toggle_power_req(void *blob, int val) {
   struct Handle *handle = blob;
-  printf("Toggling SVDD_PWR_REQ: %d\n", val);
+  ALOGV("Toggling SVDD_PWR_REQ: %d", val);
   return gpio_set(handle->board->gpios[kBoardGpioEseSvddPwrReq], val);
 }
 
@@ -123,11 +127,20 @@ void *platform_init(void *hwopts) {
   struct Handle *handle;
   int gpio = 0;
 
+  /* spi_ioc_transfer.delay_usecs is only 16 bits wide. */
+  if (board->poll_delay_usecs > UINT16_MAX) {
+    ALOGE("poll_delay_usecs %u is over the spidev limit of %u",
+          board->poll_delay_usecs, UINT16_MAX);
+    return NULL;
+  }
+
   handle = malloc(sizeof(*handle));
   if (!handle) {
     return NULL;
   }
   handle->board = board;
+  handle->poll_pending = 0;
+  memset(&handle->poll_stats, 0, sizeof(handle->poll_stats));
 
   /* Initialize the mapped GPIOs */
   for (; gpio < kBoardGpioMax; ++gpio) {
@@ -142,6 +155,11 @@ void *platform_init(void *hwopts) {
     free(handle);
     return NULL;
   }
+  /* Emulated devices may not implement the bus settings. */
+  if (board->emulated) {
+    ALOGI("Linux SPIDev initialized (%s)", board->dev_path);
+    return (void *)handle;
+  }
   /* If we need anything fancier, we'll need MODE32 in the headers. */
   if (ioctl(handle->spi_fd, SPI_IOC_WR_MODE, &board->mode) < 0) {
     close(handle->spi_fd);
@@ -158,7 +176,7 @@ void *platform_init(void *hwopts) {
     free(handle);
     return NULL;
   }
-  printf("Linux SPIDev initialized\n");
+  ALOGI("Linux SPIDev initialized");
   return (void *)handle;
 }
 
@@ -170,37 +188,104 @@ int platform_release(void *blob) {
   return 0;
 }
 
+struct NxpPollStats *platform_poll_stats(void *blob) {
+  struct Handle *handle = blob;
+  return &handle->poll_stats;
+}
+
 int platform_wait(void *blob __attribute__((unused)), long usec) {
   return usleep((useconds_t)usec);
 }
 
-uint32_t spidev_transmit(struct EseInterface *ese, const uint8_t *buf,
-                         uint32_t len, int complete) {
+/* Upper bound on the transfers sent in a single SPI message. */
+#define SPIDEV_MAX_TRANSFERS 16
+
+/*
+ * Submits |n| transmit transfers, totalling |len| bytes, as one SPI message.
+ * |tr| must have room for one more transfer: a complete frame is followed in
+ * the same message by the board's inter-frame delay and the first one-byte
+ * poll read. That byte is handed out by the next spidev_receive() call, so
+ * the poll loop costs one ioctl less per frame.
+ */
+static uint32_t spidev_submit(struct EseInterface *ese,
+                              struct spi_ioc_transfer *tr, uint32_t n,
+                              uint32_t len, int complete) {
   struct NxpState *ns = NXP_PN80T_STATE(ese);
   struct Handle *handle = ns->handle;
-  struct spi_ioc_transfer tr = {
-      .tx_buf = (unsigned long)buf,
-      .rx_buf = 0,
-      .len = (uint32_t)len,
-      .delay_usecs = 0,
-      .speed_hz = 0,
-      .bits_per_word = 0,
-      .cs_change = !!complete,
-  };
   ssize_t ret = -1;
+  handle->poll_pending = 0;
+  if (complete) {
+    /* Chip select is held across the delay, as it was between the separate
+     * transmit and poll messages. */
+    tr[n - 1].cs_change = 0;
+    tr[n - 1].delay_usecs = (uint16_t)handle->board->poll_delay_usecs;
+    memset(&tr[n], 0, sizeof(tr[n]));
+    tr[n].rx_buf = (unsigned long)&handle->poll_byte;
+    tr[n].len = 1;
+    n++;
+  }
+  ret = ioctl(handle->spi_fd, SPI_IOC_MESSAGE(n), tr);
+  if (ret < 1) {
+    ese_set_error(ese, kNxpPn80tErrorTransmit);
+    ALOGE("%s: failed to write to hw (ret=%zd)", __func__, ret);
+    return 0;
+  }
+  handle->poll_pending = !!complete;
+  return len;
+}
+
+uint32_t spidev_transmit(struct EseInterface *ese, const uint8_t *buf,
+                         uint32_t len, int complete) {
+  struct spi_ioc_transfer tr[2];
   ALOGV("spidev:%s: called [%d]", __func__, len);
   if (len > INT_MAX) {
     ese_set_error(ese, kNxpPn80tErrorTransmitSize);
     ALOGE("Unexpectedly large transfer attempted: %u", len);
     return 0;
   }
-  ret = ioctl(handle->spi_fd, SPI_IOC_MESSAGE(1), &tr);
-  if (ret < 1) {
-    ese_set_error(ese, kNxpPn80tErrorTransmit);
-    ALOGE("%s: failed to write to hw (ret=%zd)", __func__, ret);
+  memset(tr, 0, sizeof(tr));
+  tr[0].tx_buf = (unsigned long)buf;
+  tr[0].len = len;
+  return spidev_submit(ese, tr, 1, len, complete);
+}
+
+/*
+ * Sends every segment as its own transfer within one SPI message.  Chip select
+ * is held between transfers, so the card sees a single contiguous frame.
+ */
+uint32_t spidev_transmit_sg(struct EseInterface *ese,
+                            const struct EseSgBuffer *bufs, uint32_t cnt,
+                            int complete) {
+  struct spi_ioc_transfer tr[SPIDEV_MAX_TRANSFERS];
+  uint32_t len = 0;
+  uint32_t n = 0;
+  uint32_t i;
+  ALOGV("spidev:%s: called [%u segments]", __func__, cnt);
+  /* One transfer is reserved for the chained poll read. */
+  if (cnt > SPIDEV_MAX_TRANSFERS - 1) {
+    ese_set_error(ese, kNxpPn80tErrorTransmitSize);
+    ALOGE("Unexpectedly fragmented transfer attempted: %u", cnt);
     return 0;
   }
-  return len;
+  memset(tr, 0, sizeof(tr));
+  for (i = 0; i < cnt; ++i) {
+    if (bufs[i].len == 0) {
+      continue;
+    }
+    if (bufs[i].len > INT_MAX - len) {
+      ese_set_error(ese, kNxpPn80tErrorTransmitSize);
+      ALOGE("Unexpectedly large transfer attempted");
+      return 0;
+    }
+    tr[n].tx_buf = (unsigned long)bufs[i].c_base;
+    tr[n].len = bufs[i].len;
+    len += bufs[i].len;
+    n++;
+  }
+  if (n == 0) {
+    return 0;
+  }
+  return spidev_submit(ese, tr, n, len, complete);
 }
 
 uint32_t spidev_receive(struct EseInterface *ese, uint8_t *buf, uint32_t len,
@@ -217,12 +302,24 @@ uint32_t spidev_receive(struct EseInterface *ese, uint8_t *buf, uint32_t len,
       .bits_per_word = 0,
       .cs_change = !!complete,
   };
+  uint32_t served = 0;
   ALOGV("spidev:%s: called [%d]", __func__, len);
   if (len > INT_MAX) {
     ese_set_error(ese, kNxpPn80tErrorReceiveSize);
     ALOGE("Unexpectedly large receive attempted: %u", len);
     return 0;
   }
+  /* The byte read alongside the last frame comes first. */
+  if (handle->poll_pending && len > 0) {
+    handle->poll_pending = 0;
+    buf[0] = handle->poll_byte;
+    served = 1;
+    if (len == 1) {
+      return 1;
+    }
+    tr.rx_buf = (unsigned long)(buf + 1);
+    tr.len = len - 1;
+  }
   ret = ioctl(handle->spi_fd, SPI_IOC_MESSAGE(1), &tr);
   if (ret < 1) {
     ALOGE("%s: failed to read from hw (ret=%zd)", __func__, ret);
@@ -230,7 +327,7 @@ uint32_t spidev_receive(struct EseInterface *ese, uint8_t *buf, uint32_t len,
     return 0;
   }
   ALOGV("%s: read bytes: %zd", __func__, len);
-  return len;
+  return served + tr.len;
 }
 
 static const struct Pn80tPlatform kPn80tLinuxSpidevPlatform = {
@@ -241,6 +338,10 @@ static const struct Pn80tPlatform kPn80tLinuxSpidevPlatform = {
     .toggle_power_req = &platform_toggle_power_req,
     .toggle_bootloader = NULL,
     .wait = &platform_wait,
+    .wait_for_data = NULL,
+    .read_ahead = NULL,
+    .poll_stats = &platform_poll_stats,
+    .power_state = NULL,
 };
 
 static const struct EseOperations ops = {
@@ -255,6 +356,8 @@ static const struct EseOperations ops = {
     .opts = &kPn80tLinuxSpidevPlatform,
     .errors = kNxpPn80tErrorMessages,
     .errors_count = kNxpPn80tErrorMax,
+    .hw_transmit_sg = &spidev_transmit_sg,
+    .transceive_batch = &nxp_pn80t_transceive_batch,
 };
 __attribute__((visibility("default")))
 ESE_DEFINE_HW_OPS(ESE_HW_NXP_PN80T_SPIDEV, ops);
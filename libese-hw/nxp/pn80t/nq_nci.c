@@ -38,10 +38,13 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "../include/ese/hw/nxp/pn80t/common.h"
@@ -59,8 +62,39 @@ static const char kDevicePath[] = "/dev/pn81a";
 
 struct PlatformHandle {
   int fd;
+  struct NxpReadAhead read_ahead;
+  struct NxpPollStats poll_stats;
+  struct NxpPowerState *power_state;
 };
 
+/* The eSE stays powered between handles, so its power state is kept per
+ * device node rather than per handle.
+ */
+#define MAX_DEVICES 4
+static struct {
+  dev_t rdev;
+  struct NxpPowerState power_state;
+} devices[MAX_DEVICES];
+static size_t devices_used;
+
+static struct NxpPowerState *device_power_state(int fd) {
+  struct stat st;
+  size_t i;
+  if (fstat(fd, &st) < 0) {
+    return NULL;
+  }
+  for (i = 0; i < devices_used; ++i) {
+    if (devices[i].rdev == st.st_rdev) {
+      return &devices[i].power_state;
+    }
+  }
+  if (devices_used == MAX_DEVICES) {
+    return NULL;
+  }
+  devices[devices_used].rdev = st.st_rdev;
+  return &devices[devices_used++].power_state;
+}
+
 int platform_toggle_bootloader(void *blob, int val) {
   const struct PlatformHandle *handle = blob;
   if (!handle) {
@@ -96,6 +130,13 @@ void *platform_init(void *hwopts) {
     free(handle);
     return NULL;
   }
+  handle->power_state = device_power_state(handle->fd);
+  if (!handle->power_state) {
+    ALOGE("%s: no power state slot for '%s'", __func__, kDevicePath);
+    close(handle->fd);
+    free(handle);
+    return NULL;
+  }
   return handle;
 }
 
@@ -110,10 +151,60 @@ int platform_release(void *blob) {
   return 0;
 }
 
+struct NxpReadAhead *platform_read_ahead(void *blob) {
+  struct PlatformHandle *handle = blob;
+  return &handle->read_ahead;
+}
+
+struct NxpPollStats *platform_poll_stats(void *blob) {
+  struct PlatformHandle *handle = blob;
+  return &handle->poll_stats;
+}
+
+struct NxpPowerState *platform_power_state(void *blob) {
+  struct PlatformHandle *handle = blob;
+  return handle->power_state;
+}
+
 int platform_wait(void *UNUSED(blob), long usec) {
   return usleep((useconds_t)usec);
 }
 
+static long platform_now_usec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long)ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
+
+int platform_wait_for_data(void *blob, long *usec) {
+  const struct PlatformHandle *handle = blob;
+  struct pollfd pfd;
+  if (!handle || !usec) {
+    return -1;
+  }
+  pfd.fd = handle->fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  const long start = platform_now_usec();
+  /* Round up so that sub-millisecond timeouts still wait. */
+  const int timeout_ms = (int)((*usec + 999) / 1000);
+  int ret;
+  do {
+    ret = poll(&pfd, 1, timeout_ms);
+  } while (ret < 0 && errno == EINTR);
+  const long elapsed = platform_now_usec() - start;
+  *usec = (elapsed < *usec) ? *usec - elapsed : 0;
+  if (ret < 0) {
+    ALOGE("%s: poll failed: %s", __func__, strerror(errno));
+    return -1;
+  }
+  if (ret > 0 && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+    ALOGE("%s: device error (revents=%x)", __func__, pfd.revents);
+    return -1;
+  }
+  return ret > 0;
+}
+
 uint32_t nq_transmit(struct EseInterface *ese, const uint8_t *buf, uint32_t len,
                      int UNUSED(complete)) {
   struct NxpState *ns = NXP_PN80T_STATE(ese);
@@ -162,7 +253,8 @@ uint32_t nq_receive(struct EseInterface *ese, uint8_t *buf, uint32_t len,
   if (len == 0) {
     return 0;
   }
-  uint32_t bytes = 0;
+  /* Anything read ahead while polling comes first. */
+  uint32_t bytes = nxp_pn80t_read_ahead(ese, buf, len);
   while (bytes < len) {
     ssize_t ret = read(handle->fd, (void *)(buf + bytes), len - bytes);
     if (ret < 0) {
@@ -188,6 +280,10 @@ static const struct Pn80tPlatform kPn80tNqNciPlatform = {
     .toggle_power_req = NULL,
     .toggle_bootloader = &platform_toggle_bootloader,
     .wait = &platform_wait,
+    .wait_for_data = &platform_wait_for_data,
+    .read_ahead = &platform_read_ahead,
+    .poll_stats = &platform_poll_stats,
+    .power_state = &platform_power_state,
 };
 
 static const struct EseOperations ops = {
@@ -202,6 +298,12 @@ static const struct EseOperations ops = {
     .opts = &kPn80tNqNciPlatform,
     .errors = kNxpPn80tErrorMessages,
     .errors_count = kNxpPn80tErrorMax,
+    /* No hw_transmit_sg: the driver only implements write(), so writev() would
+     * cost a chip select per segment, and gathering into a bounce buffer here
+     * is the same copy teq1 already makes into its frame.
+     */
+    .hw_transmit_sg = NULL,
+    .transceive_batch = &nxp_pn80t_transceive_batch,
 };
 __attribute__((visibility("default")))
 ESE_DEFINE_HW_OPS(ESE_HW_NXP_PN80T_NQ_NCI, ops);
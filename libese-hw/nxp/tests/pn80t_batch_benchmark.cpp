@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Compares a caller-side ese_transceive() loop with ese_transceive_batch()
+ * over the simulated PN80T with poll statistics.  Each iteration sends a
+ * provisioning-like sequence: a clear, state.range(0) appends and a set.
+ * The card's think time is state.range(1) usecs per command.
+ */
+
+#include <array>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ese/ese.h>
+
+#include "pn80t_sim.h"
+
+namespace {
+
+const uint8_t kClear[] = {0x80, 0x10, 0x00, 0x00};
+const uint8_t kAppend[] = {0x80, 0x10, 0x01, 0x00, 0x08,
+                           0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+const uint8_t kSet[] = {0x80, 0x08, 0x00, 0x00, 0x00};
+
+struct Sequence {
+  explicit Sequence(size_t appends) : rx(appends + 2) {
+    Add(kClear, sizeof(kClear));
+    for (size_t i = 0; i < appends; ++i) {
+      Add(kAppend, sizeof(kAppend));
+    }
+    Add(kSet, sizeof(kSet));
+  }
+
+  void Add(const uint8_t *apdu, uint32_t len) {
+    struct EseBatchEntry entry = {};
+    entry.tx_buf = apdu;
+    entry.tx_len = len;
+    entry.rx_buf = rx[entries.size()].data();
+    entry.rx_max = static_cast<uint32_t>(rx[entries.size()].size());
+    entry.policy = kEseBatchStopUnlessOk;
+    entries.push_back(entry);
+  }
+
+  std::vector<std::array<uint8_t, 258>> rx;
+  std::vector<struct EseBatchEntry> entries;
+};
+
+template <typename Run>
+void RunSequence(benchmark::State &state, Run run) {
+  SimulatedPn80t sim(state.range(1));
+  struct EseInterface ese = {};
+  ese.ops = kSimPn80tAdaptiveOps;
+  Sequence sequence(static_cast<size_t>(state.range(0)));
+  if (!sim.Start() || ese_open(&ese, &sim) < 0) {
+    state.SkipWithError("unable to start the simulated device");
+    return;
+  }
+  for (auto _ : state) {
+    if (!run(&ese, &sequence)) {
+      state.SkipWithError("sequence failed");
+      break;
+    }
+  }
+  state.counters["apdus_per_sec"] = benchmark::Counter(
+      static_cast<double>(state.iterations() * sequence.entries.size()),
+      benchmark::Counter::kIsRate);
+  ese_close(&ese);
+  sim.Stop();
+}
+
+void BM_Pn80tSequenceLoop(benchmark::State &state) {
+  RunSequence(state, [](struct EseInterface *ese, Sequence *sequence) {
+    for (auto &entry : sequence->entries) {
+      entry.rx_len = ese_transceive(ese, entry.tx_buf, entry.tx_len,
+                                    entry.rx_buf, entry.rx_max);
+      if (entry.rx_len != 2) {
+        return false;
+      }
+    }
+    return true;
+  });
+}
+BENCHMARK(BM_Pn80tSequenceLoop)
+    ->Args({4, 0})->Args({16, 0})->Args({4, 200})->UseRealTime();
+
+void BM_Pn80tSequenceBatch(benchmark::State &state) {
+  RunSequence(state, [](struct EseInterface *ese, Sequence *sequence) {
+    const int count = static_cast<int>(sequence->entries.size());
+    return ese_transceive_batch(ese, sequence->entries.data(), count) == count;
+  });
+}
+BENCHMARK(BM_Pn80tSequenceBatch)
+    ->Args({4, 0})->Args({16, 0})->Args({4, 200})->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Compares opening and closing the simulated PN80T around every request
+ * with keeping it open through a burst of requests with EseConnection.
+ * Each iteration is one burst of state.range(0) requests; the keep-alive
+ * case closes the connection after the burst outside of the timing, as
+ * the idle task would once the burst is over.
+ *
+ * Also times re-opening the device and sending the first command after a
+ * session which left the chip powered for a cooldown timer, with and
+ * without the power state that lets the open resume within the window.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ese/ese.h>
+#include <esecpp/EseConnection.h>
+#include <esecpp/EseInterface.h>
+
+#include "pn80t_sim.h"
+
+namespace {
+
+// Time for the chip to boot once reset is released.
+constexpr long kPowerUpUsec = 5000;
+constexpr long kThinkUsec = 2000;
+
+class SimEse : public android::EseInterface {
+ public:
+  SimEse(SimulatedPn80t *sim, const struct EseOperations *ops = kSimPn80tReadyOps)
+      : sim_(sim), ops_(ops) {}
+  void init() override {
+    iface_ = {};
+    iface_.ops = ops_;
+    mEse = &iface_;
+  }
+  int open() override { return ese_open(mEse, sim_); }
+  void close() override {
+    if (mEse != nullptr) {
+      ese_close(mEse);
+      mEse = nullptr;
+    }
+  }
+
+ private:
+  SimulatedPn80t *sim_;
+  const struct EseOperations *ops_;
+  struct ::EseInterface iface_;
+};
+
+const std::vector<uint8_t> kApdu = { 0x80, 0xca, 0x00, 0x00, 0x00 };
+
+void Report(benchmark::State &state, const SimulatedPn80t &sim) {
+  const double requests =
+      static_cast<double>(state.iterations() * state.range(0));
+  state.counters["per_request"] = benchmark::Counter(
+      requests, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.counters["power_ups_per_request"] = sim.power_ups / requests;
+}
+
+void BM_Pn80tOpenPerRequest(benchmark::State &state) {
+  SimulatedPn80t sim(kThinkUsec);
+  sim.SetPowerUpTime(kPowerUpUsec);
+  SimEse ese(&sim);
+  std::vector<uint8_t> reply(258);
+  if (!sim.Start()) {
+    state.SkipWithError("unable to start the simulated device");
+    return;
+  }
+  for (auto _ : state) {
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      ese.init();
+      if (ese.open() < 0 || ese.transceive(kApdu, reply) != 2) {
+        state.SkipWithError("transceive failed");
+        return;
+      }
+      ese.close();
+    }
+  }
+  Report(state, sim);
+}
+BENCHMARK(BM_Pn80tOpenPerRequest)->Arg(1)->Arg(3)->Arg(8)->UseRealTime();
+
+void BM_Pn80tKeepAlive(benchmark::State &state) {
+  SimulatedPn80t sim(kThinkUsec);
+  sim.SetPowerUpTime(kPowerUpUsec);
+  SimEse ese(&sim);
+  android::EseConnection connection(ese, std::chrono::milliseconds(5000));
+  std::vector<uint8_t> reply(258);
+  if (!sim.Start()) {
+    state.SkipWithError("unable to start the simulated device");
+    return;
+  }
+  for (auto _ : state) {
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      if (connection.acquire() < 0 || ese.transceive(kApdu, reply) != 2) {
+        state.SkipWithError("transceive failed");
+        return;
+      }
+    }
+    state.PauseTiming();
+    connection.close();
+    state.ResumeTiming();
+  }
+  Report(state, sim);
+}
+BENCHMARK(BM_Pn80tKeepAlive)->Arg(1)->Arg(3)->Arg(8)->UseRealTime();
+
+// Arg 0 re-opens cold, arg 1 with the power state.
+void BM_Pn80tReopen(benchmark::State &state) {
+  SimulatedPn80t sim(kThinkUsec);
+  sim.SetPowerUpTime(kPowerUpUsec);
+  sim.SetCooldownTime(60);
+  SimEse ese(&sim, state.range(0) ? kSimPn80tWarmOps : kSimPn80tReadyOps);
+  std::vector<uint8_t> reply(258);
+  if (!sim.Start()) {
+    state.SkipWithError("unable to start the simulated device");
+    return;
+  }
+  for (auto _ : state) {
+    const auto start = std::chrono::steady_clock::now();
+    ese.init();
+    if (ese.open() < 0 || ese.transceive(kApdu, reply) != 2) {
+      state.SkipWithError("transceive failed");
+      return;
+    }
+    state.SetIterationTime(std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count());
+    ese.close();
+  }
+  state.counters["power_ups_per_open"] =
+      sim.power_ups / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_Pn80tReopen)->Arg(0)->Arg(1)->UseManualTime();
+
+}  // namespace
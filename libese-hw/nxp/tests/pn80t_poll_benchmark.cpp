@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Compares the one-byte spin poll against the platform readiness hook,
+ * with and without the read-ahead buffer.
+ * Reports host syscalls and bytes read per APDU and the latency between
+ * the card starting its reply and the transceive returning.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <ese/ese.h>
+
+#include "pn80t_sim.h"
+
+static void RunTransceive(benchmark::State& state, const struct EseOperations *ops) {
+  SimulatedPn80t sim(state.range(0));
+  struct EseInterface ese = {
+    .ops = ops,
+    .error = { .is_err = false, .code = 0, .message = NULL },
+    .pad = { 0 },
+  };
+  const uint8_t apdu[] = { 0x80, 0xca, 0x00, 0x00, 0x00 };
+  uint8_t reply[258];
+  int64_t wakeup_ns = 0;
+  if (!sim.Start() || ese_open(&ese, &sim) < 0) {
+    state.SkipWithError("unable to start the simulated device");
+    return;
+  }
+  for (auto _ : state) {
+    if (ese_transceive(&ese, apdu, sizeof(apdu), reply, sizeof(reply)) != 2) {
+      state.SkipWithError("transceive failed");
+      break;
+    }
+    wakeup_ns += SimulatedPn80t::NowNs() - sim.last_reply_ns;
+  }
+  const double iterations = static_cast<double>(state.iterations());
+  state.counters["syscalls_per_apdu"] =
+      (sim.reads + sim.writes + sim.polls + sim.sleeps) / iterations;
+  state.counters["reads_per_apdu"] = sim.reads / iterations;
+  state.counters["bytes_read_per_apdu"] = sim.bytes_read / iterations;
+  state.counters["wakeup_us"] = wakeup_ns / iterations / 1000.0;
+  ese_close(&ese);
+  sim.Stop();
+}
+
+static void BM_Pn80tPollSpin(benchmark::State& state) {
+  RunTransceive(state, kSimPn80tSpinOps);
+}
+BENCHMARK(BM_Pn80tPollSpin)->Arg(200)->Arg(2000)->Arg(20000)->UseRealTime();
+
+static void BM_Pn80tPollReady(benchmark::State& state) {
+  RunTransceive(state, kSimPn80tReadyOps);
+}
+BENCHMARK(BM_Pn80tPollReady)->Arg(0)->Arg(200)->Arg(2000)->Arg(20000)->UseRealTime();
+
+static void BM_Pn80tPollBuffered(benchmark::State& state) {
+  RunTransceive(state, kSimPn80tBufferedOps);
+}
+BENCHMARK(BM_Pn80tPollBuffered)->Arg(0)->Arg(200)->Arg(2000)->Arg(20000)->UseRealTime();
+
+BENCHMARK_MAIN();
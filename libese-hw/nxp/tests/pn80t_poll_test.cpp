@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * What the simulated PN80T's poll statistics learn about a command.
+ */
+
+#include <gtest/gtest.h>
+
+#include <ese/ese.h>
+
+#include "pn80t_sim.h"
+
+namespace {
+
+const uint8_t kApdu[] = {0x80, 0xca, 0x00, 0x00, 0x00};
+const uint16_t kKey = 0x80ca;
+const long kThinkUsec = 20000;
+
+class Pn80tPollTest : public ::testing::Test {
+ protected:
+  Pn80tPollTest() : sim_(0) { sim_.SetThinkTime(kApdu[1], kThinkUsec); }
+
+  void SetUp() override {
+    ese_ = {};
+    ese_.ops = kSimPn80tAdaptiveOps;
+  }
+
+  void TearDown() override {
+    ese_close(&ese_);
+    sim_.Stop();
+  }
+
+  // The first exchange of a session also negotiates the IFS, so it is not
+  // counted in |times|.
+  void Exchange(int times) {
+    ASSERT_TRUE(sim_.Start());
+    ASSERT_EQ(0, ese_open(&ese_, &sim_));
+    for (int i = 0; i <= times; ++i) {
+      uint8_t rx[258];
+      ASSERT_EQ(2,
+                ese_transceive(&ese_, kApdu, sizeof(kApdu), rx, sizeof(rx)));
+    }
+    ASSERT_FALSE(ese_error(&ese_));
+  }
+
+  const struct NxpPollStat *Slot() const {
+    for (const auto &slot : sim_.poll_stats.slots) {
+      if (slot.key == kKey && slot.samples) {
+        return &slot;
+      }
+    }
+    return nullptr;
+  }
+
+  SimulatedPn80t sim_;
+  struct EseInterface ese_;
+};
+
+}  // namespace
+
+TEST_F(Pn80tPollTest, LearnsTheThinkTime) {
+  Exchange(3);
+  const struct NxpPollStat *slot = Slot();
+  ASSERT_NE(nullptr, slot);
+  EXPECT_EQ(3u, slot->samples);
+  EXPECT_EQ(1u, slot->polls);
+  // Samples are taken halfway through the wait in which the reply landed.
+  EXPECT_GT(slot->expect_usec, static_cast<uint32_t>(kThinkUsec / 2));
+}
+
+TEST_F(Pn80tPollTest, LearnsTheFinalReplyAfterAWaitingTimeExtension) {
+  // The WTX request comes at once. Learning from it instead of from the
+  // I-block would put the estimate near zero.
+  sim_.SetWtx(kApdu[1]);
+  Exchange(3);
+  EXPECT_EQ(4u, ese_.stats.wtx_requests);
+  const struct NxpPollStat *slot = Slot();
+  ASSERT_NE(nullptr, slot);
+  EXPECT_EQ(3u, slot->samples);
+  EXPECT_EQ(2u, slot->polls);
+  EXPECT_GT(slot->expect_usec, static_cast<uint32_t>(kThinkUsec / 2));
+}
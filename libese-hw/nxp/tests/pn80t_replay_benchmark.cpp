@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Replays command timing profiles against the fixed-interval spin poll
+ * and the adaptive poll schedule.  Reports host wakeups per APDU and the
+ * mean and tail latency between the card replying and the transceive
+ * returning.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ese/ese.h>
+
+#include "pn80t_sim.h"
+
+namespace {
+
+struct Step {
+  uint8_t ins;
+  long think_usec;
+};
+
+// Card response times by command, as observed on a PN80T.
+// Reads answer quickly while commands writing to NVM take tens of ms.
+const std::vector<Step> kReadMostly = {
+  { 0xca, 400 }, { 0xca, 400 }, { 0xca, 400 }, { 0xb0, 600 },
+  { 0xca, 400 }, { 0xb0, 600 }, { 0x20, 3000 }, { 0xda, 18000 },
+};
+const std::vector<Step> kNvmHeavy = {
+  { 0xe2, 25000 }, { 0xe2, 25000 }, { 0xca, 400 }, { 0xe6, 40000 },
+  { 0xe8, 30000 }, { 0xca, 400 },
+};
+const std::vector<Step> *const kProfiles[] = { &kReadMostly, &kNvmHeavy };
+
+void Replay(benchmark::State& state, const struct EseOperations *ops) {
+  const std::vector<Step>& profile = *kProfiles[state.range(0)];
+  SimulatedPn80t sim(0);
+  for (const Step& step : profile) {
+    sim.SetThinkTime(step.ins, step.think_usec);
+  }
+  struct EseInterface ese = {
+    .ops = ops,
+    .error = { .is_err = false, .code = 0, .message = NULL },
+    .pad = { 0 },
+  };
+  uint8_t reply[258];
+  std::vector<double> wakeup_us;
+  size_t next = 0;
+  if (!sim.Start() || ese_open(&ese, &sim) < 0) {
+    state.SkipWithError("unable to start the simulated device");
+    return;
+  }
+  // Let the adaptive schedule settle on each command first.
+  for (int pass = 0; pass < 4; ++pass) {
+    for (const Step& step : profile) {
+      const uint8_t apdu[] = { 0x80, step.ins, 0x00, 0x00, 0x00 };
+      ese_transceive(&ese, apdu, sizeof(apdu), reply, sizeof(reply));
+    }
+  }
+  sim.ResetCounters();
+  for (auto _ : state) {
+    const uint8_t apdu[] = { 0x80, profile[next].ins, 0x00, 0x00, 0x00 };
+    next = (next + 1) % profile.size();
+    if (ese_transceive(&ese, apdu, sizeof(apdu), reply, sizeof(reply)) != 2) {
+      state.SkipWithError("transceive failed");
+      break;
+    }
+    wakeup_us.push_back((SimulatedPn80t::NowNs() - sim.last_reply_ns) / 1000.0);
+  }
+  const double iterations = static_cast<double>(state.iterations());
+  if (!wakeup_us.empty()) {
+    std::sort(wakeup_us.begin(), wakeup_us.end());
+    double total = 0;
+    for (double us : wakeup_us) {
+      total += us;
+    }
+    state.counters["wakeup_us"] = total / wakeup_us.size();
+    state.counters["wakeup_p99_us"] = wakeup_us[wakeup_us.size() * 99 / 100];
+  }
+  state.counters["wakeups_per_apdu"] = (sim.reads + sim.sleeps) / iterations;
+  ese_close(&ese);
+  sim.Stop();
+}
+
+void BM_Pn80tReplayFixed(benchmark::State& state) {
+  Replay(state, kSimPn80tSpinOps);
+}
+BENCHMARK(BM_Pn80tReplayFixed)->Arg(0)->Arg(1)->UseRealTime();
+
+void BM_Pn80tReplayAdaptive(benchmark::State& state) {
+  Replay(state, kSimPn80tAdaptiveOps);
+}
+BENCHMARK(BM_Pn80tReplayAdaptive)->Arg(0)->Arg(1)->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,492 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <ese/ese.h>
+#include <ese/teq1.h>
+
+#include "pn80t_sim.h"
+
+#define UNUSED(x) UNUSED_ ## x __attribute__((__unused__))
+
+namespace {
+
+constexpr uint8_t kHostAddress = 0xA5;
+constexpr uint8_t kCooldownEnd = 0xC5;
+constexpr uint8_t kCooldownReset = 0xC4;
+constexpr size_t kCooldownReplySize = 32;
+
+SimulatedPn80t *Sim(struct EseInterface *ese) {
+  return reinterpret_cast<SimulatedPn80t *>(NXP_PN80T_STATE(ese)->handle);
+}
+
+bool ReadFully(int fd, uint8_t *buf, size_t len) {
+  while (len) {
+    const ssize_t ret = read(fd, buf, len);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return false;
+    }
+    buf += ret;
+    len -= ret;
+  }
+  return true;
+}
+
+bool WriteFully(int fd, const uint8_t *buf, size_t len) {
+  while (len) {
+    const ssize_t ret = write(fd, buf, len);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return false;
+    }
+    buf += ret;
+    len -= ret;
+  }
+  return true;
+}
+
+void *SimInitialize(void *board) { return board; }
+
+int SimRelease(void *UNUSED(handle)) { return 0; }
+
+int SimToggle(void *handle, int val) {
+  return reinterpret_cast<SimulatedPn80t *>(handle)->ToggleReset(val);
+}
+
+int SimWait(void *handle, long usec) {
+  reinterpret_cast<SimulatedPn80t *>(handle)->sleeps++;
+  return usleep(static_cast<useconds_t>(usec));
+}
+
+int SimWaitForData(void *handle, long *usec) {
+  SimulatedPn80t *sim = reinterpret_cast<SimulatedPn80t *>(handle);
+  struct pollfd pfd = { .fd = sim->host_fd(), .events = POLLIN, .revents = 0 };
+  const int64_t start = SimulatedPn80t::NowNs();
+  sim->polls++;
+  const int ret = poll(&pfd, 1, static_cast<int>((*usec + 999) / 1000));
+  const long elapsed = static_cast<long>((SimulatedPn80t::NowNs() - start) / 1000);
+  *usec = elapsed < *usec ? *usec - elapsed : 0;
+  if (ret < 0) {
+    return -1;
+  }
+  return ret > 0;
+}
+
+// Models SPI: a 1-byte read with nothing pending clocks out a filler byte.
+uint32_t SimReceive(struct EseInterface *ese, uint8_t *buf, uint32_t len,
+                    int UNUSED(complete)) {
+  SimulatedPn80t *sim = Sim(ese);
+  if (len == 0) {
+    return 0;
+  }
+  sim->reads++;
+  sim->bytes_read += len;
+  if (len == 1) {
+    const ssize_t ret = recv(sim->host_fd(), buf, 1, MSG_DONTWAIT);
+    if (ret == 1) {
+      return 1;
+    }
+    if (ret < 0 && errno == EAGAIN) {
+      buf[0] = 0x00;
+      return 1;
+    }
+    ese_set_error(ese, kNxpPn80tErrorReceive);
+    return 0;
+  }
+  if (!ReadFully(sim->host_fd(), buf, len)) {
+    ese_set_error(ese, kNxpPn80tErrorReceive);
+    return 0;
+  }
+  return len;
+}
+
+// Models SPI for whole-frame reads: whatever the card has sent, then filler.
+uint32_t SimReceiveBuffered(struct EseInterface *ese, uint8_t *buf,
+                            uint32_t len, int UNUSED(complete)) {
+  SimulatedPn80t *sim = Sim(ese);
+  uint32_t bytes = nxp_pn80t_read_ahead(ese, buf, len);
+  if (bytes == len) {
+    return len;
+  }
+  sim->reads++;
+  sim->bytes_read += len - bytes;
+  const ssize_t ret = recv(sim->host_fd(), buf + bytes, len - bytes, MSG_DONTWAIT);
+  if (ret < 0 && errno != EAGAIN) {
+    ese_set_error(ese, kNxpPn80tErrorReceive);
+    return 0;
+  }
+  if (ret > 0) {
+    bytes += ret;
+  }
+  memset(buf + bytes, 0x00, len - bytes);
+  return len;
+}
+
+struct NxpReadAhead *SimReadAhead(void *handle) {
+  return &reinterpret_cast<SimulatedPn80t *>(handle)->read_ahead;
+}
+
+struct NxpPollStats *SimPollStats(void *handle) {
+  return &reinterpret_cast<SimulatedPn80t *>(handle)->poll_stats;
+}
+
+struct NxpPowerState *SimPowerState(void *handle) {
+  return &reinterpret_cast<SimulatedPn80t *>(handle)->power_state;
+}
+
+uint32_t SimTransmit(struct EseInterface *ese, const uint8_t *buf,
+                     uint32_t len, int UNUSED(complete)) {
+  SimulatedPn80t *sim = Sim(ese);
+  sim->writes++;
+  if (!WriteFully(sim->host_fd(), buf, len)) {
+    ese_set_error(ese, kNxpPn80tErrorTransmit);
+    return 0;
+  }
+  return len;
+}
+
+const struct Pn80tPlatform kSpinPlatform = {
+  .initialize = &SimInitialize,
+  .release = &SimRelease,
+  .toggle_reset = &SimToggle,
+  .toggle_ven = NULL,
+  .toggle_power_req = NULL,
+  .toggle_bootloader = NULL,
+  .wait = &SimWait,
+  .wait_for_data = NULL,
+  .read_ahead = NULL,
+  .poll_stats = NULL,
+  .power_state = NULL,
+};
+
+const struct Pn80tPlatform kReadyPlatform = {
+  .initialize = &SimInitialize,
+  .release = &SimRelease,
+  .toggle_reset = &SimToggle,
+  .toggle_ven = NULL,
+  .toggle_power_req = NULL,
+  .toggle_bootloader = NULL,
+  .wait = &SimWait,
+  .wait_for_data = &SimWaitForData,
+  .read_ahead = NULL,
+  .poll_stats = NULL,
+  .power_state = NULL,
+};
+
+const struct Pn80tPlatform kBufferedPlatform = {
+  .initialize = &SimInitialize,
+  .release = &SimRelease,
+  .toggle_reset = &SimToggle,
+  .toggle_ven = NULL,
+  .toggle_power_req = NULL,
+  .toggle_bootloader = NULL,
+  .wait = &SimWait,
+  .wait_for_data = &SimWaitForData,
+  .read_ahead = &SimReadAhead,
+  .poll_stats = NULL,
+  .power_state = NULL,
+};
+
+const struct Pn80tPlatform kAdaptivePlatform = {
+  .initialize = &SimInitialize,
+  .release = &SimRelease,
+  .toggle_reset = &SimToggle,
+  .toggle_ven = NULL,
+  .toggle_power_req = NULL,
+  .toggle_bootloader = NULL,
+  .wait = &SimWait,
+  .wait_for_data = NULL,
+  .read_ahead = NULL,
+  .poll_stats = &SimPollStats,
+  .power_state = NULL,
+};
+
+const struct Pn80tPlatform kWarmPlatform = {
+  .initialize = &SimInitialize,
+  .release = &SimRelease,
+  .toggle_reset = &SimToggle,
+  .toggle_ven = NULL,
+  .toggle_power_req = NULL,
+  .toggle_bootloader = NULL,
+  .wait = &SimWait,
+  .wait_for_data = &SimWaitForData,
+  .read_ahead = NULL,
+  .poll_stats = NULL,
+  .power_state = &SimPowerState,
+};
+
+const struct EseOperations kSpinOps = {
+  .name = "Simulated PN80T (spin)",
+  .open = &nxp_pn80t_open,
+  .hw_receive = &SimReceive,
+  .hw_transmit = &SimTransmit,
+  .hw_reset = &nxp_pn80t_reset,
+  .poll = &nxp_pn80t_poll,
+  .transceive = &nxp_pn80t_transceive,
+  .close = &nxp_pn80t_close,
+  .opts = &kSpinPlatform,
+  .errors = kNxpPn80tErrorMessages,
+  .errors_count = kNxpPn80tErrorMax,
+  .transceive_batch = &nxp_pn80t_transceive_batch,
+};
+
+const struct EseOperations kReadyOps = {
+  .name = "Simulated PN80T (ready)",
+  .open = &nxp_pn80t_open,
+  .hw_receive = &SimReceive,
+  .hw_transmit = &SimTransmit,
+  .hw_reset = &nxp_pn80t_reset,
+  .poll = &nxp_pn80t_poll,
+  .transceive = &nxp_pn80t_transceive,
+  .close = &nxp_pn80t_close,
+  .opts = &kReadyPlatform,
+  .errors = kNxpPn80tErrorMessages,
+  .errors_count = kNxpPn80tErrorMax,
+  .transceive_batch = &nxp_pn80t_transceive_batch,
+};
+
+const struct EseOperations kBufferedOps = {
+  .name = "Simulated PN80T (buffered)",
+  .open = &nxp_pn80t_open,
+  .hw_receive = &SimReceiveBuffered,
+  .hw_transmit = &SimTransmit,
+  .hw_reset = &nxp_pn80t_reset,
+  .poll = &nxp_pn80t_poll,
+  .transceive = &nxp_pn80t_transceive,
+  .close = &nxp_pn80t_close,
+  .opts = &kBufferedPlatform,
+  .errors = kNxpPn80tErrorMessages,
+  .errors_count = kNxpPn80tErrorMax,
+  .transceive_batch = &nxp_pn80t_transceive_batch,
+};
+
+const struct EseOperations kAdaptiveOps = {
+  .name = "Simulated PN80T (adaptive)",
+  .open = &nxp_pn80t_open,
+  .hw_receive = &SimReceive,
+  .hw_transmit = &SimTransmit,
+  .hw_reset = &nxp_pn80t_reset,
+  .poll = &nxp_pn80t_poll,
+  .transceive = &nxp_pn80t_transceive,
+  .close = &nxp_pn80t_close,
+  .opts = &kAdaptivePlatform,
+  .errors = kNxpPn80tErrorMessages,
+  .errors_count = kNxpPn80tErrorMax,
+  .transceive_batch = &nxp_pn80t_transceive_batch,
+};
+
+const struct EseOperations kWarmOps = {
+  .name = "Simulated PN80T (warm)",
+  .open = &nxp_pn80t_open,
+  .hw_receive = &SimReceive,
+  .hw_transmit = &SimTransmit,
+  .hw_reset = &nxp_pn80t_reset,
+  .poll = &nxp_pn80t_poll,
+  .transceive = &nxp_pn80t_transceive,
+  .close = &nxp_pn80t_close,
+  .opts = &kWarmPlatform,
+  .errors = kNxpPn80tErrorMessages,
+  .errors_count = kNxpPn80tErrorMax,
+  .transceive_batch = &nxp_pn80t_transceive_batch,
+};
+
+}  // namespace
+
+const struct EseOperations *const kSimPn80tSpinOps = &kSpinOps;
+const struct EseOperations *const kSimPn80tReadyOps = &kReadyOps;
+const struct EseOperations *const kSimPn80tBufferedOps = &kBufferedOps;
+const struct EseOperations *const kSimPn80tAdaptiveOps = &kAdaptiveOps;
+const struct EseOperations *const kSimPn80tWarmOps = &kWarmOps;
+
+SimulatedPn80t::SimulatedPn80t(long think_usec)
+    : reads(0), writes(0), polls(0), sleeps(0), bytes_read(0), power_ups(0),
+      reset_pulls(0),
+      resyncs(0), last_reply_ns(0), read_ahead(), poll_stats(), power_state(),
+      power_up_usec_(0), cooldown_sec_(0), deep_power_down_(false),
+      asleep_(false), reset_high_(false), card_seq_(0), wtx_ins_(0),
+      host_fd_(-1), card_fd_(-1) {
+  think_usec_.fill(think_usec);
+  wtx_.fill(false);
+}
+
+SimulatedPn80t::~SimulatedPn80t() { Stop(); }
+
+int64_t SimulatedPn80t::NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool SimulatedPn80t::Start() {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    return false;
+  }
+  host_fd_ = fds[0];
+  card_fd_ = fds[1];
+  card_ = std::thread(&SimulatedPn80t::CardMain, this);
+  return true;
+}
+
+void SimulatedPn80t::Stop() {
+  if (host_fd_ < 0) {
+    return;
+  }
+  shutdown(host_fd_, SHUT_RDWR);
+  card_.join();
+  close(host_fd_);
+  close(card_fd_);
+  host_fd_ = card_fd_ = -1;
+}
+
+void SimulatedPn80t::ResetCounters() {
+  reads = writes = polls = sleeps = power_ups = reset_pulls = resyncs = 0;
+  bytes_read = 0;
+}
+
+int SimulatedPn80t::ToggleReset(int val) {
+  const bool was_high = reset_high_;
+  reset_high_ = val != 0;
+  if (val) {
+    if (was_high) {
+      return 0;
+    }
+    power_ups++;
+    card_seq_ = 0;
+    asleep_ = false;
+    if (power_up_usec_) {
+      usleep(static_cast<useconds_t>(power_up_usec_));
+    }
+  } else {
+    reset_pulls++;
+  }
+  return 0;
+}
+
+void SimulatedPn80t::CardMain() {
+  struct Teq1Frame frame;
+  while (ReadFully(card_fd_, frame.val, sizeof(frame.header))) {
+    if (!ReadFully(card_fd_, frame.INF, frame.header.LEN + 1)) {
+      return;
+    }
+    if (frame.header.PCB == kCooldownEnd || frame.header.PCB == kCooldownReset) {
+      std::vector<uint8_t> reply(1 + kCooldownReplySize, 0);
+      reply[0] = kHostAddress;
+      if (cooldown_sec_) {
+        // A secure timer TLV asking to stay powered.
+        const uint8_t timer[] = {
+          0xe5, 0x12, 0xf1, 0x04,
+          static_cast<uint8_t>(cooldown_sec_ >> 24),
+          static_cast<uint8_t>(cooldown_sec_ >> 16),
+          static_cast<uint8_t>(cooldown_sec_ >> 8),
+          static_cast<uint8_t>(cooldown_sec_),
+        };
+        std::copy(timer, timer + sizeof(timer), reply.begin() + 1);
+      }
+      if (frame.header.PCB == kCooldownEnd && deep_power_down_) {
+        asleep_ = true;
+      }
+      if (!WriteFully(card_fd_, reply.data(), reply.size())) {
+        return;
+      }
+      continue;
+    }
+    if (asleep_) {
+      asleep_ = false;
+      card_seq_ = 0;
+      continue;
+    }
+    if (frame.header.PCB == TEQ1_S_RESYNC(0)) {
+      resyncs++;
+      card_seq_ = 0;
+      frame.header.NAD = 0x00;
+      frame.header.PCB = TEQ1_S_RESYNC(1);
+      frame.header.LEN = 0;
+      frame.INF[0] = teq1_compute_LRC(&frame);
+      frame.header.NAD = kHostAddress;
+      if (!WriteFully(card_fd_, frame.val, sizeof(frame.header) + 1)) {
+        return;
+      }
+      continue;
+    }
+    if (frame.header.PCB == TEQ1_S_IFS(0)) {
+      // Accept whatever IFSD the host advertises.
+      frame.header.NAD = 0x00;
+      frame.header.PCB = TEQ1_S_IFS(1);
+      frame.INF[1] = teq1_compute_LRC(&frame);
+      frame.header.NAD = kHostAddress;
+      if (!WriteFully(card_fd_, frame.val, sizeof(frame.header) + 2)) {
+        return;
+      }
+      continue;
+    }
+    if (frame.header.PCB == TEQ1_S_WTX(1)) {
+      // The host granted the extension asked for below.
+      if (!Reply(wtx_ins_)) {
+        return;
+      }
+      continue;
+    }
+    const uint8_t type = bs_get(PCB.type, frame.header.PCB);
+    if (type != kPcbTypeInfo0 && type != kPcbTypeInfo1) {
+      continue;
+    }
+    if (wtx_[frame.INF[1]]) {
+      wtx_ins_ = frame.INF[1];
+      frame.header.NAD = 0x00;
+      frame.header.PCB = TEQ1_S_WTX(0);
+      frame.header.LEN = 1;
+      frame.INF[0] = 1;
+      frame.INF[1] = teq1_compute_LRC(&frame);
+      frame.header.NAD = kHostAddress;
+      if (!WriteFully(card_fd_, frame.val, sizeof(frame.header) + 2)) {
+        return;
+      }
+      continue;
+    }
+    if (!Reply(frame.INF[1])) {
+      return;
+    }
+  }
+}
+
+bool SimulatedPn80t::Reply(uint8_t ins) {
+  struct Teq1Frame frame;
+  usleep(static_cast<useconds_t>(think_usec_[ins]));
+  frame.header.NAD = 0x00;  // PN80T computes the LRC with a zero NAD.
+  const uint8_t seq = card_seq_;
+  frame.header.PCB = TEQ1_I(seq, 0);
+  frame.header.LEN = 2;
+  frame.INF[0] = 0x90;
+  frame.INF[1] = 0x00;
+  frame.INF[2] = teq1_compute_LRC(&frame);
+  frame.header.NAD = kHostAddress;
+  card_seq_ = !seq;
+  last_reply_ns = NowNs();
+  return WriteFully(card_fd_, frame.val, sizeof(frame.header) + 3);
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * A minimal simulated PN80T for exercising the common pn80t code
+ * without hardware.  The "card" runs on its own thread at the other end
+ * of a socketpair and answers each I-block with 90 00 after a fixed think
+ * time.  Host-side syscalls are counted so that benchmarks can compare
+ * the cost of the different polling strategies.  Releasing reset can be
+ * made to take a power-up time so that opening the device costs what it
+ * does on hardware.
+ */
+
+#ifndef PN80T_SIM_H_
+#define PN80T_SIM_H_ 1
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <ese/ese.h>
+extern "C" {
+#include <ese/hw/nxp/pn80t/common.h>
+}
+
+class SimulatedPn80t {
+ public:
+  explicit SimulatedPn80t(long think_usec);
+  ~SimulatedPn80t();
+
+  // Starts the card thread. Pass |this| as the hw_opts to ese_open().
+  bool Start();
+  void Stop();
+
+  // Overrides the think time for commands with the given INS.
+  // Must be called before Start().
+  void SetThinkTime(uint8_t ins, long usec) { think_usec_[ins] = usec; }
+  // Makes the card ask for a waiting time extension before thinking about
+  // commands with the given INS. Must be called before Start().
+  void SetWtx(uint8_t ins) { wtx_[ins] = true; }
+  // Sets how long releasing reset blocks while the chip boots.
+  void SetPowerUpTime(long usec) { power_up_usec_ = usec; }
+  // Sets the secure timer reported at the end of a session, which asks
+  // for the chip to be left powered. Must be called before Start().
+  void SetCooldownTime(uint32_t sec) { cooldown_sec_ = sec; }
+  // Makes the chip enter deep power-down after the end of a session. The
+  // next frame wakes it, with its T=1 state restarted, but is lost.
+  void SetDeepPowerDown(bool dpd) { deep_power_down_ = dpd; }
+
+  // Backs the platform's toggle_reset(): releasing reset powers the card up,
+  // restarting its T=1 sequence numbers and waking it from deep power-down.
+  // Holding reset high when it already is does nothing.
+  int ToggleReset(int val);
+
+  int host_fd() const { return host_fd_; }
+  void ResetCounters();
+
+  // Host-side syscall counters.
+  std::atomic<uint32_t> reads;
+  std::atomic<uint32_t> writes;
+  std::atomic<uint32_t> polls;
+  std::atomic<uint32_t> sleeps;
+  // Bytes clocked in by reads, filler included.
+  std::atomic<uint64_t> bytes_read;
+  // Times reset has been released.
+  std::atomic<uint32_t> power_ups;
+  // Times reset has been pulled.
+  std::atomic<uint32_t> reset_pulls;
+  // S(RESYNC) requests the card answered.
+  std::atomic<uint32_t> resyncs;
+  // When the card last started sending a reply.
+  std::atomic<int64_t> last_reply_ns;
+  // Used by |kSimPn80tBufferedOps|.
+  struct NxpReadAhead read_ahead;
+  // Used by |kSimPn80tAdaptiveOps|.
+  struct NxpPollStats poll_stats;
+  // Used by |kSimPn80tWarmOps|.
+  struct NxpPowerState power_state;
+
+  static int64_t NowNs();
+
+ private:
+  void CardMain();
+  bool Reply(uint8_t ins);
+
+  std::array<long, 256> think_usec_;
+  std::array<bool, 256> wtx_;
+  long power_up_usec_;
+  uint32_t cooldown_sec_;
+  bool deep_power_down_;
+  std::atomic<bool> asleep_;
+  bool reset_high_;
+  std::atomic<uint8_t> card_seq_;
+  uint8_t wtx_ins_;
+  int host_fd_;
+  int card_fd_;
+  std::thread card_;
+};
+
+// Operations using the PN80T common code over the simulated wire.
+// |kSimPn80tSpinOps| polls by reading one byte per interval and
+// |kSimPn80tReadyOps| supplies the platform readiness hook.
+extern const struct EseOperations *const kSimPn80tSpinOps;
+extern const struct EseOperations *const kSimPn80tReadyOps;
+// |kSimPn80tBufferedOps| adds the read-ahead buffer to |kSimPn80tReadyOps|.
+extern const struct EseOperations *const kSimPn80tBufferedOps;
+// |kSimPn80tAdaptiveOps| adds poll statistics to |kSimPn80tSpinOps|.
+extern const struct EseOperations *const kSimPn80tAdaptiveOps;
+// |kSimPn80tWarmOps| adds the power state to |kSimPn80tReadyOps|.
+extern const struct EseOperations *const kSimPn80tWarmOps;
+
+#endif  // PN80T_SIM_H_
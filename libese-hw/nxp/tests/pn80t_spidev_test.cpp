@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * The spidev backend against a userspace emulation of a spidev node.  The
+ * test is linked with --wrap=ioctl, so ioctls on the board's node are
+ * answered here: transfers go to and from the simulated PN80T, with a
+ * read clocking out a filler byte when the card has nothing to send.
+ */
+
+#include <errno.h>
+#include <linux/spi/spidev.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ese/ese.h>
+#include <ese/hw/nxp/pn80t/boards/emulated-spidev.h>
+
+#include "pn80t_sim.h"
+
+ESE_INCLUDE_HW(ESE_HW_NXP_PN80T_SPIDEV);
+
+extern "C" int __real_ioctl(int fd, unsigned long request, ...);
+extern "C" int __wrap_ioctl(int fd, unsigned long request, ...);
+
+namespace {
+
+const uint8_t kApdu[] = {0x80, 0xca, 0x00, 0x00, 0x00};
+const uint32_t kPollDelayUsecs = 100;
+
+// The emulated node and what it has been asked to do.
+struct EmulatedSpidev {
+  ino_t ino = 0;
+  SimulatedPn80t *card = nullptr;
+  uint32_t bus_ioctls = 0;
+  std::vector<std::vector<struct spi_ioc_transfer>> messages;
+};
+
+EmulatedSpidev emulated;
+
+bool IsEmulated(int fd) {
+  struct stat st;
+  return emulated.card && fstat(fd, &st) == 0 && st.st_ino == emulated.ino;
+}
+
+int Transfer(const struct spi_ioc_transfer &tr) {
+  const int fd = emulated.card->host_fd();
+  if (tr.tx_buf) {
+    if (send(fd, reinterpret_cast<const void *>(tr.tx_buf), tr.len, 0) !=
+        static_cast<ssize_t>(tr.len)) {
+      return -1;
+    }
+  }
+  if (tr.rx_buf) {
+    uint8_t *buf = reinterpret_cast<uint8_t *>(tr.rx_buf);
+    // A single byte is a poll; longer reads are for a frame being sent.
+    const int flags = tr.len == 1 ? MSG_DONTWAIT : MSG_WAITALL;
+    const ssize_t ret = recv(fd, buf, tr.len, flags);
+    if (tr.len == 1 && ret < 0 && errno == EAGAIN) {
+      buf[0] = 0x00;
+    } else if (ret != static_cast<ssize_t>(tr.len)) {
+      return -1;
+    }
+  }
+  if (tr.delay_usecs) {
+    usleep(tr.delay_usecs);
+  }
+  return static_cast<int>(tr.len);
+}
+
+int Message(const struct spi_ioc_transfer *tr, size_t n) {
+  int total = 0;
+  emulated.messages.emplace_back(tr, tr + n);
+  for (size_t i = 0; i < n; ++i) {
+    const int ret = Transfer(tr[i]);
+    if (ret < 0) {
+      errno = EIO;
+      return -1;
+    }
+    total += ret;
+  }
+  return total;
+}
+
+class Pn80tSpidevTest : public ::testing::Test {
+ protected:
+  Pn80tSpidevTest() : sim_(0), board_(nxp_boards_emulated_spidev) {
+    board_.poll_delay_usecs = kPollDelayUsecs;
+  }
+
+  void SetUp() override {
+    char path[] = "/tmp/spidev-emu-XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    struct stat st;
+    ASSERT_EQ(0, fstat(fd, &st));
+    close(fd);
+    path_ = path;
+    board_.dev_path = path_.c_str();
+    emulated = EmulatedSpidev();
+    emulated.ino = st.st_ino;
+    emulated.card = &sim_;
+    ese_ = ESE_INITIALIZER(ESE_HW_NXP_PN80T_SPIDEV);
+    ASSERT_TRUE(sim_.Start());
+  }
+
+  void TearDown() override {
+    ese_close(&ese_);
+    sim_.Stop();
+    emulated.card = nullptr;
+    unlink(path_.c_str());
+  }
+
+  SimulatedPn80t sim_;
+  struct NxpSpiBoard board_;
+  std::string path_;
+  struct EseInterface ese_;
+};
+
+}  // namespace
+
+int __wrap_ioctl(int fd, unsigned long request, ...) {
+  va_list ap;
+  va_start(ap, request);
+  void *arg = va_arg(ap, void *);
+  va_end(ap);
+  if (!IsEmulated(fd)) {
+    return __real_ioctl(fd, request, arg);
+  }
+  if (request == SPI_IOC_WR_MODE || request == SPI_IOC_WR_BITS_PER_WORD ||
+      request == SPI_IOC_WR_MAX_SPEED_HZ) {
+    emulated.bus_ioctls++;
+    return 0;
+  }
+  if (_IOC_TYPE(request) == SPI_IOC_MAGIC && _IOC_NR(request) == 0 &&
+      _IOC_DIR(request) == _IOC_WRITE) {
+    return Message(static_cast<const struct spi_ioc_transfer *>(arg),
+                   _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer));
+  }
+  errno = ENOTTY;
+  return -1;
+}
+
+TEST_F(Pn80tSpidevTest, ChainsTheDelayAndFirstPollWithEachFrame) {
+  ASSERT_EQ(0, ese_open(&ese_, &board_));
+  for (int i = 0; i < 3; ++i) {
+    uint8_t rx[258];
+    ASSERT_EQ(2,
+              ese_transceive(&ese_, kApdu, sizeof(kApdu), rx, sizeof(rx)));
+    EXPECT_EQ(0x90, rx[0]);
+    EXPECT_EQ(0x00, rx[1]);
+  }
+  EXPECT_FALSE(ese_error(&ese_));
+  EXPECT_EQ(0u, emulated.bus_ioctls);
+
+  uint32_t frames = 0;
+  uint32_t segmented = 0;
+  for (const auto &message : emulated.messages) {
+    if (!message.front().tx_buf) {
+      continue;
+    }
+    // The frame's segments, the last of them delayed, then a 1-byte read.
+    frames++;
+    ASSERT_GE(message.size(), 2u);
+    if (message.size() > 2) {
+      segmented++;
+    }
+    const struct spi_ioc_transfer &last_tx = message[message.size() - 2];
+    const struct spi_ioc_transfer &poll = message.back();
+    for (size_t i = 0; i + 1 < message.size(); ++i) {
+      EXPECT_NE(0u, message[i].tx_buf);
+      EXPECT_EQ(0u, message[i].rx_buf);
+    }
+    EXPECT_EQ(kPollDelayUsecs, last_tx.delay_usecs);
+    EXPECT_EQ(0u, last_tx.cs_change);
+    EXPECT_EQ(0u, poll.tx_buf);
+    EXPECT_NE(0u, poll.rx_buf);
+    EXPECT_EQ(1u, poll.len);
+  }
+  // At least one frame per APDU. Zero copy sends the header and the APDU as
+  // separate transfers of the same message.
+  EXPECT_GE(frames, 3u);
+  EXPECT_GT(segmented, 0u);
+}
+
+TEST_F(Pn80tSpidevTest, SetsUpTheBusUnlessEmulated) {
+  board_.emulated = 0;
+  ASSERT_EQ(0, ese_open(&ese_, &board_));
+  EXPECT_EQ(3u, emulated.bus_ioctls);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Re-opening the simulated PN80T after a session which asked for it to be
+ * left powered for a cooldown timer.
+ */
+
+#include <gtest/gtest.h>
+
+#include <ese/ese.h>
+#include <ese/teq1.h>
+
+#include "pn80t_sim.h"
+
+namespace {
+
+const uint8_t kApdu[] = {0x80, 0xca, 0x00, 0x00, 0x00};
+
+class Pn80tWarmTest : public ::testing::Test {
+ protected:
+  Pn80tWarmTest() : sim_(0) { sim_.SetCooldownTime(60); }
+
+  int Open() {
+    ese_ = {};
+    ese_.ops = kSimPn80tWarmOps;
+    return ese_open(&ese_, &sim_);
+  }
+
+  int Transceive() {
+    uint8_t rx[258];
+    return ese_transceive(&ese_, kApdu, sizeof(kApdu), rx, sizeof(rx));
+  }
+
+  // A first session, which leaves the chip powered.
+  void FirstSession() {
+    ASSERT_TRUE(sim_.Start());
+    ASSERT_EQ(0, Open());
+    ASSERT_EQ(2, Transceive());
+    ASSERT_EQ(2, Transceive());
+    ese_close(&ese_);
+    ASSERT_EQ(1u, sim_.power_ups);
+  }
+
+  SimulatedPn80t sim_;
+  struct EseInterface ese_;
+};
+
+}  // namespace
+
+TEST_F(Pn80tWarmTest, ResumesAChipThatIsAwake) {
+  FirstSession();
+  ASSERT_EQ(0, Open());
+  EXPECT_EQ(1u, sim_.power_ups);
+  EXPECT_EQ(0u, sim_.reset_pulls);
+  EXPECT_EQ(1u, sim_.resyncs);
+  // The probe went through T=1, so it is counted and traced.
+  EXPECT_EQ(1u, ese_.stats.resyncs);
+  struct Teq1TraceRecord trace[2];
+  ASSERT_EQ(2u, teq1_trace_snapshot(trace, 2));
+  EXPECT_EQ(kTeq1TraceTransmit, trace[0].direction);
+  EXPECT_EQ(TEQ1_S_RESYNC(0), trace[0].pcb);
+  EXPECT_EQ(kTeq1TraceReceive, trace[1].direction);
+  EXPECT_EQ(TEQ1_S_RESYNC(1), trace[1].pcb);
+  // RESYNC restarted the sequence numbers on both ends.
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(2, Transceive());
+  }
+  EXPECT_FALSE(ese_error(&ese_));
+  ese_close(&ese_);
+}
+
+TEST_F(Pn80tWarmTest, StartsOverWithAChipInDeepPowerDown) {
+  sim_.SetDeepPowerDown(true);
+  FirstSession();
+  ASSERT_EQ(0, Open());
+  // The lost probe woke the chip; reset was left alone.
+  EXPECT_EQ(1u, sim_.power_ups);
+  EXPECT_EQ(0u, sim_.reset_pulls);
+  EXPECT_EQ(0u, sim_.resyncs);
+  EXPECT_EQ(1u, ese_.stats.resyncs);
+  EXPECT_EQ(2, Transceive());
+  EXPECT_FALSE(ese_error(&ese_));
+  ese_close(&ese_);
+}
+
+TEST_F(Pn80tWarmTest, OpensColdWithoutACooldown) {
+  sim_.SetCooldownTime(0);
+  FirstSession();
+  ASSERT_EQ(0, Open());
+  EXPECT_EQ(2u, sim_.power_ups);
+  EXPECT_EQ(1u, sim_.reset_pulls);
+  EXPECT_EQ(0u, sim_.resyncs);
+  EXPECT_EQ(2, Transceive());
+  ese_close(&ese_);
+}
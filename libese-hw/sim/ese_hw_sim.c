@@ -0,0 +1,515 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Implements the card side of T=1 in-process. See ese/hw/sim/sim.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <ese/ese.h>
+#include <ese/log.h>
+#include <ese/sysdeps.h>
+#include <ese/teq1.h>
+
+#include "include/ese/hw/sim/sim.h"
+
+#define SIM_HOST_ADDRESS 0xA5
+#define SIM_NODE_ADDRESS 0x5A
+
+/* What the card does once the host has answered its S(IFS) request. */
+enum SimAfterIfs {
+  kSimAfterIfsNone,
+  kSimAfterIfsAck,
+  kSimAfterIfsRespond,
+};
+
+struct SimCard {
+  struct EseSimConfig config;
+  struct EseSimStats stats;
+  struct Teq1ProtocolOptions opts;
+  uint32_t rng;
+  /* Bus time owed, below a microsecond, carried to the next transfer. */
+  uint32_t bus_ns;
+  /* When the card is done processing the current command APDU. */
+  uint64_t busy_until;
+  /* Frame being transmitted by the host. */
+  struct Teq1Frame in;
+  uint32_t in_len;
+  /* Frame waiting to be read by the host, its read position and when it
+   * reaches the bus. */
+  struct Teq1Frame out;
+  uint32_t out_len;
+  uint32_t out_pos;
+  uint64_t out_ready;
+  /* The last frame sent, for retransmission. */
+  struct Teq1Frame last;
+  /* N(S) expected from the host and the next N(S) of the card. */
+  int host_seq;
+  int card_seq;
+  /* Largest INF the host will take, from its S(IFS). */
+  uint8_t ifsd;
+  /* Largest INF the card will take, once the host agreed to it. */
+  uint8_t ifsc;
+  /* Set while the card still has to send its S(IFS) request. */
+  bool ifs_pending;
+  enum SimAfterIfs after_ifs;
+  uint32_t wtx_left;
+  /* Command being assembled, then the response being sent. */
+  uint8_t *cmd;
+  uint32_t cmd_len;
+  uint8_t *rsp;
+  uint32_t rsp_len;
+  uint32_t rsp_sent;
+};
+
+/* The front of pad[] holds the struct Teq1CardState. */
+#define SIM_CARD(ese) \
+  (*(struct SimCard **)(&ese->pad[ESE_INTERFACE_STATE_PAD / 2]))
+
+static uint32_t sim_random(struct SimCard *card) {
+  /* xorshift32: repeatable for a given seed and cheap. */
+  uint32_t x = card->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  card->rng = x;
+  return x;
+}
+
+static bool sim_chance(struct SimCard *card, uint32_t ppm) {
+  return ppm && sim_random(card) % 1000000 < ppm;
+}
+
+static void sim_wait_until(uint64_t deadline) {
+  uint64_t now;
+  while ((now = ese_monotonic_usec()) < deadline) {
+    /* Sleep through most of it and spin out the rest to stay accurate. */
+    if (deadline - now > 200) {
+      usleep((useconds_t)(deadline - now - 100));
+    }
+  }
+}
+
+/* Holds the caller for the time |len| bytes spend on the bus. */
+static void sim_bus(struct SimCard *card, uint32_t len) {
+  uint64_t ns;
+  if (!card->config.byte_time_ns || !len) {
+    return;
+  }
+  ns = (uint64_t)len * card->config.byte_time_ns + card->bus_ns;
+  card->bus_ns = ns % 1000;
+  sim_wait_until(ese_monotonic_usec() + ns / 1000);
+}
+
+/* Queues |frame| for the host, keeping a clean copy for retransmission. */
+static void sim_send(struct SimCard *card, const struct Teq1Frame *frame) {
+  if (frame != &card->last) {
+    memcpy(&card->last, frame, sizeof(frame->header) + frame->header.LEN);
+  }
+  card->stats.frames_sent++;
+  if (sim_chance(card, card->config.drop_ppm)) {
+    card->stats.frames_dropped++;
+    card->out_len = card->out_pos = 0;
+    return;
+  }
+  memcpy(&card->out, &card->last, sizeof(frame->header) + frame->header.LEN);
+  card->out.header.NAD = SIM_HOST_ADDRESS;
+  card->out.INF[card->out.header.LEN] = teq1_compute_LRC(&card->out);
+  if (sim_chance(card, card->config.lrc_error_ppm)) {
+    card->out.INF[card->out.header.LEN] ^= 0x01;
+    card->stats.lrc_errors_injected++;
+  }
+  card->out_len = sizeof(card->out.header) + card->out.header.LEN + 1;
+  card->out_pos = 0;
+  /* Only the answer to a command has to wait for the card to finish. */
+  card->out_ready = 0;
+  if (bs_get(PCB.type, card->out.header.PCB) == kPcbTypeInfo0 ||
+      bs_get(PCB.type, card->out.header.PCB) == kPcbTypeInfo1) {
+    card->out_ready = card->busy_until;
+  }
+}
+
+/* |errors| takes kTeq1RrParityError and kTeq1RrOtherError. */
+static void sim_send_r(struct SimCard *card, uint8_t errors) {
+  struct Teq1Frame frame;
+  frame.header.PCB = TEQ1_R(card->host_seq, 0, 0) | errors;
+  frame.header.LEN = 0;
+  sim_send(card, &frame);
+}
+
+static void sim_send_s(struct SimCard *card, uint8_t pcb, uint8_t len,
+                       uint8_t inf) {
+  struct Teq1Frame frame;
+  frame.header.PCB = pcb;
+  frame.header.LEN = len;
+  frame.INF[0] = inf;
+  sim_send(card, &frame);
+}
+
+/* Sends the next block of the response. */
+static void sim_send_response(struct SimCard *card) {
+  struct Teq1Frame frame;
+  uint32_t len = card->rsp_len - card->rsp_sent;
+  int more = 0;
+  if (len > card->ifsd) {
+    len = card->ifsd;
+    more = 1;
+  }
+  frame.header.PCB = TEQ1_I(card->card_seq, more);
+  frame.header.LEN = (uint8_t)len;
+  memcpy(frame.INF, card->rsp + card->rsp_sent, len);
+  card->rsp_sent += len;
+  card->card_seq = !card->card_seq;
+  sim_send(card, &frame);
+}
+
+/* Answers a complete command APDU, after any S(WTX) requests. */
+static void sim_respond(struct SimCard *card) {
+  if (card->wtx_left) {
+    card->wtx_left--;
+    card->stats.wtx_sent++;
+    sim_send_s(card, TEQ1_S_WTX(0), 1,
+               card->config.wtx_multiplier ? card->config.wtx_multiplier : 1);
+    return;
+  }
+  sim_send_response(card);
+}
+
+/* Sends |after| now, or once the host has answered the card's S(IFS). */
+static void sim_reply(struct SimCard *card, enum SimAfterIfs after) {
+  if (card->ifs_pending) {
+    card->after_ifs = after;
+    card->stats.ifs_requests++;
+    sim_send_s(card, TEQ1_S_IFS(0), 1, (uint8_t)card->config.ifsc);
+    return;
+  }
+  if (after == kSimAfterIfsAck) {
+    sim_send_r(card, 0);
+  } else if (after == kSimAfterIfsRespond) {
+    sim_respond(card);
+  }
+}
+
+static void sim_handle_apdu(struct SimCard *card) {
+  const uint64_t start = ese_monotonic_usec();
+  uint32_t len = 0;
+  card->stats.apdus++;
+  if (card->config.handler) {
+    len = card->config.handler(card->config.handler_ctx, card->cmd,
+                               card->cmd_len, card->rsp, ESE_SIM_APDU_MAX);
+    if (len == 0 || len > ESE_SIM_APDU_MAX) {
+      card->rsp[0] = 0x6F;
+      card->rsp[1] = 0x00;
+      len = 2;
+    }
+  } else {
+    memcpy(card->rsp, card->cmd, card->cmd_len);
+    card->rsp[card->cmd_len] = 0x90;
+    card->rsp[card->cmd_len + 1] = 0x00;
+    len = card->cmd_len + 2;
+  }
+  card->rsp_len = len;
+  card->rsp_sent = 0;
+  card->cmd_len = 0;
+  card->wtx_left = card->config.wtx_count;
+  card->busy_until = start + card->config.think_time_us;
+  sim_reply(card, kSimAfterIfsRespond);
+}
+
+static void sim_handle_frame(struct SimCard *card) {
+  struct Teq1Frame *frame = &card->in;
+  const uint8_t pcb = frame->header.PCB;
+  card->stats.frames_received++;
+  if (sim_chance(card, card->config.parity_error_ppm)) {
+    card->stats.parity_errors_injected++;
+    sim_send_r(card, kTeq1RrParityError);
+    return;
+  }
+  if (card->in_len != sizeof(frame->header) + frame->header.LEN + 1 ||
+      teq1_compute_LRC(frame) != frame->INF[frame->header.LEN]) {
+    card->stats.lrc_errors_seen++;
+    sim_send_r(card, kTeq1RrParityError);
+    return;
+  }
+  switch (bs_get(PCB.type, pcb)) {
+  case kPcbTypeInfo0:
+  case kPcbTypeInfo1:
+    if (bs_get(PCB.I.send_seq, pcb) != card->host_seq) {
+      /* Our answer to it was lost; send it again. */
+      card->stats.retransmits++;
+      sim_send(card, &card->last);
+      return;
+    }
+    if (card->ifsc && frame->header.LEN > card->ifsc) {
+      card->stats.oversized_blocks++;
+      sim_send_r(card, kTeq1RrOtherError);
+      return;
+    }
+    if (card->cmd_len + frame->header.LEN > ESE_SIM_APDU_MAX - 2) {
+      sim_send_r(card, 0);
+      return;
+    }
+    memcpy(card->cmd + card->cmd_len, frame->INF, frame->header.LEN);
+    card->cmd_len += frame->header.LEN;
+    card->host_seq = !card->host_seq;
+    if (bs_get(PCB.I.more_data, pcb)) {
+      sim_reply(card, kSimAfterIfsAck);
+      return;
+    }
+    sim_handle_apdu(card);
+    return;
+  case kPcbTypeReceiveReady:
+    /* An acknowledgement asking for the next block of a chain. */
+    if (bs_get(PCB.type, card->last.header.PCB) != kPcbTypeReceiveReady &&
+        bs_get(PCB.type, card->last.header.PCB) != kPcbTypeSupervisory &&
+        bs_get(PCB.I.more_data, card->last.header.PCB) &&
+        bs_get(PCB.R.next_seq, pcb) == card->card_seq &&
+        !(pcb & (kTeq1RrParityError | kTeq1RrOtherError))) {
+      sim_send_response(card);
+      return;
+    }
+    card->stats.retransmits++;
+    sim_send(card, &card->last);
+    return;
+  default:
+    break;
+  }
+  switch (pcb) {
+  case TEQ1_S_IFS(0):
+    if (frame->INF[0] != 0 && frame->INF[0] != 255) {
+      card->ifsd = frame->INF[0];
+    }
+    sim_send_s(card, TEQ1_S_IFS(1), 1, frame->INF[0]);
+    return;
+  case TEQ1_S_IFS(1):
+    if (!card->ifs_pending || frame->header.LEN != 1 ||
+        frame->INF[0] != card->config.ifsc) {
+      card->stats.retransmits++;
+      sim_send(card, &card->last);
+      return;
+    }
+    card->ifs_pending = false;
+    card->ifsc = frame->INF[0];
+    sim_reply(card, card->after_ifs);
+    card->after_ifs = kSimAfterIfsNone;
+    return;
+  case TEQ1_S_WTX(1):
+    sim_respond(card);
+    return;
+  case TEQ1_S_RESYNC(0):
+    card->stats.resyncs++;
+    card->host_seq = 0;
+    card->card_seq = 0;
+    card->ifsd = IFSC;
+    card->ifsc = 0;
+    card->ifs_pending = card->config.ifsc != 0;
+    card->after_ifs = kSimAfterIfsNone;
+    card->cmd_len = 0;
+    card->busy_until = 0;
+    sim_send_s(card, TEQ1_S_RESYNC(1), 0, 0);
+    return;
+  default:
+    card->stats.retransmits++;
+    sim_send(card, &card->last);
+    return;
+  }
+}
+
+static const struct Teq1ProtocolOptions kTeq1Options = {
+    .host_address = SIM_HOST_ADDRESS,
+    .node_address = SIM_NODE_ADDRESS,
+    .bwt = 1.624f,
+    .etu = 0.00015f,
+    .preprocess = NULL,
+    .lrc_nad_override = false,
+    .lrc_nad = 0x00,
+    .ifsd = 0,
+};
+
+static void sim_close_card(struct SimCard *card) {
+  free(card->cmd);
+  free(card->rsp);
+  free(card);
+}
+
+static int sim_open(struct EseInterface *ese, void *hw_opts) {
+  const struct EseSimConfig *config = hw_opts;
+  struct SimCard *card;
+  _static_assert(sizeof(ese->pad) / 2 >= sizeof(struct SimCard *),
+                 "Pad size too small to use simulated HW");
+  card = calloc(1, sizeof(*card));
+  if (!card) {
+    return -1;
+  }
+  card->cmd = malloc(ESE_SIM_APDU_MAX);
+  card->rsp = malloc(ESE_SIM_APDU_MAX);
+  if (!card->cmd || !card->rsp) {
+    sim_close_card(card);
+    return -1;
+  }
+  if (config) {
+    card->config = *config;
+  }
+  if (card->config.ifsc > 254 || card->config.wtx_multiplier > 255) {
+    ALOGE("Unusable simulated card IFSC or WTX multiplier");
+    sim_close_card(card);
+    return -1;
+  }
+  card->opts = kTeq1Options;
+  if (card->config.bwt_us) {
+    card->opts.bwt = card->config.bwt_us / 1000000.0f;
+  }
+  card->rng = card->config.seed ? card->config.seed : 1;
+  card->ifsd = IFSC;
+  card->ifs_pending = card->config.ifsc != 0;
+  TEQ1_INIT_CARD_STATE((struct Teq1CardState *)(&ese->pad[0]));
+  SIM_CARD(ese) = card;
+  return 0;
+}
+
+static void sim_close(struct EseInterface *ese) {
+  struct SimCard *card = SIM_CARD(ese);
+  if (!card) {
+    return;
+  }
+  sim_close_card(card);
+  SIM_CARD(ese) = NULL;
+}
+
+static uint32_t sim_receive(struct EseInterface *ese, uint8_t *buf,
+                            uint32_t len, int complete) {
+  struct SimCard *card = SIM_CARD(ese);
+  uint32_t avail = card->out_len - card->out_pos;
+  if (len > avail) {
+    len = avail;
+  }
+  if (buf) {
+    memcpy(buf, card->out.val + card->out_pos, len);
+  }
+  sim_bus(card, len);
+  card->out_pos += len;
+  if (complete) {
+    card->out_len = card->out_pos = 0;
+  }
+  return len;
+}
+
+static void sim_accept(struct SimCard *card, const uint8_t *buf,
+                       uint32_t len) {
+  /* Anything past a whole frame is dropped and fails the length check. */
+  uint32_t room;
+  if (card->in_len > sizeof(card->in.val)) {
+    return;
+  }
+  room = sizeof(card->in.val) - card->in_len;
+  if (len > room) {
+    memcpy(card->in.val + card->in_len, buf, room);
+    card->in_len = sizeof(card->in.val) + 1;
+    return;
+  }
+  memcpy(card->in.val + card->in_len, buf, len);
+  card->in_len += len;
+}
+
+static void sim_frame_done(struct SimCard *card) {
+  if (sim_chance(card, card->config.drop_ppm)) {
+    card->stats.frames_dropped++;
+  } else {
+    sim_handle_frame(card);
+  }
+  card->in_len = 0;
+}
+
+static uint32_t sim_transmit(struct EseInterface *ese, const uint8_t *buf,
+                             uint32_t len, int complete) {
+  struct SimCard *card = SIM_CARD(ese);
+  sim_accept(card, buf, len);
+  sim_bus(card, len);
+  if (complete) {
+    sim_frame_done(card);
+  }
+  return len;
+}
+
+static uint32_t sim_transmit_sg(struct EseInterface *ese,
+                                const struct EseSgBuffer *bufs, uint32_t segs,
+                                int complete) {
+  struct SimCard *card = SIM_CARD(ese);
+  uint32_t total = 0;
+  uint32_t i;
+  for (i = 0; i < segs; ++i) {
+    sim_accept(card, bufs[i].c_base, bufs[i].len);
+    total += bufs[i].len;
+  }
+  sim_bus(card, total);
+  if (complete) {
+    sim_frame_done(card);
+  }
+  return total;
+}
+
+static int sim_poll(struct EseInterface *ese, uint8_t poll_for, float timeout,
+                    int complete) {
+  struct SimCard *card = SIM_CARD(ese);
+  const uint64_t deadline = ese_monotonic_usec() + (uint64_t)(timeout * 1e6f);
+  /* A lost frame, or an answer later than the timeout, is waited out. */
+  if (card->out_pos >= card->out_len || card->out_ready > deadline) {
+    sim_wait_until(deadline);
+    return -1;
+  }
+  sim_wait_until(card->out_ready);
+  if (card->out.val[card->out_pos] != poll_for) {
+    return -1;
+  }
+  sim_bus(card, 1);
+  if (!complete) {
+    card->out_pos++;
+  }
+  return 1;
+}
+
+static uint32_t sim_transceive(struct EseInterface *ese,
+                               const struct EseSgBuffer *tx_buf,
+                               uint32_t tx_len, struct EseSgBuffer *rx_buf,
+                               uint32_t rx_len) {
+  return teq1_transceive(ese, &SIM_CARD(ese)->opts, tx_buf, tx_len, rx_buf,
+                         rx_len);
+}
+
+const struct EseSimStats *ese_sim_stats(const struct EseInterface *ese) {
+  return &SIM_CARD(ese)->stats;
+}
+
+static const char *kErrorMessages[] = {
+    TEQ1_ERROR_MESSAGES,
+};
+
+static const struct EseOperations ops = {
+    .name = "eSE Simulated T=1 Card",
+    .open = &sim_open,
+    .hw_receive = &sim_receive,
+    .hw_transmit = &sim_transmit,
+    .hw_reset = NULL,
+    .poll = &sim_poll,
+    .transceive = &sim_transceive,
+    .close = &sim_close,
+    .opts = &kTeq1Options,
+    .errors = kErrorMessages,
+    .errors_count = kTeq1ErrorMax,
+    .hw_transmit_sg = &sim_transmit_sg,
+};
+ESE_DEFINE_HW_OPS(ESE_HW_SIM, ops);
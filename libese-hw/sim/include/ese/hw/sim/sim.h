@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * An in-process T=1 card for benchmarking and testing the host stack
+ * without hardware.  The card side of the protocol runs synchronously
+ * inside hw_transmit(): every complete frame from the host is answered
+ * before the call returns.  Bus and card timing, when configured, are paid
+ * for in real time by the host's calls into the backend, so the host engine
+ * sees the same waits it would on a real part.
+ *
+ * By default the card echoes each command APDU back followed by 90 00; an
+ * EseSimApduHandler can answer them instead.
+ */
+
+#ifndef ESE_HW_SIM_H_
+#define ESE_HW_SIM_H_ 1
+
+#include <ese/ese.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The largest command or response APDU the card will hold. */
+#define ESE_SIM_APDU_MAX (65536 + 16)
+
+/*
+ * Answers the command APDU |cmd| by writing the response, status word
+ * included, to |rsp|, which has room for |rsp_max| bytes.  Returns the
+ * response length.  A length of 0, or one over |rsp_max|, is answered with
+ * 6F 00.
+ */
+typedef uint32_t (*EseSimApduHandler)(void *ctx, const uint8_t *cmd,
+                                      uint32_t cmd_len, uint8_t *rsp,
+                                      uint32_t rsp_max);
+
+/* Passed as the hw_opts to ese_open(). NULL selects the defaults (all 0). */
+struct EseSimConfig {
+  /* S(WTX) requests the card sends before each response. */
+  uint32_t wtx_count;
+  /* BWT multiplier carried by each S(WTX) request. 0 is treated as 1. */
+  uint32_t wtx_multiplier;
+  /*
+   * If set, the card asks for this IFSC (1-254) with an S(IFS) request
+   * before its first reply, and again after each RESYNC.  Once agreed, an
+   * I-block over the limit is refused with R(N(R), other error).
+   */
+  uint32_t ifsc;
+  /* Block waiting time used by the host. 0 keeps the default of 1.624 s. */
+  uint32_t bwt_us;
+  /* Time on the bus for each byte, in either direction. */
+  uint32_t byte_time_ns;
+  /* Time the card takes to process each command APDU. */
+  uint32_t think_time_us;
+  /* Frames from the card sent with a corrupted LRC, per million. */
+  uint32_t lrc_error_ppm;
+  /*
+   * Frames from the host the card receives with a parity error, per
+   * million.  The card asks for them again with R(N(R), parity error).
+   */
+  uint32_t parity_error_ppm;
+  /*
+   * Frames lost on the bus in either direction, per million.  The host
+   * only finds out once its BWT expires, so keep bwt_us short with these.
+   */
+  uint32_t drop_ppm;
+  /* Seeds the error injection so that runs are repeatable. */
+  uint32_t seed;
+  /* Answers command APDUs in place of the echo, with |handler_ctx|. */
+  EseSimApduHandler handler;
+  void *handler_ctx;
+};
+
+struct EseSimStats {
+  uint32_t frames_received;
+  uint32_t frames_sent;
+  uint32_t apdus;
+  uint32_t retransmits;
+  uint32_t wtx_sent;
+  uint32_t lrc_errors_injected;
+  uint32_t lrc_errors_seen;
+  uint32_t parity_errors_injected;
+  uint32_t oversized_blocks;
+  uint32_t frames_dropped;
+  uint32_t ifs_requests;
+  uint32_t resyncs;
+};
+
+/* Counters since the interface was opened. */
+ESE_API const struct EseSimStats *ese_sim_stats(const struct EseInterface *ese);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif  /* ESE_HW_SIM_H_ */
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Runs the T=1 host engine against the simulated card.
+ */
+
+#include <chrono>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <ese/ese.h>
+#include <ese/hw/sim/sim.h>
+
+ESE_INCLUDE_HW(ESE_HW_SIM);
+
+using ::testing::Test;
+
+class EseSimTest : public virtual Test {
+ public:
+  EseSimTest() : ese_(ESE_INITIALIZER(ESE_HW_SIM)), config_() {
+  }
+  virtual ~EseSimTest() { }
+  virtual void TearDown() {
+    ese_close(&ese_);
+  }
+
+  void Open() {
+    ASSERT_EQ(0, ese_open(&ese_, &config_));
+  }
+
+  // Sends a |len| byte APDU and checks that it comes back with 90 00.
+  void Echo(size_t len) {
+    std::vector<uint8_t> apdu(len);
+    for (size_t i = 0; i < len; ++i) {
+      apdu[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+    std::vector<uint8_t> reply(len + 2);
+    ASSERT_EQ(static_cast<int>(reply.size()),
+              ese_transceive(&ese_, apdu.data(), apdu.size(), reply.data(),
+                             reply.size()));
+    EXPECT_FALSE(ese_error(&ese_));
+    EXPECT_EQ(0x90, reply[len]);
+    EXPECT_EQ(0x00, reply[len + 1]);
+    reply.resize(len);
+    EXPECT_EQ(apdu, reply);
+  }
+
+  const struct EseSimStats &Stats() { return *ese_sim_stats(&ese_); }
+
+  struct EseInterface ese_;
+  struct EseSimConfig config_;
+};
+
+TEST_F(EseSimTest, EchoesOneBlock) {
+  Open();
+  Echo(64);
+  EXPECT_EQ(1u, Stats().apdus);
+  EXPECT_EQ(1u, Stats().frames_received);
+  EXPECT_EQ(1u, Stats().frames_sent);
+}
+
+TEST_F(EseSimTest, ChainsBothWays) {
+  Open();
+  Echo(1000);
+  Echo(4096);
+  EXPECT_EQ(2u, Stats().apdus);
+  EXPECT_EQ(0u, Stats().retransmits);
+}
+
+TEST_F(EseSimTest, RefusesAnOversizedOpen) {
+  config_.ifsc = 255;
+  EXPECT_EQ(-1, ese_open(&ese_, &config_));
+}
+
+TEST_F(EseSimTest, WaitingTimeExtensions) {
+  config_.wtx_count = 3;
+  config_.wtx_multiplier = 4;
+  Open();
+  Echo(32);
+  EXPECT_EQ(3u, Stats().wtx_sent);
+  EXPECT_EQ(3u, ese_.stats.wtx_requests);
+}
+
+TEST_F(EseSimTest, CardRequestsSmallerBlocks) {
+  config_.ifsc = 32;
+  Open();
+  Echo(600);
+  // The host kept to the card's IFSC for the rest of the chain.
+  EXPECT_EQ(1u, Stats().ifs_requests);
+  EXPECT_EQ(0u, Stats().oversized_blocks);
+  // And remembers it for later exchanges.
+  const uint32_t frames = Stats().frames_received;
+  Echo(600);
+  EXPECT_EQ(1u, Stats().ifs_requests);
+  EXPECT_EQ(0u, Stats().oversized_blocks);
+  EXPECT_LE(frames + 600u / 32u, Stats().frames_received);
+}
+
+TEST_F(EseSimTest, RecoversFromParityErrors) {
+  config_.parity_error_ppm = 50000;
+  config_.seed = 3;
+  Open();
+  for (int i = 0; i < 50; ++i) {
+    Echo(300);
+  }
+  EXPECT_LT(0u, Stats().parity_errors_injected);
+}
+
+TEST_F(EseSimTest, RecoversFromLrcErrors) {
+  config_.lrc_error_ppm = 50000;
+  config_.seed = 5;
+  Open();
+  for (int i = 0; i < 50; ++i) {
+    Echo(300);
+  }
+  EXPECT_LT(0u, Stats().lrc_errors_injected);
+  EXPECT_LT(0u, ese_.stats.frame_errors);
+}
+
+TEST_F(EseSimTest, RecoversFromDroppedFrames) {
+  config_.drop_ppm = 50000;
+  config_.bwt_us = 1000;
+  config_.seed = 7;
+  Open();
+  for (int i = 0; i < 50; ++i) {
+    Echo(300);
+  }
+  EXPECT_LT(0u, Stats().frames_dropped);
+}
+
+TEST_F(EseSimTest, PaysBusAndThinkTime) {
+  // 250 bytes out and back at 10 us a byte, plus 5 ms in the card.
+  config_.byte_time_ns = 10000;
+  config_.think_time_us = 5000;
+  Open();
+  const auto start = std::chrono::steady_clock::now();
+  Echo(250);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_LE(std::chrono::microseconds(5000 + 2 * 250 * 10), elapsed);
+}
+
+TEST_F(EseSimTest, ThinkTimeCoveredByWaitingTimeExtension) {
+  // The card needs three BWTs and asks for them.
+  config_.bwt_us = 2000;
+  config_.think_time_us = 5000;
+  config_.wtx_count = 1;
+  config_.wtx_multiplier = 3;
+  Open();
+  Echo(16);
+  EXPECT_EQ(0u, Stats().retransmits);
+  EXPECT_EQ(0u, ese_.stats.frame_errors);
+}
+
+static uint32_t NotFound(void *ctx, const uint8_t *cmd, uint32_t cmd_len,
+                         uint8_t *rsp, uint32_t rsp_max) {
+  std::vector<uint8_t> *seen = static_cast<std::vector<uint8_t> *>(ctx);
+  seen->assign(cmd, cmd + cmd_len);
+  EXPECT_LE(2u, rsp_max);
+  rsp[0] = 0x6A;
+  rsp[1] = 0x82;
+  return 2;
+}
+
+TEST_F(EseSimTest, HandlerAnswersCommands) {
+  std::vector<uint8_t> seen;
+  config_.handler = &NotFound;
+  config_.handler_ctx = &seen;
+  Open();
+  const std::vector<uint8_t> select = {0x00, 0xA4, 0x04, 0x00, 0x02,
+                                       0xAB, 0xCD, 0x00};
+  uint8_t reply[258];
+  ASSERT_EQ(2, ese_transceive(&ese_, select.data(), select.size(), reply,
+                              sizeof(reply)));
+  EXPECT_EQ(0x6A, reply[0]);
+  EXPECT_EQ(0x82, reply[1]);
+  EXPECT_EQ(select, seen);
+}
+
+static uint32_t Mute(void *, const uint8_t *, uint32_t, uint8_t *, uint32_t) {
+  return 0;
+}
+
+TEST_F(EseSimTest, MuteHandlerAnswers6F00) {
+  config_.handler = &Mute;
+  Open();
+  const uint8_t cmd[] = {0x80, 0xCA, 0x00, 0xFE, 0x00};
+  uint8_t reply[258];
+  ASSERT_EQ(2, ese_transceive(&ese_, cmd, sizeof(cmd), reply, sizeof(reply)));
+  EXPECT_EQ(0x6F, reply[0]);
+  EXPECT_EQ(0x00, reply[1]);
+}
@@ -17,6 +17,7 @@
 #include <endian.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 
 void *ese_memcpy(void *__dest, const void *__src, uint64_t __n) {
   return memcpy(__dest, __src, __n);
@@ -37,3 +38,9 @@ uint32_t ese_le32toh(uint32_t little_endian_32bits) {
 }
 
 uint32_t ese_htole32(uint32_t host_32bits) { return htole32(host_32bits); }
+
+uint64_t ese_monotonic_usec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
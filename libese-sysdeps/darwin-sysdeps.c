@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 
 #include <libkern/OSByteOrder.h>
 
@@ -42,3 +43,9 @@ uint32_t ese_le32toh(uint32_t little_endian_32bits) {
 uint32_t ese_htole32(uint32_t host_32bits) {
   return OSSwapHostToLittleInt32(host_32bits);
 }
+
+uint64_t ese_monotonic_usec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
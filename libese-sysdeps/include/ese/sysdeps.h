@@ -35,6 +35,10 @@
 #define _static_assert(what, why) { while (!(1 / (!!(what)))); }
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 extern void *ese_memcpy(void *__dest, const void *__src, uint64_t __n);
 extern void *ese_memset(void *__s, int __c, uint64_t __n);
 
@@ -43,4 +47,11 @@ extern uint32_t ese_htobe32(uint32_t host_32bits);
 extern uint32_t ese_le32toh(uint32_t little_endian_32bits);
 extern uint32_t ese_htole32(uint32_t host_32bits);
 
+/* Monotonic clock in microseconds with an arbitrary epoch. */
+extern uint64_t ese_monotonic_usec(void);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
 #endif  /* ESE_SYSDEPS_H__ */
@@ -101,6 +101,8 @@ struct Teq1Header {
 
 #define INF_LEN 254
 #define IFSC 254
+/* Most caller segments a single I-block will be sent from without copying. */
+#define TEQ1_TX_SG_MAX 8
 struct Teq1Frame {
   union {
     uint8_t val[sizeof(struct Teq1Header) + INF_LEN + 1];
@@ -127,12 +129,21 @@ struct Teq1CardState {
     };
     uint8_t seq_bits;
   } seq;
+  /* Largest INF the card accepts. 0 means the IFSC default. */
+  uint8_t ifsc;
+  /* Largest INF the card agreed to send. 0 until advertised. */
+  uint8_t ifsd;
+  /* IFSD last advertised, whatever the card answered. 0 until advertised. */
+  uint8_t ifsd_sent;
 };
 
-/* Set "last sent" to 1 so we start at 0. */
+/* Set "last sent" to 1 so we start at 0. Any negotiated sizes are dropped. */
 #define TEQ1_INIT_CARD_STATE(CARD) \
   (CARD)->seq.card = 1; \
-  (CARD)->seq.interface = 1;
+  (CARD)->seq.interface = 1; \
+  (CARD)->ifsc = 0; \
+  (CARD)->ifsd = 0; \
+  (CARD)->ifsd_sent = 0;
 
 /*
  * Used by devices implementing T=1 to set specific options
@@ -151,6 +162,18 @@ struct Teq1ProtocolOptions {
    * and immediately after receive.
    */
   teq1_protocol_preprocess_op_t *preprocess;
+  /*
+   * If true, the LRC in both directions is computed as if the header NAD were
+   * |lrc_nad| rather than the address on the wire.  Received frames have their
+   * NAD replaced with |lrc_nad|.
+   */
+  bool lrc_nad_override;
+  uint8_t lrc_nad;
+  /*
+   * If non-zero, advertised to the card with an S(IFS REQUEST) ahead of the
+   * first I-block after the card state is initialized.
+   */
+  uint8_t ifsd;
 };
 
 /* PCB bits */
@@ -187,16 +210,158 @@ struct Teq1ProtocolOptions {
 #define TEQ1_S_ABORT(R) (kTeq1SuperType | ((R) << 5) | kTeq1SuperAbortBit)
 #define TEQ1_S_IFS(R) (kTeq1SuperType | ((R) << 5) | kTeq1SuperIfsBit)
 
+/*
+ * Engine state for a single exchange. It is internal to the T=1
+ * implementation and only exposed so that a struct Teq1Transceive
+ * may live on the caller's stack.
+ */
+struct Teq1State {
+  uint8_t wait_mult;
+  uint8_t ifs;
+  uint8_t errors;
+  int retransmits;
+  /* If true, I-block data is sent straight from app_data.tx_block. */
+  bool zero_copy;
+  const char *last_error_message;
+  struct Teq1CardState *card_state;
+  struct {
+    const struct EseSgBuffer *tx;
+    struct EseSgBuffer *rx;
+    /* Next byte to place in an I-block. */
+    struct EseSgCursor tx_cursor;
+    /* Start of the data in the most recently filled I-block. */
+    struct EseSgCursor tx_block;
+    uint32_t tx_total;
+    struct EseSgCursor rx_cursor;
+    uint32_t rx_total;
+  } app_data;
+};
+
+/*
+ * Resumable transceive.
+ *
+ * teq1_transceive() blocks until the exchange completes. Callers which
+ * want to interleave the exchange with other work (e.g., other
+ * interfaces) may instead drive it one frame at a time:
+ *
+ *   struct Teq1Transceive xfer;
+ *   teq1_transceive_init(&xfer, ese, opts, tx, tx_segs, rx, rx_segs);
+ *   while (teq1_transceive_process_one(&xfer) != kTeq1StepDone) {
+ *     ... other work, finished well before |xfer.deadline_usec| ...
+ *   }
+ *   recvd = teq1_transceive_result(&xfer);
+ *
+ * Each call performs at most one transmission or one reception. The
+ * returned step describes what the next call will do:
+ * - kTeq1StepTransmit: a frame is prepared and will be sent.
+ * - kTeq1StepReceive: a frame was sent and the card must begin its reply
+ *   by |deadline_usec| (ese_monotonic_usec()), |timeout| seconds after
+ *   the transmission. The receiving call blocks in the hardware's poll
+ *   operation until the reply begins or the deadline passes; time spent
+ *   between calls comes out of that wait, and a call made after the
+ *   deadline counts as a timeout.
+ * - kTeq1StepDone: the exchange is over. On failure, ese_error() is set.
+ *
+ * The receiving call waits in the hardware backend, which may use a
+ * readiness hook of its own (e.g., the PN80T platform's wait_for_data(),
+ * a poll(2) on the device). EseOperations does not pass that readiness
+ * up to the caller, so this engine lets the caller decide where it gives
+ * up the thread between frames. It is not an API for an epoll-style loop.
+ */
+enum Teq1TransceiveStep {
+  kTeq1StepTransmit,
+  kTeq1StepReceive,
+  kTeq1StepDone,
+};
+
+struct Teq1Transceive {
+  enum Teq1TransceiveStep step;
+  float timeout;  /* Seconds the card had to reply in kTeq1StepReceive. */
+  uint64_t deadline_usec;  /* When the reply must have begun by. */
+  /* The remainder is private to the engine. */
+  struct EseInterface *ese;
+  const struct Teq1ProtocolOptions *opts;
+  struct Teq1Frame tx_frame[2];
+  struct Teq1Frame rx_frame;
+  struct Teq1Frame *tx;
+  int active;
+  bool was_reset;
+  int session_resets;
+  uint32_t rx_total;
+  uint32_t recvd;
+  struct Teq1State init_state;
+  struct Teq1State state;
+};
+
+void teq1_transceive_init(struct Teq1Transceive *xfer,
+                          struct EseInterface *ese,
+                          const struct Teq1ProtocolOptions *opts,
+                          const struct EseSgBuffer *tx_bufs, uint8_t tx_segs,
+                          struct EseSgBuffer *rx_bufs, uint8_t rx_segs);
+enum Teq1TransceiveStep teq1_transceive_process_one(struct Teq1Transceive *xfer);
+/* Returns the bytes received once kTeq1StepDone is reached. */
+uint32_t teq1_transceive_result(const struct Teq1Transceive *xfer);
+
 uint32_t teq1_transceive(struct EseInterface *ese,
                          const struct Teq1ProtocolOptions *opts,
                          const struct EseSgBuffer *tx_bufs, uint8_t tx_segs,
                          struct EseSgBuffer *rx_bufs, uint8_t rx_segs);
 
+/*
+ * Sends S(RESYNC, REQUEST) outside of an exchange and waits up to |timeout|
+ * seconds for the response, e.g. to check a card left powered is awake.
+ * Returns 0, with the card state reset, if the card answered and -1 if not.
+ */
+int teq1_resync(struct EseInterface *ese,
+                const struct Teq1ProtocolOptions *opts, float timeout);
+
 uint8_t teq1_compute_LRC(const struct Teq1Frame *frame);
+/* XORs |len| bytes from |buf| into |lrc|. */
+uint8_t teq1_update_LRC(uint8_t lrc, const uint8_t *buf, uint32_t len);
+
+/*
+ * Every frame sent or received is recorded in a process-wide, lock-free ring
+ * of the last TEQ1_TRACE_RECORDS frames.  It is cheap enough to leave on and
+ * may be copied out after a failure with teq1_trace_snapshot() or
+ * teq1_trace_export().
+ */
+#define TEQ1_TRACE_RECORDS 256
+#define TEQ1_TRACE_INF_MAX 8
+#define TEQ1_TRACE_RULE_NONE 0xff
+
+enum Teq1TraceDirection {
+  kTeq1TraceTransmit = 0,
+  kTeq1TraceReceive = 1,
+};
+
+struct Teq1TraceRecord {
+  uint64_t usec;  /* ese_monotonic_usec() when recorded. */
+  uint32_t seq;   /* 1 + the frame's position in the trace; 0 while written. */
+  uint8_t direction;
+  uint8_t pcb;
+  uint8_t len;
+  uint8_t rule;  /* Rule result for received frames or TEQ1_TRACE_RULE_NONE. */
+  uint8_t inf[TEQ1_TRACE_INF_MAX];  /* The first bytes of the INF. */
+};
+
+/* Copies up to |max| of the latest records, oldest first. Returns the count. */
+uint32_t teq1_trace_snapshot(struct Teq1TraceRecord *records, uint32_t max);
+
+/*
+ * Exports a snapshot as:
+ *   "T1TR" | version (1) | record size (1) | record count (LE16)
+ * followed by each record with multi-byte fields in little endian:
+ *   usec (8) | seq (4) | direction | pcb | len | rule | inf (8)
+ * Returns the bytes written, or the bytes needed if |buf| is too small.
+ */
+#define TEQ1_TRACE_EXPORT_VERSION 1
+#define TEQ1_TRACE_EXPORT_HEADER_SIZE 8
+#define TEQ1_TRACE_EXPORT_RECORD_SIZE 24
+uint32_t teq1_trace_export(uint8_t *buf, uint32_t len);
 
-#define teq1_trace_header() ALOGI("%-20s --- %20s", "Interface", "Card")
-#define teq1_trace_transmit(PCB, LEN) ALOGI("%-20s --> %20s [%3hhu]", teq1_pcb_to_name(PCB), "", LEN)
-#define teq1_trace_receive(PCB, LEN) ALOGI("%-20s <-- %20s [%3hhu]", "", teq1_pcb_to_name(PCB), LEN)
+#define teq1_trace_header() ALOGV("%-20s --- %20s", "Interface", "Card")
+#define teq1_trace_transmit(PCB, LEN) ALOGV("%-20s --> %20s [%3hhu]", teq1_pcb_to_name(PCB), "", LEN)
+#define teq1_trace_receive(PCB, LEN) ALOGV("%-20s <-- %20s [%3hhu]", "", teq1_pcb_to_name(PCB), LEN)
 
 #ifdef __cplusplus
 }  /* extern "C" */
@@ -96,14 +96,220 @@ void teq1_dump_buf(const char *prefix, const uint8_t *buf, uint32_t len) {
     ALOGV("%s[%u]: %.2X", prefix, recvd, buf[recvd]);
 }
 
+/*
+ * Frame trace ring.  Writers claim a slot with an atomic increment of the
+ * head and publish it by storing its sequence number last.  Readers copy a
+ * slot and keep it only if that sequence number was stable across the copy.
+ */
+static struct Teq1TraceRecord teq1_trace_ring[TEQ1_TRACE_RECORDS];
+static uint32_t teq1_trace_head;
+
+static void teq1_trace_record(uint8_t direction, uint8_t pcb, uint8_t len,
+                              uint8_t rule, const uint8_t *inf,
+                              uint32_t inf_len) {
+  const uint32_t seq = __atomic_fetch_add(&teq1_trace_head, 1, __ATOMIC_RELAXED);
+  struct Teq1TraceRecord *rec = &teq1_trace_ring[seq % TEQ1_TRACE_RECORDS];
+  __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  rec->usec = ese_monotonic_usec();
+  rec->direction = direction;
+  rec->pcb = pcb;
+  rec->len = len;
+  rec->rule = rule;
+  if (inf_len > TEQ1_TRACE_INF_MAX) {
+    inf_len = TEQ1_TRACE_INF_MAX;
+  }
+  ese_memcpy(rec->inf, inf, inf_len);
+  ese_memset(rec->inf + inf_len, 0, TEQ1_TRACE_INF_MAX - inf_len);
+  __atomic_store_n(&rec->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Copies the record at |seq| if it is still intact. */
+static bool teq1_trace_copy(uint32_t seq, struct Teq1TraceRecord *out) {
+  const struct Teq1TraceRecord *rec = &teq1_trace_ring[seq % TEQ1_TRACE_RECORDS];
+  const uint32_t published = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+  if (published != seq + 1) {
+    /* Being written or already recycled. */
+    return false;
+  }
+  ese_memcpy(out, rec, sizeof(*out));
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&rec->seq, __ATOMIC_RELAXED) != published) {
+    return false;
+  }
+  out->seq = published;
+  return true;
+}
+
+/* Returns the first sequence number worth reading for up to |max| records. */
+static uint32_t teq1_trace_first(uint32_t head, uint32_t max) {
+  uint32_t count = head < TEQ1_TRACE_RECORDS ? head : TEQ1_TRACE_RECORDS;
+  if (count > max) {
+    count = max;
+  }
+  return head - count;
+}
+
+ESE_API uint32_t teq1_trace_snapshot(struct Teq1TraceRecord *records,
+                                     uint32_t max) {
+  const uint32_t head = __atomic_load_n(&teq1_trace_head, __ATOMIC_ACQUIRE);
+  uint32_t copied = 0;
+  uint32_t seq;
+  for (seq = teq1_trace_first(head, max); seq != head; ++seq) {
+    if (teq1_trace_copy(seq, &records[copied])) {
+      copied++;
+    }
+  }
+  return copied;
+}
+
+static uint8_t *teq1_trace_put32(uint8_t *out, uint32_t val) {
+  val = ese_htole32(val);
+  ese_memcpy(out, &val, sizeof(val));
+  return out + sizeof(val);
+}
+
+ESE_API uint32_t teq1_trace_export(uint8_t *buf, uint32_t len) {
+  const uint32_t head = __atomic_load_n(&teq1_trace_head, __ATOMIC_ACQUIRE);
+  const uint32_t first = teq1_trace_first(head, TEQ1_TRACE_RECORDS);
+  const uint32_t needed = TEQ1_TRACE_EXPORT_HEADER_SIZE +
+                          (head - first) * TEQ1_TRACE_EXPORT_RECORD_SIZE;
+  struct Teq1TraceRecord rec;
+  uint8_t *out = buf + TEQ1_TRACE_EXPORT_HEADER_SIZE;
+  uint32_t count = 0;
+  uint32_t seq;
+  if (len < needed) {
+    return needed;
+  }
+  for (seq = first; seq != head; ++seq) {
+    if (!teq1_trace_copy(seq, &rec)) {
+      continue;
+    }
+    out = teq1_trace_put32(out, (uint32_t)rec.usec);
+    out = teq1_trace_put32(out, (uint32_t)(rec.usec >> 32));
+    out = teq1_trace_put32(out, rec.seq);
+    *out++ = rec.direction;
+    *out++ = rec.pcb;
+    *out++ = rec.len;
+    *out++ = rec.rule;
+    ese_memcpy(out, rec.inf, TEQ1_TRACE_INF_MAX);
+    out += TEQ1_TRACE_INF_MAX;
+    count++;
+  }
+  buf[0] = 'T';
+  buf[1] = '1';
+  buf[2] = 'T';
+  buf[3] = 'R';
+  buf[4] = TEQ1_TRACE_EXPORT_VERSION;
+  buf[5] = TEQ1_TRACE_EXPORT_RECORD_SIZE;
+  buf[6] = count & 0xff;
+  buf[7] = (count >> 8) & 0xff;
+  return (uint32_t)(out - buf);
+}
+
+/* Accounts for one frame, of |len| bytes on the wire, moved in |usec|. */
+static void teq1_stats_frame(struct EseInterface *ese, bool sent, uint32_t len,
+                             uint64_t usec) {
+  if (sent) {
+    ese->stats.frames_sent++;
+    ese->stats.bytes_sent += len;
+  } else {
+    ese->stats.frames_received++;
+    ese->stats.bytes_received += len;
+  }
+  ese_stats_record(&ese->stats.bus_latency, usec);
+}
+
+/*
+ * Sends an I-block straight from the caller's buffers.  The INF payload is
+ * the |frame->header.LEN| bytes at |app_data.tx_block|, which
+ * teq1_fill_info_block() has already accounted for.
+ *
+ * Returns 0 on success and -1 if the payload spans too many segments, in which
+ * case the caller must fall back to a contiguous frame.
+ */
+static int teq1_transmit_sg(struct EseInterface *ese,
+                            const struct Teq1ProtocolOptions *opts,
+                            const struct Teq1State *state,
+                            struct Teq1Frame *frame) {
+  struct EseSgBuffer sg[TEQ1_TX_SG_MAX + 2];
+  struct EseSgCursor cursor = state->app_data.tx_block;
+  const struct EseSgBuffer *buf;
+  uint32_t remaining = frame->header.LEN;
+  uint32_t segs = 1;
+  uint64_t start;
+  uint8_t lrc;
+
+  sg[0].c_base = frame->val;
+  sg[0].len = sizeof(frame->header);
+  while (remaining && segs <= TEQ1_TX_SG_MAX &&
+         ese_sg_cursor_next(&cursor, remaining, &sg[segs])) {
+    remaining -= sg[segs].len;
+    segs++;
+  }
+  if (remaining) {
+    return -1;
+  }
+  /* The header is the only part of the frame in |frame->val|. */
+  lrc = teq1_update_LRC(0, frame->val, sizeof(frame->header));
+  for (buf = &sg[1]; buf < &sg[segs]; ++buf) {
+    lrc = teq1_update_LRC(lrc, buf->c_base, buf->len);
+  }
+  /* The LRC is staged in the frame so a retransmit can reuse it. */
+  frame->INF[0] = lrc;
+  frame->header.NAD = opts->node_address;
+  sg[segs].c_base = &frame->INF[0];
+  sg[segs].len = 1;
+  segs++;
+
+  teq1_trace_transmit(frame->header.PCB, frame->header.LEN);
+  {
+    uint8_t inf[TEQ1_TRACE_INF_MAX];
+    struct EseSgCursor head = state->app_data.tx_block;
+    const uint32_t inf_len = ese_sg_cursor_to_buf(
+        &head, frame->header.LEN < sizeof(inf) ? frame->header.LEN : sizeof(inf),
+        inf);
+    teq1_trace_record(kTeq1TraceTransmit, frame->header.PCB, frame->header.LEN,
+                      TEQ1_TRACE_RULE_NONE, inf, inf_len);
+  }
+  teq1_dump_transmit(frame->val, sizeof(frame->header));
+  start = ese_monotonic_usec();
+  ese->ops->hw_transmit_sg(ese, sg, segs, 1);
+  teq1_stats_frame(ese, true, sizeof(frame->header) + frame->header.LEN + 1,
+                   ese_monotonic_usec() - start);
+  return 0;
+}
+
 int teq1_transmit(struct EseInterface *ese,
                   const struct Teq1ProtocolOptions *opts,
+                  const struct Teq1State *state,
                   struct Teq1Frame *frame) {
-  /* Set correct node address. */
-  frame->header.NAD = opts->node_address;
+  uint64_t start;
+  /* The LRC is computed over the override NAD, if any. */
+  frame->header.NAD =
+      opts->lrc_nad_override ? opts->lrc_nad : opts->node_address;
 
-  /* Compute the LRC */
+  if (state->zero_copy && frame->header.LEN) {
+    switch (bs_get(PCB.type, frame->header.PCB)) {
+    case kPcbTypeInfo0:
+    case kPcbTypeInfo1:
+      if (teq1_transmit_sg(ese, opts, state, frame) == 0) {
+        return 0;
+      }
+      /* Too fragmented to send in one go; copy it in like before. */
+      {
+        struct EseSgCursor cursor = state->app_data.tx_block;
+        ese_sg_cursor_to_buf(&cursor, frame->header.LEN, frame->INF);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  /* Compute the LRC and set the correct node address. */
   frame->INF[frame->header.LEN] = teq1_compute_LRC(frame);
+  frame->header.NAD = opts->node_address;
 
   /*
    * If the card does something weird, like expect an CRC/LRC based on a
@@ -118,9 +324,17 @@ int teq1_transmit(struct EseInterface *ese,
    * Failed transmissions will result eventually in a resync then reset.
    */
   teq1_trace_transmit(frame->header.PCB, frame->header.LEN);
+  teq1_trace_record(kTeq1TraceTransmit, frame->header.PCB, frame->header.LEN,
+                    TEQ1_TRACE_RULE_NONE, frame->INF, frame->header.LEN);
   teq1_dump_transmit(frame->val, sizeof(frame->header) + frame->header.LEN + 1);
+  if (frame->header.PCB == S(RESYNC, REQUEST)) {
+    ese->stats.resyncs++;
+  }
+  start = ese_monotonic_usec();
   ese->ops->hw_transmit(ese, frame->val,
                         sizeof(frame->header) + frame->header.LEN + 1, 1);
+  teq1_stats_frame(ese, true, sizeof(frame->header) + frame->header.LEN + 1,
+                   ese_monotonic_usec() - start);
   /*
    * Even though in practice any WTX BWT extension starts when the above
    * transmit ends, it is easier to implement it in the polling timeout of
@@ -134,12 +348,16 @@ int teq1_receive(struct EseInterface *ese,
                  struct Teq1Frame *frame) {
   /* Poll the bus until we see the start of frame indicator, the interface NAD.
    */
+  const uint64_t start = ese_monotonic_usec();
   int bytes_consumed = ese->ops->poll(ese, opts->host_address, timeout, 0);
+  uint64_t ready;
   if (bytes_consumed < 0 || bytes_consumed > 1) {
     /* Timed out or comm error. */
     ALOGV("%s: comm error: %d", __func__, bytes_consumed);
     return -1;
   }
+  ready = ese_monotonic_usec();
+  ese_stats_record(&ese->stats.card_latency, ready - start);
   /* We polled for the NAD above -- if it was consumed, set it here. */
   if (bytes_consumed) {
     frame->header.NAD = opts->host_address;
@@ -163,6 +381,12 @@ int teq1_receive(struct EseInterface *ese,
                        frame->header.LEN + 1, 1);
   teq1_dump_receive((uint8_t *)(&(frame->INF[0])), frame->header.LEN + 1);
   teq1_trace_receive(frame->header.PCB, frame->header.LEN);
+  teq1_stats_frame(ese, false, sizeof(frame->header) + frame->header.LEN + 1,
+                   ese_monotonic_usec() - ready);
+
+  if (opts->lrc_nad_override) {
+    frame->header.NAD = opts->lrc_nad;
+  }
 
   /*
    * If the card does something weird, like expect an CRC/LRC based on a
@@ -190,8 +414,14 @@ uint8_t teq1_fill_info_block(struct Teq1State *state, struct Teq1Frame *frame) {
     if (len > inf_len) {
       len = inf_len;
     }
-    copied = ese_sg_to_buf(state->app_data.tx, state->app_data.tx_count,
-                           state->app_data.tx_offset, len, frame->INF);
+    state->app_data.tx_block = state->app_data.tx_cursor;
+    /* With zero copy, teq1_transmit() reads the data from the caller. */
+    if (state->zero_copy) {
+      copied = ese_sg_cursor_advance(&state->app_data.tx_cursor, len);
+    } else {
+      copied = ese_sg_cursor_to_buf(&state->app_data.tx_cursor, len,
+                                    frame->INF);
+    }
     if (copied != len) {
       ALOGE("Failed to copy %x bytes of app data for transmission",
             frame->header.LEN);
@@ -200,10 +430,9 @@ uint8_t teq1_fill_info_block(struct Teq1State *state, struct Teq1Frame *frame) {
       return 255;
     }
     frame->header.LEN = (len & 0xff);
-    ALOGV("Copying %x bytes of app data for transmission", frame->header.LEN);
+    ALOGV("Queueing %x bytes of app data for transmission", frame->header.LEN);
     /* Incrementing here means the caller MUST handle retransmit with prepared
      * data. */
-    state->app_data.tx_offset += copied;
     state->app_data.tx_total -= copied;
     /* Perform chained transmission if needed. */
     bs_assign(&frame->header.PCB, PCB.I.more_data, 0);
@@ -229,13 +458,11 @@ void teq1_get_app_data(struct Teq1State *state, const struct Teq1Frame *frame) {
     if (len > state->app_data.rx_total) {
       len = state->app_data.rx_total;
     }
-    ese_sg_from_buf(state->app_data.rx, state->app_data.rx_count,
-                    state->app_data.rx_offset, len, frame->INF);
+    ese_sg_cursor_from_buf(&state->app_data.rx_cursor, len, frame->INF);
     /* The original caller must retain the starting pointer to determine
      * actual available data.
      */
     state->app_data.rx_total -= len;
-    state->app_data.rx_offset += len;
     return;
   }
   case kPcbTypeReceiveReady:
@@ -356,6 +583,8 @@ enum RuleResult teq1_rules(struct Teq1State *state, struct Teq1Frame *tx_frame,
 
     /* Card begins chained response. */
     case TEQ1_RULE(I(0, 0), I(0, 1)):
+    case TEQ1_RULE(I(0, 0), I(1, 1)):
+    case TEQ1_RULE(I(1, 0), I(0, 1)):
     case TEQ1_RULE(I(1, 0), I(1, 1)):
       /* Prep R(N(S)) */
       teq1_get_app_data(state, rx_frame);
@@ -392,8 +621,18 @@ enum RuleResult teq1_rules(struct Teq1State *state, struct Teq1Frame *tx_frame,
 
     /*** Rule 4 ***/
     case TEQ1_RULE(S(IFS, REQUEST), S(IFS, RESPONSE)):
-      /* XXX: Check INFs match. */
-      return kRuleResultComplete; /* This is treated as an unique operation. */
+      if (rx_frame->INF[0] != tx_frame->INF[0]) {
+        ALOGW("Card answered IFSD %hhu with %hhu", tx_frame->INF[0],
+              rx_frame->INF[0]);
+      }
+      state->card_state->ifsd = rx_frame->INF[0];
+      state->card_state->ifsd_sent = tx_frame->INF[0];
+      /* The request is sent ahead of the first I-block. Send it now. */
+      next_tx->header.PCB = TEQ1_I(!state->card_state->seq.interface, 0);
+      teq1_fill_info_block(state, next_tx);
+      return kRuleResultContinue;
+    case TEQ1_RULE(S(IFS, REQUEST), 255):
+      return kRuleResultRetransmit;
     case TEQ1_RULE(I(0, 0), S(IFS, REQUEST)):
     case TEQ1_RULE(I(0, 1), S(IFS, REQUEST)):
     case TEQ1_RULE(I(1, 0), S(IFS, REQUEST)):
@@ -404,7 +643,12 @@ enum RuleResult teq1_rules(struct Teq1State *state, struct Teq1Frame *tx_frame,
       next_tx->header.PCB = S(IFS, RESPONSE);
       next_tx->header.LEN = 1;
       next_tx->INF[0] = rx_frame->INF[0];
-      state->ifs = rx_frame->INF[0];
+      /* 0 and 255 are reserved; keep the current size if we see them. */
+      if (rx_frame->INF[0] != 0 && rx_frame->INF[0] != 255) {
+        state->ifs = rx_frame->INF[0];
+        /* Remembered for later exchanges until the card state is reset. */
+        state->card_state->ifsc = rx_frame->INF[0];
+      }
       return kRuleResultSingleShot;
 
     /*** Rule 5  (see Rule 2.2 for the chained-tx side. ) ***/
@@ -552,150 +796,307 @@ enum RuleResult teq1_rules(struct Teq1State *state, struct Teq1Frame *tx_frame,
   }
 }
 
+static void teq1_transceive_fail(struct Teq1Transceive *xfer, int code) {
+  ese_set_error(xfer->ese, code);
+  xfer->recvd = 0;
+  xfer->step = kTeq1StepDone;
+}
+
 /*
- * TODO(wad): Consider splitting teq1_transcieve() into
- *   teq1_transcieve_init() and teq1_transceive_process_one()
- *   if testing becomes onerous given the loop below.
+ * Loads the block that opens an exchange: S(IFS, REQUEST) if the card has not
+ * yet been told our IFSD, otherwise the first I-block. The rules follow an
+ * S(IFS, RESPONSE) up with that I-block.
  */
-ESE_API uint32_t teq1_transceive(struct EseInterface *ese,
-                                 const struct Teq1ProtocolOptions *opts,
-                                 const struct EseSgBuffer *tx_bufs,
-                                 uint8_t tx_segs, struct EseSgBuffer *rx_bufs,
-                                 uint8_t rx_segs) {
-  struct Teq1Frame tx_frame[2];
-  struct Teq1Frame rx_frame;
-  struct Teq1Frame *tx = &tx_frame[0];
-  int active = 0;
-  bool was_reset = false;
-  bool needs_hw_reset = false;
-  int session_resets = 0;
-  bool done = false;
-  enum RuleResult result = kRuleResultComplete;
-  uint32_t rx_total = ese_sg_length(rx_bufs, rx_segs);
+static void teq1_load_first_block(struct Teq1Transceive *xfer) {
+  const struct Teq1CardState *card_state = xfer->state.card_state;
+  if (xfer->opts->ifsd && card_state->ifsd_sent != xfer->opts->ifsd) {
+    xfer->tx->header.PCB = S(IFS, REQUEST);
+    xfer->tx->header.LEN = 1;
+    xfer->tx->INF[0] = xfer->opts->ifsd;
+  } else {
+    /* First I-block is always I(0, M). After that, modulo 2. */
+    xfer->tx->header.PCB = TEQ1_I(!card_state->seq.interface, 0);
+    teq1_fill_info_block(&xfer->state, xfer->tx);
+  }
+}
+
+ESE_API void teq1_transceive_init(struct Teq1Transceive *xfer,
+                                  struct EseInterface *ese,
+                                  const struct Teq1ProtocolOptions *opts,
+                                  const struct EseSgBuffer *tx_bufs,
+                                  uint8_t tx_segs, struct EseSgBuffer *rx_bufs,
+                                  uint8_t rx_segs) {
   struct Teq1CardState *card_state = (struct Teq1CardState *)(&ese->pad[0]);
-  struct Teq1State init_state = TEQ1_INIT_STATE(
-      tx_bufs, tx_segs, ese_sg_length(tx_bufs, tx_segs), rx_bufs, rx_segs,
-      ese_sg_length(rx_bufs, rx_segs), card_state);
-  struct Teq1State state = TEQ1_INIT_STATE(
-      tx_bufs, tx_segs, ese_sg_length(tx_bufs, tx_segs), rx_bufs, rx_segs,
-      ese_sg_length(rx_bufs, rx_segs), card_state);
+  const uint32_t tx_total = ese_sg_length(tx_bufs, tx_segs);
 
   _static_assert(TEQ1HEADER_SIZE == sizeof(struct Teq1Header),
                  "Ensure compiler alignment/padding matches wire protocol.");
   _static_assert(TEQ1FRAME_SIZE == sizeof(struct Teq1Frame),
                  "Ensure compiler alignment/padding matches wire protocol.");
+  _static_assert(sizeof(struct Teq1CardState) <= ESE_INTERFACE_STATE_PAD / 2,
+                 "Card state must leave the back of pad[] for the hardware.");
 
-  /* First I-block is always I(0, M). After that, modulo 2. */
-  tx->header.PCB = TEQ1_I(!card_state->seq.interface, 0);
-  teq1_fill_info_block(&state, tx);
+  xfer->ese = ese;
+  xfer->opts = opts;
+  xfer->active = 0;
+  xfer->tx = &xfer->tx_frame[0];
+  xfer->was_reset = false;
+  xfer->session_resets = 0;
+  xfer->rx_total = ese_sg_length(rx_bufs, rx_segs);
+  xfer->recvd = 0;
+  xfer->timeout = 0.0f;
+  xfer->deadline_usec = 0;
+  xfer->init_state = (struct Teq1State)TEQ1_INIT_STATE(
+      tx_bufs, tx_segs, tx_total, rx_bufs, rx_segs, xfer->rx_total,
+      card_state);
+  /* Preprocessing may rewrite the INF, so it needs a contiguous frame. */
+  xfer->init_state.zero_copy = ese->ops->hw_transmit_sg && !opts->preprocess;
+  if (card_state->ifsc) {
+    xfer->init_state.ifs = card_state->ifsc;
+  }
+  xfer->state = xfer->init_state;
 
+  teq1_load_first_block(xfer);
+  xfer->step = kTeq1StepTransmit;
   teq1_trace_header();
-  while (!done) {
-    /* Populates the node address and LRC prior to attempting to transmit. */
-    teq1_transmit(ese, opts, tx);
+}
+
+ESE_API enum Teq1TransceiveStep
+teq1_transceive_process_one(struct Teq1Transceive *xfer) {
+  struct EseInterface *ese = xfer->ese;
+  struct Teq1State *state = &xfer->state;
+  struct Teq1Frame *next_tx;
+  bool needs_hw_reset = false;
+  enum RuleResult result;
+  struct Teq1Header rx_header;
+  uint8_t errors;
+  uint64_t now;
+  float remaining;
 
+  switch (xfer->step) {
+  case kTeq1StepTransmit:
+    /* Populates the node address and LRC prior to attempting to transmit. */
+    teq1_transmit(ese, xfer->opts, state, xfer->tx);
     /* If tx was pointed to the inactive frame for a single shot, restore it
      * now. */
-    tx = &tx_frame[active];
+    xfer->tx = &xfer->tx_frame[xfer->active];
+    xfer->timeout = xfer->opts->bwt * (float)state->wait_mult;
+    xfer->deadline_usec =
+        ese_monotonic_usec() + (uint64_t)(xfer->timeout * 1000000.0f);
+    /* Always reset |wait_mult| once we have calculated the timeout. */
+    state->wait_mult = 1;
+    xfer->step = kTeq1StepReceive;
+    return xfer->step;
+  case kTeq1StepReceive:
+    break;
+  case kTeq1StepDone:
+  default:
+    return kTeq1StepDone;
+  }
 
-    /* Clear the RX frame. */
-    ese_memset(&rx_frame, 0xff, sizeof(rx_frame));
+  /* Clear the RX header. teq1_receive() fills in exactly LEN + 1 INF bytes. */
+  ese_memset(&xfer->rx_frame.header, 0xff, sizeof(xfer->rx_frame.header));
 
-    /* -1 indicates a timeout or failure from hardware. */
-    if (teq1_receive(ese, opts, opts->bwt * (float)state.wait_mult, &rx_frame) <
-        0) {
-      /* TODO(wad): If the ese_error(ese) == 1, should this go ahead and fail?
-       */
-      /* Failures are considered invalid blocks in the rule engine below. */
-      rx_frame.header.PCB = 255;
-    }
-    /* Always reset |wait_mult| once we have calculated the timeout. */
-    state.wait_mult = 1;
+  /* Whatever the caller spent between steps comes out of the wait. */
+  now = ese_monotonic_usec();
+  remaining = now < xfer->deadline_usec
+                  ? (float)(xfer->deadline_usec - now) / 1000000.0f
+                  : 0.0f;
+  /* -1 indicates a timeout or failure from hardware. */
+  if (remaining <= 0.0f ||
+      teq1_receive(ese, xfer->opts, remaining, &xfer->rx_frame) < 0) {
+    /* TODO(wad): If the ese_error(ese) == 1, should this go ahead and fail?
+     */
+    /* Failures are considered invalid blocks in the rule engine below. */
+    xfer->rx_frame.header.PCB = 255;
+  }
+  if (xfer->rx_frame.header.PCB == S(WTX, REQUEST)) {
+    ese->stats.wtx_requests++;
+  }
 
-    /* Clear the inactive frame header for use as |next_tx|. */
-    ese_memset(&tx_frame[!active].header, 0, sizeof(tx_frame[!active].header));
+  /* Clear the inactive frame header for use as |next_tx|. */
+  next_tx = &xfer->tx_frame[!xfer->active];
+  ese_memset(&next_tx->header, 0, sizeof(next_tx->header));
 
-    result = teq1_rules(&state, tx, &rx_frame, &tx_frame[!active]);
-    ALOGV("[ %s ]", teq1_rule_result_to_name(result));
-    switch (result) {
-    case kRuleResultComplete:
-      done = true;
+  /* Unless the rules say otherwise, the next step is a transmission. */
+  xfer->step = kTeq1StepTransmit;
+  errors = state->errors;
+  rx_header = xfer->rx_frame.header;
+  result = teq1_rules(state, xfer->tx, &xfer->rx_frame, next_tx);
+  ese->stats.frame_errors += state->errors - errors;
+  /* Trace the frame as received; the rules may have marked it invalid. */
+  teq1_trace_record(kTeq1TraceReceive, rx_header.PCB, rx_header.LEN,
+                    (uint8_t)result, xfer->rx_frame.INF,
+                    rx_header.LEN == 255 ? 0 : rx_header.LEN);
+  ALOGV("[ %s ]", teq1_rule_result_to_name(result));
+  switch (result) {
+  case kRuleResultComplete:
+    /* Return the number of bytes used in the RX buffers. */
+    xfer->recvd = xfer->rx_total - state->app_data.rx_total;
+    xfer->step = kTeq1StepDone;
+    break;
+  case kRuleResultRetransmit:
+    ese->stats.retransmits++;
+    /* TODO(wad) Find a clean way to move into teq1_rules(). */
+    if (state->retransmits++ < 3) {
       break;
-    case kRuleResultRetransmit:
-      /* TODO(wad) Find a clean way to move into teq1_rules(). */
-      if (state.retransmits++ < 3) {
-        continue;
-      }
-      ALOGE("More than three retransmits have occurred");
-      if (tx->header.PCB == S(RESYNC, REQUEST)) {
-        /* More than three RESYNC retranmits have occurred. */
-        ese_set_error(ese, kTeq1ErrorHardFail);
-        return 0;
-      }
-      /* Fall through */
-      ALOGE("Triggering resynchronization.");
-      tx_frame[!active].header.PCB = S(RESYNC, REQUEST);
-    case kRuleResultContinue:
-      active = !active;
-      tx = &tx_frame[active];
-      /* Reset this to 0 to use the counter for RESYNC transmits. */
-      state.retransmits = 0;
-      /* Errors are not reset until the session is reset. */
-      continue;
-    case kRuleResultHardFail:
-      ese_set_error(ese, kTeq1ErrorHardFail);
-      return 0;
-    case kRuleResultAbort:
-      ese_set_error(ese, kTeq1ErrorAbort);
-      return 0;
-    case kRuleResultSingleShot:
-      /*
-       * Send the next_tx on loop, but tell the rule engine that
-       * the last sent state hasn't changed. This allows for easy error
-       * and supervisory block paths without nesting state.
+    }
+    ALOGE("More than three retransmits have occurred");
+    if (xfer->tx->header.PCB == S(RESYNC, REQUEST)) {
+      /* More than three RESYNC retranmits have occurred. */
+      teq1_transceive_fail(xfer, kTeq1ErrorHardFail);
+      break;
+    }
+    /* Fall through */
+    ALOGE("Triggering resynchronization.");
+    next_tx->header.PCB = S(RESYNC, REQUEST);
+  case kRuleResultContinue:
+    xfer->active = !xfer->active;
+    xfer->tx = &xfer->tx_frame[xfer->active];
+    /* Reset this to 0 to use the counter for RESYNC transmits. */
+    state->retransmits = 0;
+    /* Errors are not reset until the session is reset. */
+    break;
+  case kRuleResultHardFail:
+    teq1_transceive_fail(xfer, kTeq1ErrorHardFail);
+    break;
+  case kRuleResultAbort:
+    teq1_transceive_fail(xfer, kTeq1ErrorAbort);
+    break;
+  case kRuleResultSingleShot:
+    /*
+     * Send the next_tx on the next step, but tell the rule engine that
+     * the last sent state hasn't changed. This allows for easy error
+     * and supervisory block paths without nesting state.
+     */
+    xfer->tx = next_tx;
+    break;
+  case kRuleResultResetDevice:
+    needs_hw_reset = true;
+  /* Fall through to session reset. */
+  case kRuleResultResetSession:
+    /* Reset to initial state and possibly do hw reset */
+    ese->stats.session_resets++;
+    if (xfer->session_resets++ > 4) {
+      /* If there have been more than 4 resyncs without a
+       * physical reset, we should pull the plug.
        */
-      tx = &tx_frame[!active];
-      continue;
-    case kRuleResultResetDevice:
       needs_hw_reset = true;
-    /* Fall through to session reset. */
-    case kRuleResultResetSession:
-      /* Reset to initial state and possibly do hw reset */
-      if (session_resets++ > 4) {
-        /* If there have been more than 4 resyncs without a
-         * physical reset, we should pull the plug.
-         */
-        needs_hw_reset = true;
-      }
-      if (needs_hw_reset) {
-        needs_hw_reset = false;
-        if (was_reset || !ese->ops->hw_reset || ese->ops->hw_reset(ese) == -1) {
-          ese_set_error(ese, kTeq1ErrorDeviceReset);
-          return 0; /* Don't keep resetting -- hard fail. */
-        }
-        was_reset = true;
-        session_resets = 0;
+    }
+    if (needs_hw_reset) {
+      if (xfer->was_reset || !ese->ops->hw_reset ||
+          ese->ops->hw_reset(ese) == -1) {
+        /* Don't keep resetting -- hard fail. */
+        teq1_transceive_fail(xfer, kTeq1ErrorDeviceReset);
+        break;
       }
-      state = init_state;
-      TEQ1_INIT_CARD_STATE(state.card_state);
-      /* Reset the active frame. */
-      ese_memset(tx, 0, sizeof(*tx));
-      /* Load initial I-block. */
-      tx->header.PCB = I(0, 0);
-      teq1_fill_info_block(&state, tx);
-      continue;
+      xfer->was_reset = true;
+      xfer->session_resets = 0;
+      ese->stats.hw_resets++;
     }
+    *state = xfer->init_state;
+    TEQ1_INIT_CARD_STATE(state->card_state);
+    state->ifs = IFSC;
+    /* Reset the active frame. */
+    ese_memset(xfer->tx, 0, sizeof(*xfer->tx));
+    /* The card forgot our IFSD along with everything else. */
+    teq1_load_first_block(xfer);
+    break;
   }
-  /* Return the number of bytes used in the RX buffers. */
-  return rx_total - state.app_data.rx_total;
+  return xfer->step;
 }
 
-ESE_API uint8_t teq1_compute_LRC(const struct Teq1Frame *frame) {
-  uint8_t lrc = 0;
-  const uint8_t *buffer = frame->val;
-  const uint8_t *end = buffer + frame->header.LEN + sizeof(frame->header);
-  while (buffer < end) {
-    lrc ^= *buffer++;
+ESE_API uint32_t teq1_transceive_result(const struct Teq1Transceive *xfer) {
+  if (xfer->step != kTeq1StepDone) {
+    return 0;
+  }
+  return xfer->recvd;
+}
+
+ESE_API uint32_t teq1_transceive(struct EseInterface *ese,
+                                 const struct Teq1ProtocolOptions *opts,
+                                 const struct EseSgBuffer *tx_bufs,
+                                 uint8_t tx_segs, struct EseSgBuffer *rx_bufs,
+                                 uint8_t rx_segs) {
+  struct Teq1Transceive xfer;
+  teq1_transceive_init(&xfer, ese, opts, tx_bufs, tx_segs, rx_bufs, rx_segs);
+  while (teq1_transceive_process_one(&xfer) != kTeq1StepDone) {
+    /* The poll op blocks for the reply so there is nothing to wait on. */
+  }
+  return teq1_transceive_result(&xfer);
+}
+
+ESE_API int teq1_resync(struct EseInterface *ese,
+                        const struct Teq1ProtocolOptions *opts,
+                        float timeout) {
+  struct Teq1State state;
+  struct Teq1Frame tx_frame;
+  struct Teq1Frame rx_frame;
+  struct Teq1Header rx_header;
+  int ok;
+
+  ese_memset(&state, 0, sizeof(state));
+  ese_memset(&tx_frame, 0, sizeof(tx_frame));
+  tx_frame.header.PCB = S(RESYNC, REQUEST);
+  teq1_transmit(ese, opts, &state, &tx_frame);
+  if (ese_error(ese)) {
+    return -1;
+  }
+
+  ese_memset(&rx_frame.header, 0xff, sizeof(rx_frame.header));
+  if (teq1_receive(ese, opts, timeout, &rx_frame) < 0) {
+    rx_frame.header.PCB = 255;
+  }
+  rx_header = rx_frame.header;
+  ok = !ese_error(ese) && rx_header.PCB == S(RESYNC, RESPONSE) &&
+       rx_header.LEN == 0 && rx_frame.INF[0] == teq1_compute_LRC(&rx_frame);
+  if (!ok && rx_header.PCB != 255) {
+    ese->stats.frame_errors++;
+  }
+  teq1_trace_record(kTeq1TraceReceive, rx_header.PCB,
+                    rx_header.LEN == 255 ? 0 : rx_header.LEN,
+                    TEQ1_TRACE_RULE_NONE, rx_frame.INF, 0);
+  if (!ok) {
+    return -1;
+  }
+  /* Both ends start over from I(0, 0) and the default IFS. */
+  TEQ1_INIT_CARD_STATE((struct Teq1CardState *)(&ese->pad[0]));
+  return 0;
+}
+
+ESE_API uint8_t teq1_update_LRC(uint8_t lrc, const uint8_t *buf,
+                                uint32_t len) {
+  /* XOR is associative, so fold whole words and reduce them at the end. The
+   * four accumulators keep the loop free of a serial dependency. */
+  uint64_t acc[4] = {0, 0, 0, 0};
+  uint64_t word[4];
+  while (len >= sizeof(word)) {
+    __builtin_memcpy(word, buf, sizeof(word));
+    acc[0] ^= word[0];
+    acc[1] ^= word[1];
+    acc[2] ^= word[2];
+    acc[3] ^= word[3];
+    buf += sizeof(word);
+    len -= sizeof(word);
+  }
+  while (len >= sizeof(word[0])) {
+    __builtin_memcpy(word, buf, sizeof(word[0]));
+    acc[0] ^= word[0];
+    buf += sizeof(word[0]);
+    len -= sizeof(word[0]);
+  }
+  acc[0] ^= acc[1] ^ acc[2] ^ acc[3];
+  acc[0] ^= acc[0] >> 32;
+  acc[0] ^= acc[0] >> 16;
+  acc[0] ^= acc[0] >> 8;
+  lrc ^= (uint8_t)acc[0];
+  while (len--) {
+    lrc ^= *buf++;
   }
   return lrc;
 }
+
+ESE_API uint8_t teq1_compute_LRC(const struct Teq1Frame *frame) {
+  return teq1_update_LRC(0, frame->val,
+                         frame->header.LEN + sizeof(frame->header));
+}
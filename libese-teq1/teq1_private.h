@@ -52,41 +52,22 @@ extern "C" {
 
 #define TEQ1_RULE(TX, RX) (((TX & 255) << 8)|(RX & 255))
 
-struct Teq1State {
-  uint8_t wait_mult;
-  uint8_t ifs;
-  uint8_t errors;
-  int retransmits;
-  const char *last_error_message;
-  struct Teq1CardState *card_state;
-  struct {
-    const struct EseSgBuffer *tx;
-    struct EseSgBuffer *rx;
-    uint32_t tx_offset;
-    uint32_t tx_count;
-    uint32_t tx_total;
-    uint32_t rx_offset;
-    uint32_t rx_count;
-    uint32_t rx_total;
-  } app_data;
-};
-
 #define TEQ1_INIT_STATE(TX_BUFS, TX_LEN, TX_TOTAL_LEN, RX_BUFS, RX_LEN, RX_TOTAL_LEN, CSTATE) \
   { \
     .wait_mult = 1, \
     .ifs = IFSC, \
     .errors = 0, \
     .retransmits = 0, \
+    .zero_copy = false, \
     .last_error_message = NULL, \
     .card_state = (CSTATE), \
     .app_data = { \
       .tx = (TX_BUFS), \
       .rx = (RX_BUFS), \
-      .tx_offset = 0, \
-      .tx_count = (TX_LEN), \
+      .tx_cursor = ESE_SG_CURSOR_INIT((TX_BUFS), (TX_LEN)), \
+      .tx_block = ESE_SG_CURSOR_INIT((TX_BUFS), (TX_LEN)), \
       .tx_total = (TX_TOTAL_LEN), \
-      .rx_offset = 0, \
-      .rx_count = (RX_LEN), \
+      .rx_cursor = ESE_SG_CURSOR_INIT((RX_BUFS), (RX_LEN)), \
       .rx_total = (RX_TOTAL_LEN), \
     }, \
   }
@@ -107,6 +88,7 @@ const char *teq1_rule_result_to_name(enum RuleResult result);
 const char *teq1_pcb_to_name(uint8_t pcb);
 int teq1_transmit(struct EseInterface *ese,
                   const struct Teq1ProtocolOptions *opts,
+                  const struct Teq1State *state,
                   struct Teq1Frame *frame);
 int teq1_receive(struct EseInterface *ese,
                  const struct Teq1ProtocolOptions *opts,
@@ -122,8 +104,14 @@ enum RuleResult teq1_rules(struct Teq1State *state,
                            struct Teq1Frame *rx_frame,
                            struct Teq1Frame *next_tx);
 
+/* Byte dumps are only for bring up; the trace ring covers production. */
+#if defined(LOG_NDEBUG) && LOG_NDEBUG == 0
 #define teq1_dump_transmit(_B, _L) teq1_dump_buf("TX", (_B), (_L))
 #define teq1_dump_receive(_B, _L) teq1_dump_buf("RX", (_B), (_L))
+#else
+#define teq1_dump_transmit(_B, _L) do { } while (0)
+#define teq1_dump_receive(_B, _L) do { } while (0)
+#endif
 
 #ifdef __cplusplus
 }  /* extern "C" */
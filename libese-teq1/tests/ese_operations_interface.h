@@ -18,6 +18,8 @@
 #ifndef ESE_OPERATIONS_INTERFACE_H_
 #define ESE_OPERATIONS_INTERFACE_H_ 1
 
+#include <vector>
+
 #include <ese/ese.h>
 
 class EseOperationsInterface {
@@ -28,6 +30,13 @@ class EseOperationsInterface {
   virtual int EseOpen(struct EseInterface *ese, void *data) = 0;
   virtual uint32_t EseHwReceive(struct EseInterface *ese, uint8_t *data, uint32_t len, int complete) = 0;
   virtual uint32_t EseHwTransmit(struct EseInterface *ese, const uint8_t *data, uint32_t len, int complete) = 0;
+  // Only reachable through the scatter-gather ops. Defaults to a gathered EseHwTransmit().
+  virtual uint32_t EseHwTransmitSg(struct EseInterface *ese, const struct EseSgBuffer *bufs, uint32_t cnt,
+                                   int complete) {
+    std::vector<uint8_t> data(ese_sg_length(bufs, cnt));
+    ese_sg_to_buf(bufs, cnt, 0, data.size(), data.data());
+    return EseHwTransmit(ese, data.data(), data.size(), complete);
+  }
   virtual int EseReset(struct EseInterface *ese) = 0;
   virtual uint32_t EseTransceive(struct EseInterface *ese, const struct EseSgBuffer *tx_sg, uint32_t tx_nsg,
                                  struct EseSgBuffer *rx_sg, uint32_t rx_nsg) = 0;
@@ -28,6 +28,13 @@ void EseOperationsWrapper::InitializeEse(
   ese_init(ese, data.wrapper);
 }
 
+void EseOperationsWrapper::InitializeEseSg(
+    struct EseInterface *ese, EseOperationsInterface *ops_interface) {
+  EseOperationsWrapperData data;
+  data.ops_interface = ops_interface;
+  ese_init(ese, data.sg_wrapper);
+}
+
 static int EseOpen(struct EseInterface *ese, void *data) {
   return EseOperationsWrapperData::ops_interface->EseOpen(ese, data);
 }
@@ -40,6 +47,11 @@ static uint32_t EseHwTransmit(struct EseInterface *ese, const uint8_t *data, uin
   return EseOperationsWrapperData::ops_interface->EseHwTransmit(ese, data, len, complete);
 }
 
+static uint32_t EseHwTransmitSg(struct EseInterface *ese, const struct EseSgBuffer *bufs, uint32_t cnt,
+                                int complete) {
+  return EseOperationsWrapperData::ops_interface->EseHwTransmitSg(ese, bufs, cnt, complete);
+}
+
 static int EseReset(struct EseInterface *ese) {
   return EseOperationsWrapperData::ops_interface->EseReset(ese);
 }
@@ -79,3 +91,20 @@ const struct EseOperations EseOperationsWrapperData::ops = {
 };
 const struct EseOperations *EseOperationsWrapperData::wrapper_ops =
   &EseOperationsWrapperData::ops;
+
+const struct EseOperations EseOperationsWrapperData::sg_ops = {
+  .name = "EseOperationsWrapper SG HW",
+  .open = &EseOpen,
+  .hw_receive = &EseHwReceive,
+  .hw_transmit = &EseHwTransmit,
+  .hw_reset = &EseReset,
+  .poll = &EsePoll,
+  .transceive = &EseTransceive,
+  .close = &EseClose,
+  .opts = NULL,
+  .errors = kErrors,
+  .errors_count = sizeof(kErrors),
+  .hw_transmit_sg = &EseHwTransmitSg,
+};
+const struct EseOperations *EseOperationsWrapperData::sg_wrapper_ops =
+  &EseOperationsWrapperData::sg_ops;
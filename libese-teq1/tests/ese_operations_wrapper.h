@@ -29,6 +29,9 @@ class EseOperationsWrapperData {
   static EseOperationsInterface *ops_interface;
   static const struct EseOperations ops;
   static const struct EseOperations *wrapper_ops;
+  // Same as |ops| but with hw_transmit_sg populated.
+  static const struct EseOperations sg_ops;
+  static const struct EseOperations *sg_wrapper_ops;
 };
 
 class EseOperationsWrapper {
@@ -37,6 +40,7 @@ class EseOperationsWrapper {
   EseOperationsWrapper() = default;
   virtual ~EseOperationsWrapper() = default;
   static void InitializeEse(struct EseInterface *ese, EseOperationsInterface *ops_interface);
+  static void InitializeEseSg(struct EseInterface *ese, EseOperationsInterface *ops_interface);
 };
 
 #endif  // ESE_OPERATIONS_WRAPPER_H_
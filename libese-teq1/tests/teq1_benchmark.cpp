@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Compares the word-wide LRC against a byte-at-a-time reference over
+ * common frame sizes.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ese/teq1.h>
+
+static uint8_t BytewiseLrc(const uint8_t *buf, uint32_t len) {
+  uint8_t lrc = 0;
+  while (len--) {
+    lrc ^= *buf++;
+  }
+  return lrc;
+}
+
+static std::vector<uint8_t> Payload(size_t len) {
+  std::vector<uint8_t> data(len);
+  for (size_t i = 0; i < len; ++i) {
+    data[i] = static_cast<uint8_t>(i * 131 + 7);
+  }
+  return data;
+}
+
+static void BM_LrcBytewise(benchmark::State& state) {
+  const std::vector<uint8_t> data = Payload(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BytewiseLrc(data.data(), data.size()));
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_LrcBytewise)->Arg(4)->Arg(64)->Arg(258);
+
+static void BM_LrcWordwise(benchmark::State& state) {
+  const std::vector<uint8_t> data = Payload(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(teq1_update_LRC(0, data.data(), data.size()));
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_LrcWordwise)->Arg(4)->Arg(64)->Arg(258);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Measures the host CPU cost of a T=1 exchange against an in-memory card
+ * which answers every I-block at once.  Built once against libese-teq1 and
+ * once against libese-teq1-quiet to compare the logging cost per frame.
+ */
+
+#include <string.h>
+
+#include <benchmark/benchmark.h>
+
+#include <ese/ese.h>
+#include <ese/teq1.h>
+
+#ifndef TEQ1_LOG_VARIANT
+#define TEQ1_LOG_VARIANT "default"
+#endif
+
+namespace {
+
+const struct Teq1ProtocolOptions kOptions = {
+  .host_address = 0xA5,
+  .node_address = 0x5A,
+  .bwt = 1.624f,
+  .etu = 0.00015f,
+  .preprocess = NULL,
+  .lrc_nad_override = false,
+  .lrc_nad = 0x00,
+  .ifsd = 0,
+};
+
+// The reply frame is staged by poll() and drained by hw_receive().
+struct Card {
+  uint8_t frame[6];
+  uint32_t offset;
+};
+Card g_card;
+
+uint32_t CardReceive(struct EseInterface *, uint8_t *buf, uint32_t len,
+                     int) {
+  if (buf) {
+    memcpy(buf, g_card.frame + g_card.offset, len);
+  }
+  g_card.offset += len;
+  return len;
+}
+
+uint32_t CardTransmit(struct EseInterface *, const uint8_t *, uint32_t len,
+                      int) {
+  return len;
+}
+
+int CardPoll(struct EseInterface *ese, uint8_t, float, int) {
+  const struct Teq1CardState *card =
+      reinterpret_cast<const struct Teq1CardState *>(&ese->pad[0]);
+  g_card.frame[0] = kOptions.host_address;
+  g_card.frame[1] = TEQ1_I(!card->seq.card, 0);
+  g_card.frame[2] = 2;
+  g_card.frame[3] = 0x90;
+  g_card.frame[4] = 0x00;
+  g_card.frame[5] = teq1_update_LRC(0, g_card.frame, 5);
+  g_card.offset = 1;
+  return 1;
+}
+
+const struct EseOperations kCardOps = {
+  .name = "in-memory card",
+  .open = NULL,
+  .hw_receive = &CardReceive,
+  .hw_transmit = &CardTransmit,
+  .hw_reset = NULL,
+  .poll = &CardPoll,
+  .transceive = NULL,
+  .close = NULL,
+  .opts = NULL,
+  .errors = NULL,
+  .errors_count = 0,
+  .hw_transmit_sg = NULL,
+};
+
+void BM_Teq1FrameCost(benchmark::State& state) {
+  struct EseInterface ese = {
+    .ops = &kCardOps,
+    .error = { .is_err = false, .code = 0, .message = NULL },
+    .pad = { 0 },
+  };
+  TEQ1_INIT_CARD_STATE(reinterpret_cast<struct Teq1CardState *>(&ese.pad[0]));
+  const uint8_t apdu[] = { 0x80, 0xca, 0x00, 0x00, 0x00 };
+  uint8_t reply[16];
+  const struct EseSgBuffer tx = { .c_base = apdu, .len = sizeof(apdu) };
+  struct EseSgBuffer rx = { .base = reply, .len = sizeof(reply) };
+  for (auto _ : state) {
+    if (teq1_transceive(&ese, &kOptions, &tx, 1, &rx, 1) != 2) {
+      state.SkipWithError("transceive failed");
+      return;
+    }
+  }
+  // One frame out and one frame back per exchange.
+  state.counters["per_frame"] = benchmark::Counter(
+      2.0 * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.SetLabel(TEQ1_LOG_VARIANT);
+}
+BENCHMARK(BM_Teq1FrameCost);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -221,6 +221,26 @@ TEST_F(Teq1ErrorFreeTest, I00_WTX0_WTX1_data) {
    << "Actual result name: " << teq1_rule_result_to_name(result);
 };
 
+// The card's sequence numbers are independent of ours, e.g. after we
+// chained an odd number of blocks.
+TEST_F(Teq1ErrorFreeTest, I10_I01_chained_response) {
+  tx_frame_.header.PCB = TEQ1_I(1, 0);
+  teq1_fill_info_block(&state_, &tx_frame_);
+
+  rx_frame_.header.PCB = TEQ1_I(0, 1);
+  rx_frame_.header.LEN = 16;
+  memset(rx_frame_.INF, 0x5a, 16);
+  rx_frame_.INF[16] = teq1_compute_LRC(&rx_frame_);
+
+  enum RuleResult result = teq1_rules(&state_,  &tx_frame_, &rx_frame_, &tx_next_);
+  EXPECT_EQ(0, state_.errors);
+  EXPECT_EQ(TEQ1_R(1, 0, 0), tx_next_.header.PCB)
+    << "Actual next TX: " << teq1_pcb_to_name(tx_next_.header.PCB);
+  EXPECT_EQ(kRuleResultContinue, result)
+   << "Actual result name: " << teq1_rule_result_to_name(result);
+  EXPECT_EQ(INF_LEN - 16u, state_.app_data.rx_total);
+};
+
 class Teq1ErrorFreeChainingTest : public Teq1ErrorFreeTest {
  public:
   virtual void RunRules() {
@@ -392,7 +412,7 @@ std::string to_hex(const std::vector<uint8_t>& data) {
 
 class EseWireFake : public EseOperationsInterface {
  public:
-  EseWireFake() : tx_cursor_(0), rx_cursor_(0) { }
+  EseWireFake() : sg_transmits(0), sg_segments(0), tx_cursor_(0), rx_cursor_(0) { }
   virtual ~EseWireFake() = default;
 
   virtual int EseOpen(struct EseInterface *UNUSED(ese), void *UNUSED(data)) {
@@ -442,6 +462,13 @@ class EseWireFake : public EseOperationsInterface {
     return len;
   }
 
+  virtual uint32_t EseHwTransmitSg(struct EseInterface *ese, const struct EseSgBuffer *bufs,
+                                   uint32_t cnt, int complete) {
+    sg_transmits++;
+    sg_segments += cnt;
+    return EseOperationsInterface::EseHwTransmitSg(ese, bufs, cnt, complete);
+  }
+
   virtual uint32_t EseHwReceive(struct EseInterface *UNUSED(ese), uint8_t *data,
                                 uint32_t len, int UNUSED(complete)) {
     if (!len) {
@@ -480,6 +507,8 @@ class EseWireFake : public EseOperationsInterface {
   };
 
   std::vector<Invocation> invocations;
+  uint32_t sg_transmits;
+  uint32_t sg_segments;
  private:
   uint32_t tx_cursor_;
   uint32_t rx_cursor_;
@@ -760,3 +789,480 @@ TEST_F(Teq1TransceiveTest, RetransmitResyncLoop) {
 };
 
 
+
+TEST_F(Teq1TransceiveTest, SteppedTransceiveRetransmitRecovery) {
+  EXPECT_EQ(0, ese_open(&ese_, NULL));
+
+  // I(0,0) [4] ->
+  //            <- R(0, 1, 0)
+  // I(0,0) [4] ->
+  //            <- I(0, 0) [2]
+  wire_.invocations.resize(2);
+  struct Teq1Frame frame;
+  size_t frame_size = 0;
+  frame.header.NAD = kTeq1Options.node_address;
+  frame.header.PCB = TEQ1_I(0, 0);
+  frame.header.LEN = 4;
+  frame.INF[0] = 'A';
+  frame.INF[1] = 'B';
+  frame.INF[2] = 'C';
+  frame.INF[3] = 'D';
+  frame.INF[frame.header.LEN] = teq1_compute_LRC(&frame);
+  frame_size = sizeof(frame.header) + frame.header.LEN + 1;
+  wire_.invocations[0].expected_tx.resize(frame_size);
+  memcpy(wire_.invocations[0].expected_tx.data(), &frame.val[0], frame_size);
+  wire_.invocations[1].expected_tx.resize(frame_size);
+  memcpy(wire_.invocations[1].expected_tx.data(), &frame.val[0], frame_size);
+
+  frame.header.LEN = 0;
+  frame.header.NAD = kTeq1Options.host_address;
+  frame.header.PCB = TEQ1_R(0, 1, 0);
+  frame.INF[frame.header.LEN] = teq1_compute_LRC(&frame);
+  frame_size = sizeof(frame.header) + frame.header.LEN + 1;
+  wire_.invocations[0].rx.resize(frame_size);
+  memcpy(wire_.invocations[0].rx.data(), &frame, frame_size);
+
+  frame.header.LEN = 2;
+  frame.header.NAD = kTeq1Options.host_address;
+  frame.header.PCB = TEQ1_I(0, 0);
+  frame.INF[0] = 0x90;
+  frame.INF[1] = 0x00;
+  frame.INF[frame.header.LEN] = teq1_compute_LRC(&frame);
+  frame_size = sizeof(frame.header) + frame.header.LEN + 1;
+  wire_.invocations[1].rx.resize(frame_size);
+  memcpy(wire_.invocations[1].rx.data(), &frame, frame_size);
+
+  const uint8_t payload[] = { 'A', 'B', 'C', 'D' };
+  uint8_t reply[5];
+  const struct EseSgBuffer tx = { .c_base = payload, .len = sizeof(payload) };
+  struct EseSgBuffer rx = { .base = reply, .len = sizeof(reply) };
+  struct Teq1Transceive xfer;
+  teq1_transceive_init(&xfer, &ese_, &kTeq1Options, &tx, 1, &rx, 1);
+  EXPECT_EQ(kTeq1StepTransmit, xfer.step);
+
+  const enum Teq1TransceiveStep kExpected[] = {
+    kTeq1StepReceive, kTeq1StepTransmit,  // Retransmit after R(0, 1, 0).
+    kTeq1StepReceive, kTeq1StepDone,
+  };
+  for (const auto expected : kExpected) {
+    EXPECT_EQ(expected, teq1_transceive_process_one(&xfer));
+    if (xfer.step == kTeq1StepReceive) {
+      EXPECT_FLOAT_EQ(kTeq1Options.bwt, xfer.timeout);
+    }
+  }
+  // Stepping a finished exchange is a no-op.
+  EXPECT_EQ(kTeq1StepDone, teq1_transceive_process_one(&xfer));
+  EXPECT_EQ(2U, teq1_transceive_result(&xfer));
+  EXPECT_EQ(0x90, reply[0]);
+  EXPECT_EQ(0x00, reply[1]);
+  EXPECT_FALSE(ese_error(&ese_));
+};
+
+class Teq1TransceiveSgTest : public Teq1TransceiveTest {
+ public:
+  void SetUp() {
+    EseOperationsWrapper::InitializeEseSg(&ese_, &wire_);
+    TEQ1_INIT_CARD_STATE((struct Teq1CardState *)(&(ese_.pad[0])));
+  }
+
+  static std::vector<uint8_t> Frame(uint8_t nad, uint8_t pcb, const uint8_t *inf, uint8_t len) {
+    struct Teq1Frame frame;
+    frame.header.NAD = nad;
+    frame.header.PCB = pcb;
+    frame.header.LEN = len;
+    if (len) {
+      memcpy(frame.INF, inf, len);
+    }
+    frame.INF[len] = teq1_compute_LRC(&frame);
+    return std::vector<uint8_t>(frame.val, frame.val + sizeof(frame.header) + len + 1);
+  }
+};
+
+TEST_F(Teq1TransceiveTest, SteppedReceiveAfterDeadlineTimesOut) {
+  EXPECT_EQ(0, ese_open(&ese_, NULL));
+  const uint8_t payload[] = { 'A', 'B', 'C', 'D' };
+  wire_.invocations.resize(1);
+  wire_.invocations[0].expected_tx = Teq1TransceiveSgTest::Frame(
+      kTeq1Options.node_address, TEQ1_I(0, 0), payload, sizeof(payload));
+
+  uint8_t reply[5];
+  const struct EseSgBuffer tx = { .c_base = payload, .len = sizeof(payload) };
+  struct EseSgBuffer rx = { .base = reply, .len = sizeof(reply) };
+  struct Teq1Transceive xfer;
+  teq1_transceive_init(&xfer, &ese_, &kTeq1Options, &tx, 1, &rx, 1);
+  const uint64_t sent = ese_monotonic_usec();
+  EXPECT_EQ(kTeq1StepReceive, teq1_transceive_process_one(&xfer));
+  EXPECT_GE(xfer.deadline_usec, sent + static_cast<uint64_t>(kTeq1Options.bwt * 1e6f) - 1);
+  EXPECT_LE(xfer.deadline_usec, ese_monotonic_usec() +
+                                    static_cast<uint64_t>(kTeq1Options.bwt * 1e6f) + 1);
+
+  // A caller that comes back too late gets no wait and no frame; the rules
+  // treat it as a timeout and answer with an error R-block.
+  xfer.deadline_usec = ese_monotonic_usec() - 1;
+  EXPECT_EQ(kTeq1StepTransmit, teq1_transceive_process_one(&xfer));
+  EXPECT_EQ(0U, ese_.stats.frames_received);
+  EXPECT_EQ(kPcbTypeReceiveReady, bs_get(PCB.type, xfer.tx->header.PCB));
+};
+
+TEST_F(Teq1TransceiveSgTest, ChainedFromSegments) {
+  EXPECT_EQ(0, ese_open(&ese_, NULL));
+
+  // The payload is split across three caller segments with the first I-block
+  // spanning all of them.
+  // I(0,1) [254] ->
+  //              <- R(1, 0, 0)
+  // I(1,0) [46]  ->
+  //              <- I(0, 0) [2]
+  uint8_t payload[300];
+  for (size_t i = 0; i < sizeof(payload); ++i) {
+    payload[i] = static_cast<uint8_t>(i);
+  }
+  const uint8_t kOk[] = { 0x90, 0x00 };
+  wire_.invocations.resize(2);
+  wire_.invocations[0].expected_tx =
+      Frame(kTeq1Options.node_address, TEQ1_I(0, 1), payload, 254);
+  wire_.invocations[0].rx = Frame(kTeq1Options.host_address, TEQ1_R(1, 0, 0), NULL, 0);
+  wire_.invocations[1].expected_tx =
+      Frame(kTeq1Options.node_address, TEQ1_I(1, 0), payload + 254, 46);
+  wire_.invocations[1].rx = Frame(kTeq1Options.host_address, TEQ1_I(0, 0), kOk, 2);
+
+  const struct EseSgBuffer tx[] = {
+    { .c_base = payload, .len = 100 },
+    { .c_base = payload + 100, .len = 100 },
+    { .c_base = payload + 200, .len = 100 },
+  };
+  uint8_t reply[5];
+  struct EseSgBuffer rx = { .base = reply, .len = sizeof(reply) };
+  EXPECT_EQ(2, ese_transceive_sg(&ese_, tx, 3, &rx, 1));
+  EXPECT_FALSE(ese_error(&ese_));
+  EXPECT_EQ(0x90, reply[0]);
+  EXPECT_EQ(0x00, reply[1]);
+  // Header + 3 segments + LRC, then header + 1 segment + LRC.
+  EXPECT_EQ(2U, wire_.sg_transmits);
+  EXPECT_EQ(8U, wire_.sg_segments);
+};
+
+TEST(Teq1Lrc, MatchesBytewiseAtAnyAlignment) {
+  uint8_t data[300 + 8];
+  for (size_t i = 0; i < sizeof(data); ++i) {
+    data[i] = static_cast<uint8_t>(i * 131 + 7);
+  }
+  for (uint32_t offset = 0; offset < 8; ++offset) {
+    for (uint32_t len = 0; len <= 300; ++len) {
+      uint8_t expected = 0x5a;
+      for (uint32_t i = 0; i < len; ++i) {
+        expected ^= data[offset + i];
+      }
+      EXPECT_EQ(expected, teq1_update_LRC(0x5a, data + offset, len))
+          << "offset " << offset << " len " << len;
+    }
+  }
+};
+
+TEST_F(Teq1TransceiveTest, LrcNadOverride) {
+  static const struct Teq1ProtocolOptions kLrcNadOptions = {
+    .host_address = 0xA5,
+    .node_address = 0x5A,
+    .bwt = 1.624f,
+    .etu = 0.00015f,
+    .preprocess = NULL,
+    .lrc_nad_override = true,
+    .lrc_nad = 0x00,
+  };
+  EXPECT_EQ(0, ese_open(&ese_, NULL));
+
+  // The LRC is computed with a NAD of 0 while the wire carries 5A/A5.
+  // I(0,0) [4] ->
+  //            <- I(0, 0) [2]
+  wire_.invocations.resize(1);
+  struct Teq1Frame frame;
+  size_t frame_size = 0;
+  frame.header.NAD = 0x00;
+  frame.header.PCB = TEQ1_I(0, 0);
+  frame.header.LEN = 4;
+  frame.INF[0] = 'A';
+  frame.INF[1] = 'B';
+  frame.INF[2] = 'C';
+  frame.INF[3] = 'D';
+  frame.INF[frame.header.LEN] = teq1_compute_LRC(&frame);
+  frame.header.NAD = kLrcNadOptions.node_address;
+  frame_size = sizeof(frame.header) + frame.header.LEN + 1;
+  wire_.invocations[0].expected_tx.assign(frame.val, frame.val + frame_size);
+
+  frame.header.NAD = 0x00;
+  frame.header.LEN = 2;
+  frame.INF[0] = 0x90;
+  frame.INF[1] = 0x00;
+  frame.INF[frame.header.LEN] = teq1_compute_LRC(&frame);
+  frame.header.NAD = kLrcNadOptions.host_address;
+  frame_size = sizeof(frame.header) + frame.header.LEN + 1;
+  wire_.invocations[0].rx.assign(frame.val, frame.val + frame_size);
+
+  const uint8_t payload[] = { 'A', 'B', 'C', 'D' };
+  uint8_t reply[5];
+  const struct EseSgBuffer tx = { .c_base = payload, .len = sizeof(payload) };
+  struct EseSgBuffer rx = { .base = reply, .len = sizeof(reply) };
+  EXPECT_EQ(2U, teq1_transceive(&ese_, &kLrcNadOptions, &tx, 1, &rx, 1));
+  EXPECT_FALSE(ese_error(&ese_));
+  EXPECT_EQ(0x90, reply[0]);
+  EXPECT_EQ(0x00, reply[1]);
+};
+
+TEST_F(Teq1TransceiveTest, IfsNegotiatedOnceAndKept) {
+  static const struct Teq1ProtocolOptions kIfsOptions = {
+    .host_address = 0xA5,
+    .node_address = 0x5A,
+    .bwt = 1.624f,
+    .etu = 0.00015f,
+    .preprocess = NULL,
+    .lrc_nad_override = false,
+    .lrc_nad = 0x00,
+    .ifsd = 254,
+  };
+  const uint8_t kNode = kIfsOptions.node_address;
+  const uint8_t kHost = kIfsOptions.host_address;
+  const uint8_t kIfsd[] = { 254 };
+  const uint8_t kIfsc[] = { 32 };
+  const uint8_t kOk[] = { 0x90, 0x00 };
+  uint8_t payload[40];
+  for (size_t i = 0; i < sizeof(payload); ++i) {
+    payload[i] = static_cast<uint8_t>(i);
+  }
+  EXPECT_EQ(0, ese_open(&ese_, NULL));
+
+  // First exchange:
+  // S(IFS, REQUEST) [254] ->
+  //                       <- S(IFS, RESPONSE) [254]
+  // I(0,0) [4]            ->
+  //                       <- S(IFS, REQUEST) [32]
+  // S(IFS, RESPONSE) [32] ->
+  //                       <- I(0, 0) [2]
+  // Second exchange, no renegotiation and chained at the card's IFSC:
+  // I(1,1) [32]           ->
+  //                       <- R(0, 0, 0)
+  // I(0,0) [8]            ->
+  //                       <- I(1, 0) [2]
+  wire_.invocations.resize(5);
+  wire_.invocations[0].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_S_IFS(0), kIfsd, 1);
+  wire_.invocations[0].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_S_IFS(1), kIfsd, 1);
+  wire_.invocations[1].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_I(0, 0), payload, 4);
+  wire_.invocations[1].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_S_IFS(0), kIfsc, 1);
+  wire_.invocations[2].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_S_IFS(1), kIfsc, 1);
+  wire_.invocations[2].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_I(0, 0), kOk, 2);
+  wire_.invocations[3].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_I(1, 1), payload, 32);
+  wire_.invocations[3].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_R(0, 0, 0), NULL, 0);
+  wire_.invocations[4].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_I(0, 0), payload + 32, 8);
+  wire_.invocations[4].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_I(1, 0), kOk, 2);
+
+  uint8_t reply[5];
+  struct EseSgBuffer rx = { .base = reply, .len = sizeof(reply) };
+  struct EseSgBuffer tx = { .c_base = payload, .len = 4 };
+  EXPECT_EQ(2U, teq1_transceive(&ese_, &kIfsOptions, &tx, 1, &rx, 1));
+  EXPECT_FALSE(ese_error(&ese_));
+
+  tx.len = sizeof(payload);
+  EXPECT_EQ(2U, teq1_transceive(&ese_, &kIfsOptions, &tx, 1, &rx, 1));
+  EXPECT_FALSE(ese_error(&ese_));
+  EXPECT_EQ(0x90, reply[0]);
+  EXPECT_EQ(0x00, reply[1]);
+
+  const struct Teq1CardState *card_state =
+      reinterpret_cast<const struct Teq1CardState *>(&ese_.pad[0]);
+  EXPECT_EQ(32, card_state->ifsc);
+  EXPECT_EQ(254, card_state->ifsd);
+};
+
+static const struct Teq1ProtocolOptions kIfsdOptions = {
+  .host_address = 0xA5,
+  .node_address = 0x5A,
+  .bwt = 1.624f,
+  .etu = 0.00015f,
+  .preprocess = NULL,
+  .lrc_nad_override = false,
+  .lrc_nad = 0x00,
+  .ifsd = 254,
+};
+
+TEST_F(Teq1TransceiveTest, IfsdNotResentWhenCardAnswersLess) {
+  const uint8_t kNode = kIfsdOptions.node_address;
+  const uint8_t kHost = kIfsdOptions.host_address;
+  const uint8_t kIfsd[] = { 254 };
+  const uint8_t kAgreed[] = { 128 };
+  const uint8_t payload[] = { 'A', 'B', 'C', 'D' };
+  const uint8_t kOk[] = { 0x90, 0x00 };
+  EXPECT_EQ(0, ese_open(&ese_, NULL));
+
+  // S(IFS, REQUEST) [254] ->
+  //                       <- S(IFS, RESPONSE) [128]
+  // I(0,0) [4]            ->
+  //                       <- I(0, 0) [2]
+  // Second exchange goes straight to the I-block:
+  // I(1,0) [4]            ->
+  //                       <- I(1, 0) [2]
+  wire_.invocations.resize(3);
+  wire_.invocations[0].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_S_IFS(0), kIfsd, 1);
+  wire_.invocations[0].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_S_IFS(1), kAgreed, 1);
+  wire_.invocations[1].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_I(0, 0), payload, 4);
+  wire_.invocations[1].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_I(0, 0), kOk, 2);
+  wire_.invocations[2].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_I(1, 0), payload, 4);
+  wire_.invocations[2].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_I(1, 0), kOk, 2);
+
+  uint8_t reply[5];
+  const struct EseSgBuffer tx = { .c_base = payload, .len = sizeof(payload) };
+  struct EseSgBuffer rx = { .base = reply, .len = sizeof(reply) };
+  EXPECT_EQ(2U, teq1_transceive(&ese_, &kIfsdOptions, &tx, 1, &rx, 1));
+  EXPECT_FALSE(ese_error(&ese_));
+  EXPECT_EQ(2U, teq1_transceive(&ese_, &kIfsdOptions, &tx, 1, &rx, 1));
+  EXPECT_FALSE(ese_error(&ese_));
+
+  const struct Teq1CardState *card_state =
+      reinterpret_cast<const struct Teq1CardState *>(&ese_.pad[0]);
+  EXPECT_EQ(128, card_state->ifsd);
+  EXPECT_EQ(254, card_state->ifsd_sent);
+};
+
+TEST_F(Teq1TransceiveTest, IfsdReadvertisedAfterResync) {
+  const uint8_t kNode = kIfsdOptions.node_address;
+  const uint8_t kHost = kIfsdOptions.host_address;
+  const uint8_t kIfsd[] = { 254 };
+  const uint8_t payload[] = { 'A', 'B', 'C', 'D' };
+  const uint8_t kOk[] = { 0x90, 0x00 };
+  EXPECT_EQ(0, ese_open(&ese_, NULL));
+
+  // S(IFS, REQUEST) [254]  ->
+  //                        <- S(IFS, RESPONSE) [254]
+  // I(0,0) [4]             ->
+  //                        <- R(0, 1, 0)
+  // ... three more times ...
+  // S(RESYNC, REQUEST)     ->
+  //                        <- S(RESYNC, RESPONSE)
+  // The card has dropped our IFSD, so it goes out again:
+  // S(IFS, REQUEST) [254]  ->
+  //                        <- S(IFS, RESPONSE) [254]
+  // I(0,0) [4]             ->
+  //                        <- I(0, 0) [2]
+  wire_.invocations.resize(8);
+  wire_.invocations[0].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_S_IFS(0), kIfsd, 1);
+  wire_.invocations[0].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_S_IFS(1), kIfsd, 1);
+  for (int i = 1; i <= 4; ++i) {
+    wire_.invocations[i].expected_tx =
+        Teq1TransceiveSgTest::Frame(kNode, TEQ1_I(0, 0), payload, 4);
+    wire_.invocations[i].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_R(0, 1, 0), NULL, 0);
+  }
+  wire_.invocations[5].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_S_RESYNC(0), NULL, 0);
+  wire_.invocations[5].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_S_RESYNC(1), NULL, 0);
+  wire_.invocations[6] = wire_.invocations[0];
+  wire_.invocations[7].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_I(0, 0), payload, 4);
+  wire_.invocations[7].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_I(0, 0), kOk, 2);
+
+  uint8_t reply[5];
+  const struct EseSgBuffer tx = { .c_base = payload, .len = sizeof(payload) };
+  struct EseSgBuffer rx = { .base = reply, .len = sizeof(reply) };
+  EXPECT_EQ(2U, teq1_transceive(&ese_, &kIfsdOptions, &tx, 1, &rx, 1));
+  EXPECT_FALSE(ese_error(&ese_));
+
+  const struct Teq1CardState *card_state =
+      reinterpret_cast<const struct Teq1CardState *>(&ese_.pad[0]);
+  EXPECT_EQ(254, card_state->ifsd_sent);
+};
+
+TEST_F(Teq1TransceiveTest, StatsCountFramesAndRetransmits) {
+  const uint8_t kNode = kTeq1Options.node_address;
+  const uint8_t kHost = kTeq1Options.host_address;
+  const uint8_t payload[] = { 'A', 'B', 'C', 'D' };
+  const uint8_t kOk[] = { 0x90, 0x00 };
+  EXPECT_EQ(0, ese_open(&ese_, NULL));
+
+  // I(0,0) [4] ->
+  //            <- R(0, 1, 0)
+  // I(0,0) [4] ->
+  //            <- I(0, 0) [2]
+  wire_.invocations.resize(2);
+  wire_.invocations[0].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_I(0, 0), payload, 4);
+  wire_.invocations[0].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_R(0, 1, 0), NULL, 0);
+  wire_.invocations[1].expected_tx = wire_.invocations[0].expected_tx;
+  wire_.invocations[1].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_I(0, 0), kOk, 2);
+
+  uint8_t reply[5];
+  EXPECT_EQ(2, ese_transceive(&ese_, payload, sizeof(payload), reply, sizeof(reply)));
+
+  struct EseStats stats;
+  ese_get_stats(&ese_, &stats);
+  EXPECT_EQ(2U, stats.frames_sent);
+  EXPECT_EQ(2U, stats.frames_received);
+  EXPECT_EQ(2U * (3 + 4 + 1), stats.bytes_sent);
+  EXPECT_EQ((3U + 0 + 1) + (3 + 2 + 1), stats.bytes_received);
+  EXPECT_EQ(1U, stats.retransmits);
+  EXPECT_EQ(0U, stats.resyncs);
+  EXPECT_EQ(0U, stats.session_resets);
+  EXPECT_EQ(0U, stats.hw_resets);
+  EXPECT_EQ(1U, stats.transceive_latency.count);
+  EXPECT_EQ(2U, stats.card_latency.count);
+  EXPECT_EQ(4U, stats.bus_latency.count);
+
+  ese_reset_stats(&ese_);
+  ese_get_stats(&ese_, &stats);
+  EXPECT_EQ(0U, stats.frames_sent);
+  EXPECT_EQ(0U, stats.bus_latency.count);
+};
+
+TEST_F(Teq1TransceiveTest, TraceRingRecordsFrames) {
+  const uint8_t kNode = kTeq1Options.node_address;
+  const uint8_t kHost = kTeq1Options.host_address;
+  const uint8_t payload[] = { 'A', 'B', 'C', 'D' };
+  const uint8_t kOk[] = { 0x90, 0x00 };
+  EXPECT_EQ(0, ese_open(&ese_, NULL));
+
+  // I(0,0) [4] ->
+  //            <- I(0, 0) [2]
+  wire_.invocations.resize(1);
+  wire_.invocations[0].expected_tx =
+      Teq1TransceiveSgTest::Frame(kNode, TEQ1_I(0, 0), payload, 4);
+  wire_.invocations[0].rx = Teq1TransceiveSgTest::Frame(kHost, TEQ1_I(0, 0), kOk, 2);
+  uint8_t reply[5];
+  EXPECT_EQ(2, ese_transceive(&ese_, payload, sizeof(payload), reply, sizeof(reply)));
+
+  struct Teq1TraceRecord records[2];
+  ASSERT_EQ(2U, teq1_trace_snapshot(records, 2));
+  EXPECT_EQ(kTeq1TraceTransmit, records[0].direction);
+  EXPECT_EQ(TEQ1_I(0, 0), records[0].pcb);
+  EXPECT_EQ(4, records[0].len);
+  EXPECT_EQ(TEQ1_TRACE_RULE_NONE, records[0].rule);
+  EXPECT_EQ(0, memcmp(payload, records[0].inf, sizeof(payload)));
+  EXPECT_EQ(kTeq1TraceReceive, records[1].direction);
+  EXPECT_EQ(TEQ1_I(0, 0), records[1].pcb);
+  EXPECT_EQ(2, records[1].len);
+  EXPECT_EQ(kRuleResultComplete, records[1].rule);
+  EXPECT_EQ(0x90, records[1].inf[0]);
+  EXPECT_EQ(records[0].seq + 1, records[1].seq);
+  EXPECT_LE(records[0].usec, records[1].usec);
+
+  // The export is sized for every record held and starts with its header.
+  const uint32_t needed = teq1_trace_export(NULL, 0);
+  ASSERT_GE(needed, TEQ1_TRACE_EXPORT_HEADER_SIZE + 2U * TEQ1_TRACE_EXPORT_RECORD_SIZE);
+  std::vector<uint8_t> exported(needed);
+  const uint32_t written = teq1_trace_export(exported.data(), exported.size());
+  ASSERT_LE(written, needed);
+  EXPECT_EQ(0, memcmp("T1TR", exported.data(), 4));
+  EXPECT_EQ(TEQ1_TRACE_EXPORT_VERSION, exported[4]);
+  EXPECT_EQ(TEQ1_TRACE_EXPORT_RECORD_SIZE, exported[5]);
+  const uint32_t count = exported[6] | (exported[7] << 8);
+  EXPECT_EQ(written, TEQ1_TRACE_EXPORT_HEADER_SIZE + count * TEQ1_TRACE_EXPORT_RECORD_SIZE);
+  // The last record is the reply.
+  const uint8_t *last = &exported[written - TEQ1_TRACE_EXPORT_RECORD_SIZE];
+  EXPECT_EQ(kTeq1TraceReceive, last[12]);
+  EXPECT_EQ(TEQ1_I(0, 0), last[13]);
+  EXPECT_EQ(2, last[14]);
+};
@@ -99,6 +99,7 @@ ESE_API int ese_transceive_sg(struct EseInterface *ese,
                               uint32_t tx_segs, struct EseSgBuffer *rx_bufs,
                               uint32_t rx_segs) {
   uint32_t recvd = 0;
+  uint64_t start;
   if (!ese) {
     return -1;
   }
@@ -106,7 +107,10 @@ ESE_API int ese_transceive_sg(struct EseInterface *ese,
     return -1;
   }
   if (ese->ops->transceive) {
+    start = ese_monotonic_usec();
     recvd = ese->ops->transceive(ese, tx_bufs, tx_segs, rx_bufs, rx_segs);
+    ese_stats_record(&ese->stats.transceive_latency,
+                     ese_monotonic_usec() - start);
     return ese_error(ese) ? -1 : recvd;
   }
 
@@ -114,6 +118,55 @@ ESE_API int ese_transceive_sg(struct EseInterface *ese,
   return -1;
 }
 
+ESE_API bool ese_batch_entry_stops(const struct EseBatchEntry *entry) {
+  /* A truncated response never counts as success. */
+  const bool ok = entry->rx_len >= 2 &&
+                  (uint32_t)entry->rx_len <= entry->rx_max &&
+                  entry->rx_buf[entry->rx_len - 2] == 0x90 &&
+                  entry->rx_buf[entry->rx_len - 1] == 0x00;
+  return entry->policy == kEseBatchStopUnlessOk && !ok;
+}
+
+ESE_API int ese_transceive_batch(struct EseInterface *ese,
+                                 struct EseBatchEntry *entries,
+                                 uint32_t count) {
+  uint32_t i;
+  if (!ese || (count && !entries)) {
+    return -1;
+  }
+  for (i = 0; i < count; ++i) {
+    entries[i].rx_len = -1;
+  }
+  if (ese->error.is_err) {
+    return -1;
+  }
+  if (ese->ops->transceive_batch) {
+    i = ese->ops->transceive_batch(ese, entries, count);
+    if (ese_error(ese)) {
+      ALOGE("batch entry %u failed", i ? i - 1 : 0);
+      return -1;
+    }
+    if (i < count) {
+      ALOGW("batch stopped after entry %u", i - 1);
+    }
+    return (int)i;
+  }
+  for (i = 0; i < count; ++i) {
+    struct EseBatchEntry *entry = &entries[i];
+    entry->rx_len = ese_transceive(ese, entry->tx_buf, entry->tx_len,
+                                   entry->rx_buf, entry->rx_max);
+    if (entry->rx_len < 0) {
+      ALOGE("batch entry %u failed", i);
+      return -1;
+    }
+    if (ese_batch_entry_stops(entry)) {
+      ALOGW("batch stopped after entry %u", i);
+      return (int)(i + 1);
+    }
+  }
+  return (int)count;
+}
+
 ESE_API void ese_close(struct EseInterface *ese) {
   if (!ese) {
     return;
@@ -35,51 +35,84 @@ ESE_API uint32_t ese_sg_length(const struct EseSgBuffer *bufs, uint32_t cnt) {
   return len;
 }
 
+ESE_API void ese_sg_cursor_init(struct EseSgCursor *cursor,
+                                const struct EseSgBuffer *bufs, uint32_t cnt) {
+  cursor->seg = bufs;
+  cursor->end = bufs ? bufs + cnt : bufs;
+  cursor->offset = 0;
+}
+
+/* Moves past any segments with nothing left in them. */
+static void ese_sg_cursor_settle(struct EseSgCursor *cursor) {
+  while (cursor->seg < cursor->end && cursor->offset >= cursor->seg->len) {
+    cursor->offset -= cursor->seg->len;
+    cursor->seg++;
+  }
+}
+
+ESE_API uint32_t ese_sg_cursor_next(struct EseSgCursor *cursor, uint32_t length,
+                                    struct EseSgBuffer *out) {
+  ese_sg_cursor_settle(cursor);
+  if (cursor->seg >= cursor->end) {
+    return 0;
+  }
+  out->c_base = cursor->seg->c_base + cursor->offset;
+  out->len = min_u32(length, cursor->seg->len - cursor->offset);
+  cursor->offset += out->len;
+  return out->len;
+}
+
+ESE_API uint32_t ese_sg_cursor_advance(struct EseSgCursor *cursor,
+                                       uint32_t length) {
+  return ese_sg_cursor_to_buf(cursor, length, NULL);
+}
+
+ESE_API uint32_t ese_sg_cursor_to_buf(struct EseSgCursor *cursor,
+                                      uint32_t length, uint8_t *dst) {
+  struct EseSgBuffer chunk;
+  uint32_t remaining = length;
+  while (remaining && ese_sg_cursor_next(cursor, remaining, &chunk)) {
+    if (dst) {
+      ese_memcpy(dst, chunk.c_base, chunk.len);
+      dst += chunk.len;
+    }
+    remaining -= chunk.len;
+  }
+  return length - remaining;
+}
+
+ESE_API uint32_t ese_sg_cursor_from_buf(struct EseSgCursor *cursor,
+                                        uint32_t length, const uint8_t *src) {
+  struct EseSgBuffer chunk;
+  uint32_t remaining = length;
+  while (remaining && ese_sg_cursor_next(cursor, remaining, &chunk)) {
+    ese_memcpy(chunk.base, src, chunk.len);
+    src += chunk.len;
+    remaining -= chunk.len;
+  }
+  return length - remaining;
+}
+
 ESE_API uint32_t ese_sg_to_buf(const struct EseSgBuffer *src, uint32_t src_cnt,
                                uint32_t start_at, uint32_t length,
                                uint8_t *dst) {
-  const struct EseSgBuffer *buf = src;
-  uint32_t remaining = length;
+  struct EseSgCursor cursor;
   if (!src || src_cnt == 0) {
     return 0;
   }
-  while (remaining && buf < src + src_cnt) {
-    if (start_at > buf->len) {
-      start_at -= buf->len;
-      buf++;
-      continue;
-    }
-    uint32_t copy_len = min_u32(remaining, buf->len - start_at);
-    ese_memcpy(dst, buf->c_base + start_at, copy_len);
-    dst += copy_len;
-    remaining -= copy_len;
-    start_at = 0;
-    buf++;
-  }
-  return length - remaining;
+  ese_sg_cursor_init(&cursor, src, src_cnt);
+  cursor.offset = start_at;
+  return ese_sg_cursor_to_buf(&cursor, length, dst);
 }
 
 ESE_API uint32_t ese_sg_from_buf(struct EseSgBuffer *dst, uint32_t dst_cnt,
                                  uint32_t start_at, uint32_t length,
                                  const uint8_t *src) {
-  const struct EseSgBuffer *buf = dst;
-  uint32_t remaining = length;
+  struct EseSgCursor cursor;
   if (!dst || dst_cnt == 0) {
     return 0;
   }
-
-  while (remaining && buf < dst + dst_cnt) {
-    if (start_at >= buf->len) {
-      start_at -= buf->len;
-      buf++;
-      continue;
-    }
-    uint32_t copy_len = min_u32(remaining, buf->len - start_at);
-    ese_memcpy(buf->base + start_at, src, copy_len);
-    src += copy_len;
-    remaining -= copy_len;
-    start_at = 0;
-    buf++;
-  }
-  return length - remaining;
+  ese_sg_cursor_init(&cursor, dst, dst_cnt);
+  cursor.offset = start_at;
+  return ese_sg_cursor_from_buf(&cursor, length, src);
 }
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "include/ese/ese.h"
+
+ESE_API void ese_stats_record(struct EseHistogram *hist, uint64_t usec) {
+  uint32_t bucket = 0;
+  if (usec) {
+    bucket = 64 - (uint32_t)__builtin_clzll(usec);
+    if (bucket >= ESE_STATS_HISTOGRAM_BUCKETS) {
+      bucket = ESE_STATS_HISTOGRAM_BUCKETS - 1;
+    }
+  }
+  hist->buckets[bucket]++;
+  hist->count++;
+  hist->total_usec += usec;
+  if (usec > hist->max_usec) {
+    hist->max_usec = usec > ESE_UINT32_MAX ? ESE_UINT32_MAX : (uint32_t)usec;
+  }
+}
+
+ESE_API void ese_get_stats(const struct EseInterface *ese,
+                           struct EseStats *stats) {
+  if (!ese || !stats) {
+    return;
+  }
+  ese_memcpy(stats, &ese->stats, sizeof(*stats));
+}
+
+ESE_API void ese_reset_stats(struct EseInterface *ese) {
+  if (!ese) {
+    return;
+  }
+  ese_memset(&ese->stats, 0, sizeof(ese->stats));
+}
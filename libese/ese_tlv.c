@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "include/ese/ese_tlv.h"
+
+/* Tag numbers of 31 and up continue into further bytes. */
+#define TLV_TAG_NUMBER_MASK 0x1f
+#define TLV_TAG_MORE 0x80
+#define TLV_CONSTRUCTED 0x20
+#define TLV_LENGTH_LONG 0x80
+#define TLV_MAX_TAG_BYTES 4
+#define TLV_MAX_LENGTH_BYTES 4
+#define TLV_MAX_HEADER (TLV_MAX_TAG_BYTES + 1 + TLV_MAX_LENGTH_BYTES)
+
+static inline uint32_t min_u32(uint32_t a, uint32_t b) { return a < b ? a : b; }
+
+/* Moves past any segments with nothing left in them, as
+ * ese_sg_cursor_next() does, and returns whether any are left.
+ */
+static inline bool tlv_settle(struct EseSgCursor *cursor) {
+  while (cursor->seg < cursor->end && cursor->offset >= cursor->seg->len) {
+    cursor->offset -= cursor->seg->len;
+    cursor->seg++;
+  }
+  return cursor->seg < cursor->end;
+}
+
+/* Points at |length| bytes at |cursor|: in place when they are in one
+ * segment, as is usual, or gathered into |scratch| when they are not.
+ * Returns how many there are.
+ */
+static inline uint32_t tlv_peek(const struct EseSgCursor *cursor,
+                                uint32_t length, uint8_t *scratch,
+                                const uint8_t **bytes) {
+  struct EseSgCursor copy = *cursor;
+  uint32_t n = 0;
+  if (tlv_settle(&copy) && copy.seg->len - copy.offset >= length) {
+    *bytes = copy.seg->c_base + copy.offset;
+    return length;
+  }
+  *bytes = scratch;
+  while (n < length && tlv_settle(&copy)) {
+    scratch[n++] = copy.seg->c_base[copy.offset++];
+  }
+  return n;
+}
+
+/* Parses the tag and length in the |avail| bytes at |p|. Returns their
+ * size or 0 if they are malformed or run past |avail|.
+ *
+ * Works in locals: |p| may alias |tlv|, which would otherwise be reloaded
+ * after every store.
+ */
+static inline uint32_t tlv_parse_header(const uint8_t *p, uint32_t avail,
+                                        struct EseTlv *tlv) {
+  uint32_t used = 0;
+  uint32_t tag;
+  uint32_t length;
+  uint32_t count;
+  if (avail == 0) {
+    return 0;
+  }
+  tag = p[used++];
+  if ((tag & TLV_TAG_NUMBER_MASK) == TLV_TAG_NUMBER_MASK) {
+    do {
+      if (used == TLV_MAX_TAG_BYTES || used == avail) {
+        return 0;
+      }
+      tag = (tag << 8) | p[used];
+    } while (p[used++] & TLV_TAG_MORE);
+  }
+
+  if (used == avail) {
+    return 0;
+  }
+  length = p[used++];
+  if (length & TLV_LENGTH_LONG) {
+    count = length & ~TLV_LENGTH_LONG;
+    /* The indefinite form (0x80) has no place in a buffer of known size. */
+    if (count == 0 || count > TLV_MAX_LENGTH_BYTES || count > avail - used) {
+      return 0;
+    }
+    length = 0;
+    while (count--) {
+      length = (length << 8) | p[used++];
+    }
+  }
+  tlv->tag = tag;
+  tlv->length = length;
+  /* The constructed bit is in the first tag byte. */
+  tlv->constructed = (p[0] & TLV_CONSTRUCTED) != 0;
+  return used;
+}
+
+ESE_API void ese_tlv_reader_init(struct EseTlvReader *reader,
+                                 const struct EseSgBuffer *bufs,
+                                 uint32_t cnt) {
+  ese_sg_cursor_init(&reader->cursor, bufs, cnt);
+  reader->remaining = ese_sg_length(bufs, cnt);
+}
+
+ESE_API enum EseTlvResult ese_tlv_next(struct EseTlvReader *reader,
+                                       struct EseTlv *tlv) {
+  struct EseSgCursor *cursor = &reader->cursor;
+  uint8_t scratch[TLV_MAX_HEADER];
+  const uint8_t *header;
+  uint32_t avail;
+  uint32_t used;
+  if (reader->remaining == 0) {
+    return kEseTlvEnd;
+  }
+  if (!tlv_settle(cursor)) {
+    return kEseTlvMalformed;
+  }
+  avail = min_u32(TLV_MAX_HEADER, reader->remaining);
+  if (cursor->seg->len - cursor->offset >= avail) {
+    header = cursor->seg->c_base + cursor->offset;
+  } else {
+    avail = tlv_peek(cursor, avail, scratch, &header);
+  }
+  used = tlv_parse_header(header, avail, tlv);
+  if (used == 0 || tlv->length > reader->remaining - used) {
+    return kEseTlvMalformed;
+  }
+  reader->remaining -= used + tlv->length;
+  /* An offset past the end of its segment is settled when it is next
+   * used, so skipping a value never walks the segments itself.
+   */
+  tlv->value = *cursor;
+  tlv->value.offset += used;
+  cursor->offset += used + tlv->length;
+  return kEseTlvOk;
+}
+
+ESE_API enum EseTlvResult ese_tlv_find(struct EseTlvReader *reader,
+                                       uint32_t tag, struct EseTlv *tlv) {
+  enum EseTlvResult res;
+  while ((res = ese_tlv_next(reader, tlv)) == kEseTlvOk) {
+    if (tlv->tag == tag) {
+      return kEseTlvOk;
+    }
+  }
+  return res;
+}
+
+ESE_API void ese_tlv_children(const struct EseTlv *tlv,
+                              struct EseTlvReader *children) {
+  children->cursor = tlv->value;
+  children->remaining = tlv->length;
+}
+
+ESE_API uint32_t ese_tlv_value_to_buf(const struct EseTlv *tlv, uint32_t max,
+                                      uint8_t *dst) {
+  struct EseSgCursor cursor = tlv->value;
+  return ese_sg_cursor_to_buf(&cursor, min_u32(max, tlv->length), dst);
+}
+
+ESE_API bool ese_tlv_value_u32(const struct EseTlv *tlv, uint32_t *value) {
+  uint8_t scratch[sizeof(*value)];
+  const uint8_t *bytes;
+  uint32_t i;
+  if (tlv->length == 0 || tlv->length > sizeof(*value) ||
+      tlv_peek(&tlv->value, tlv->length, scratch, &bytes) != tlv->length) {
+    return false;
+  }
+  *value = 0;
+  for (i = 0; i < tlv->length; ++i) {
+    *value = (*value << 8) | bytes[i];
+  }
+  return true;
+}
@@ -52,16 +52,41 @@ extern "C" {
  * with a filled transmit buffer with total data length and
  * an empty receive buffer and a maximum fill length.
  *
+ * A series of APDUs may be run back to back, without returning to the
+ * caller in between, with
+ *   ese_transceive_batch(my_ese, entries, count);
+ *
  * A negative return value indicates an error and a hardware
  * specific code and string may be collected with calls to
  *   ese_error_code(my_ese);
  *   ese_error_message(my_ese);
  *
+ * Counters and latency histograms for the interface may be copied out with
+ *   ese_get_stats(my_ese, &stats);
+ * and cleared with ese_reset_stats(my_ese).
+ *
  * The EseInterface is not safe for concurrent access.
  * (Patches welcome ;).
  */
 struct EseInterface;
 
+/* Whether ese_transceive_batch() may continue past an entry. */
+enum EseBatchPolicy {
+  kEseBatchContinue = 0,
+  /* Stop the batch unless the response ends in SW 90 00. */
+  kEseBatchStopUnlessOk,
+};
+
+struct EseBatchEntry {
+  const uint8_t *tx_buf;
+  uint32_t tx_len;
+  uint8_t *rx_buf;
+  uint32_t rx_max;
+  enum EseBatchPolicy policy;
+  /* Set by ese_transceive_batch(): bytes received, or -1 if not run. */
+  int rx_len;
+};
+
 #define ese_init(ese_ptr, HW_TYPE)  __ese_init(ese_ptr, HW_TYPE)
 #define ESE_DECLARE(name, HW_TYPE, ...) \
   struct EseInterface name = __ESE_INTIALIZER(HW_TYPE)
@@ -74,11 +99,24 @@ void ese_close(struct EseInterface *ese);
 int ese_transceive(struct EseInterface *ese, const uint8_t *tx_buf, uint32_t tx_len, uint8_t *rx_buf, uint32_t rx_max);
 int ese_transceive_sg(struct EseInterface *ese, const struct EseSgBuffer *tx, uint32_t tx_segs,
                       struct EseSgBuffer *rx, uint32_t rx_segs);
+/*
+ * Runs |count| entries in order on an open interface.  Returns the number of
+ * entries run, which is less than |count| if an entry's policy stopped the
+ * batch, or -1 on an interface error.  Entries which were not run have an
+ * rx_len of -1; on error, so does the entry which failed.  Hardware with a
+ * transceive_batch operation runs all of the entries in one session instead
+ * of setting up each command as ese_transceive() would.
+ */
+int ese_transceive_batch(struct EseInterface *ese, struct EseBatchEntry *entries,
+                         uint32_t count);
 
 bool ese_error(const struct EseInterface *ese);
 const char *ese_error_message(const struct EseInterface *ese);
 int ese_error_code(const struct EseInterface *ese);
 
+void ese_get_stats(const struct EseInterface *ese, struct EseStats *stats);
+void ese_reset_stats(struct EseInterface *ese);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
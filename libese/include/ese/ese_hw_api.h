@@ -18,6 +18,7 @@
 #define ESE_HW_API_H_ 1
 
 #include "ese_sg.h"
+#include "ese_stats.h"
 #include <ese/sysdeps.h>
 
 #ifdef __cplusplus
@@ -57,6 +58,18 @@ typedef uint32_t (ese_hw_receive_op_t)(struct EseInterface *, uint8_t *, uint32_
  * - uint32_t: bytes transmitted.
  */
 typedef uint32_t (ese_hw_transmit_op_t)(struct EseInterface *, const uint8_t *, uint32_t, int);
+/* ese_hw_transmit_sg_op_t: transmits a scatter-gather list over the hardware.
+ * The segments are sent back to back as if they were one buffer.
+ * Args:
+ * - struct EseInterface *: session handle.
+ * - const struct EseSgBuffer *: array of buffers to transmit.
+ * - uint32_t: number of buffers to transmit.
+ * - int: 1 or 0 indicating if it is a complete transaction.
+ *
+ * Returns:
+ * - uint32_t: bytes transmitted.
+ */
+typedef uint32_t (ese_hw_transmit_sg_op_t)(struct EseInterface *, const struct EseSgBuffer *, uint32_t, int);
 /* ese_hw_reset_op_t: resets the hardware in case of communication desynchronization.
  * Args:
  * - struct EseInterface *: session handle.
@@ -84,6 +97,24 @@ typedef int (ese_hw_reset_op_t)(struct EseInterface *);
  */
 typedef uint32_t (ese_transceive_op_t)(
   struct EseInterface *, const struct EseSgBuffer *, uint32_t, struct EseSgBuffer *, uint32_t);
+struct EseBatchEntry;
+/* ese_transceive_batch_op_t: runs a series of APDUs in one session.
+ *
+ * Exchanges each entry in order as the transceive operation would, but
+ * without redoing per-command setup between entries.  Stops after an entry
+ * which fails, with the error set and its rx_len left at -1, or one for
+ * which ese_batch_entry_stops() is true.
+ *
+ * Args:
+ * - struct EseInterface *: session handle.
+ * - struct EseBatchEntry *: entries with rx_len set to -1.
+ * - uint32_t: number of entries.
+ *
+ * Returns:
+ * - uint32_t: entries run, including one which failed.
+ */
+typedef uint32_t (ese_transceive_batch_op_t)(
+  struct EseInterface *, struct EseBatchEntry *, uint32_t);
 /* ese_poll_op_t: waits for the hardware to be ready to send data.
  *
  * Args:
@@ -124,6 +155,13 @@ typedef int (ese_open_op_t)(struct EseInterface *, void *);
  */
 typedef void (ese_close_op_t)(struct EseInterface *);
 
+/* C++ only accepts an empty braced list as zeroing every member quietly. */
+#ifdef __cplusplus
+#define __ESE_ZERO_INITIALIZER {}
+#else
+#define __ESE_ZERO_INITIALIZER { 0 }
+#endif
+
 #define __ESE_INITIALIZER(TYPE) \
 { \
   .ops = TYPE## _ops, \
@@ -133,6 +171,7 @@ typedef void (ese_close_op_t)(struct EseInterface *);
     .message = NULL, \
   }, \
   .pad =  { 0 }, \
+  .stats = __ESE_ZERO_INITIALIZER, \
 }
 
 #define __ese_init(_ptr, TYPE) {\
@@ -141,6 +180,7 @@ typedef void (ese_close_op_t)(struct EseInterface *);
   (_ptr)->error.is_err = false; \
   (_ptr)->error.code = 0; \
   (_ptr)->error.message = (const char *)NULL; \
+  ese_memset(&(_ptr)->stats, 0, sizeof((_ptr)->stats)); \
 }
 
 struct EseOperations {
@@ -172,6 +212,14 @@ struct EseOperations {
   /* Operation error messages. */
   const char **errors;
   uint32_t errors_count;
+
+  /* Optional operations are kept last, after everything a table must set. */
+  /* Optional: used to transmit a frame in pieces without copying. */
+  ese_hw_transmit_sg_op_t *hw_transmit_sg;
+  /* Optional: used by ese_transceive_batch() in place of a transceive
+   * per entry.
+   */
+  ese_transceive_batch_op_t *transceive_batch;
 };
 
 /* Maximum private stack storage on the interface instance. */
@@ -185,6 +233,8 @@ struct EseInterface {
   } error;
   /* Reserved to avoid heap allocation requirement. */
   uint8_t pad[ESE_INTERFACE_STATE_PAD];
+  /* Counters kept for ese_get_stats(). */
+  struct EseStats stats;
 };
 
 /*
@@ -193,6 +243,13 @@ struct EseInterface {
  */
 void ese_set_error(struct EseInterface *ese, int code);
 
+/*
+ * Provided by libese so that every transceive_batch operation applies an
+ * entry's policy the same way.  Returns true if the batch must stop after
+ * |entry|, whose rx_len has been set.
+ */
+bool ese_batch_entry_stops(const struct EseBatchEntry *entry);
+
 /*
  * Global error enums.
  */
@@ -41,6 +41,27 @@ uint32_t ese_sg_length(const struct EseSgBuffer *bufs, uint32_t cnt);
 uint32_t ese_sg_to_buf(const struct EseSgBuffer *src, uint32_t src_cnt, uint32_t start_at, uint32_t length, uint8_t *dst);
 uint32_t ese_sg_from_buf(struct EseSgBuffer *dst, uint32_t dst_cnt, uint32_t start_at, uint32_t length, const uint8_t *src);
 
+/*
+ * Remembers a position in a scatter-gather list so that sequential
+ * copies don't rescan the list from the start each time.
+ */
+struct EseSgCursor {
+  const struct EseSgBuffer *seg;
+  const struct EseSgBuffer *end;
+  uint32_t offset;  /* Into |seg|. */
+};
+
+#define ESE_SG_CURSOR_INIT(bufs, cnt) \
+  { .seg = (bufs), .end = (bufs) + (cnt), .offset = 0 }
+
+void ese_sg_cursor_init(struct EseSgCursor *cursor, const struct EseSgBuffer *bufs, uint32_t cnt);
+/* Each of the following moves the cursor past the bytes it returns. */
+uint32_t ese_sg_cursor_advance(struct EseSgCursor *cursor, uint32_t length);
+uint32_t ese_sg_cursor_to_buf(struct EseSgCursor *cursor, uint32_t length, uint8_t *dst);
+uint32_t ese_sg_cursor_from_buf(struct EseSgCursor *cursor, uint32_t length, const uint8_t *src);
+/* Points |out| at up to |length| contiguous bytes without copying. */
+uint32_t ese_sg_cursor_next(struct EseSgCursor *cursor, uint32_t length, struct EseSgBuffer *out);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ESE_STATS_H_
+#define ESE_STATS_H_ 1
+
+#include <ese/sysdeps.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Log2-bucketed latency histogram in microseconds.
+ * Bucket 0 holds 0us and bucket i holds [2^(i-1), 2^i) us.  The last
+ * bucket also holds everything above it.
+ */
+#define ESE_STATS_HISTOGRAM_BUCKETS 24
+struct EseHistogram {
+  uint32_t buckets[ESE_STATS_HISTOGRAM_BUCKETS];
+  uint32_t count;
+  uint32_t max_usec;
+  uint64_t total_usec;
+};
+
+/*
+ * Per-interface counters.  The wire protocol and hardware implementations
+ * update these as they go; clients read them with ese_get_stats().
+ */
+struct EseStats {
+  /* Frames and bytes on the wire, including framing. */
+  uint32_t frames_sent;
+  uint32_t frames_received;
+  uint64_t bytes_sent;
+  uint64_t bytes_received;
+  /* Protocol recovery. */
+  uint32_t frame_errors;  /* Bad LRC, malformed or missing frames. */
+  uint32_t retransmits;
+  uint32_t resyncs;
+  uint32_t session_resets;
+  uint32_t hw_resets;
+  uint32_t wtx_requests;
+  /* Hardware polling for the start of a frame. */
+  uint32_t poll_iterations;
+  uint32_t poll_timeouts;
+  /* Whole ese_transceive() calls. */
+  struct EseHistogram transceive_latency;
+  /* Time the card took to start each reply. */
+  struct EseHistogram card_latency;
+  /* Time spent moving each frame across the bus. */
+  struct EseHistogram bus_latency;
+};
+
+/* Adds |usec| to |hist|. */
+void ese_stats_record(struct EseHistogram *hist, uint64_t usec);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif  /* ESE_STATS_H_ */
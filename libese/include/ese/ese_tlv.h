@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ESE_TLV_H_
+#define ESE_TLV_H_ 1
+
+#include <ese/sysdeps.h>
+#include "ese_sg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Bounds-checked BER-TLV parsing over a scatter-gather list, as found in
+ * applet responses, cooldown replies and load script certificates.
+ *
+ * A reader walks the TLVs at one level.  Values are never copied: each TLV
+ * carries a cursor at its value, which can be copied from, read a segment
+ * at a time with ese_sg_cursor_next(), or opened with ese_tlv_children()
+ * when the TLV is constructed.  Skipping a value only moves the cursor, so
+ * seeking to a tag costs a few bytes per TLV whatever their size.
+ */
+
+enum EseTlvResult {
+  kEseTlvOk = 0,
+  /* Nothing left at this level. */
+  kEseTlvEnd,
+  /* The tag or length runs past the end, or the value does. */
+  kEseTlvMalformed,
+};
+
+struct EseTlv {
+  /* The tag bytes as they appear, e.g. 0x7f21.  At most four. */
+  uint32_t tag;
+  uint32_t length;
+  bool constructed;
+  /* At the first byte of the value. */
+  struct EseSgCursor value;
+};
+
+struct EseTlvReader {
+  struct EseSgCursor cursor;
+  /* Bytes left at this level. */
+  uint32_t remaining;
+};
+
+void ese_tlv_reader_init(struct EseTlvReader *reader,
+                         const struct EseSgBuffer *bufs, uint32_t cnt);
+/* Reads the TLV at the reader and moves the reader past it. */
+enum EseTlvResult ese_tlv_next(struct EseTlvReader *reader,
+                               struct EseTlv *tlv);
+/* Reads past TLVs at this level until one tagged |tag|. */
+enum EseTlvResult ese_tlv_find(struct EseTlvReader *reader, uint32_t tag,
+                               struct EseTlv *tlv);
+/* Points |children| at the TLVs inside |tlv|'s value. */
+void ese_tlv_children(const struct EseTlv *tlv, struct EseTlvReader *children);
+/* Copies up to |max| bytes of the value to |dst|, returning the count. */
+uint32_t ese_tlv_value_to_buf(const struct EseTlv *tlv, uint32_t max,
+                              uint8_t *dst);
+/* Reads a big-endian value of one to four bytes. */
+bool ese_tlv_value_u32(const struct EseTlv *tlv, uint32_t *value);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif  /* ESE_TLV_H_ */
@@ -83,4 +83,48 @@
 
 #endif  /* !ESE_LOG_ANDROID */
 
+/*
+ * Compile-time threshold.  Messages below ESE_LOG_LEVEL compile away: the
+ * arguments are still type checked but never evaluated.  The levels match
+ * android_LogPriority.
+ */
+#define ESE_LOG_LEVEL_VERBOSE 2
+#define ESE_LOG_LEVEL_DEBUG 3
+#define ESE_LOG_LEVEL_INFO 4
+#define ESE_LOG_LEVEL_WARN 5
+#define ESE_LOG_LEVEL_ERROR 6
+#define ESE_LOG_LEVEL_SILENT 8
+
+#if !defined(ESE_LOG_LEVEL)
+#  define ESE_LOG_LEVEL ESE_LOG_LEVEL_VERBOSE
+#endif
+
+static inline void __ese_log_discard(const char *fmt, ...)
+    __attribute__((format(printf, 1, 2)));
+static inline void __ese_log_discard(const char *fmt __attribute__((unused)),
+                                     ...) {}
+#define __ESE_LOG_DISCARD(...) \
+  do { if (0) { __ese_log_discard(__VA_ARGS__); } } while (0)
+
+#if ESE_LOG_LEVEL > ESE_LOG_LEVEL_VERBOSE
+#  undef ALOGV
+#  define ALOGV(...) __ESE_LOG_DISCARD(__VA_ARGS__)
+#endif
+#if ESE_LOG_LEVEL > ESE_LOG_LEVEL_DEBUG
+#  undef ALOGD
+#  define ALOGD(...) __ESE_LOG_DISCARD(__VA_ARGS__)
+#endif
+#if ESE_LOG_LEVEL > ESE_LOG_LEVEL_INFO
+#  undef ALOGI
+#  define ALOGI(...) __ESE_LOG_DISCARD(__VA_ARGS__)
+#endif
+#if ESE_LOG_LEVEL > ESE_LOG_LEVEL_WARN
+#  undef ALOGW
+#  define ALOGW(...) __ESE_LOG_DISCARD(__VA_ARGS__)
+#endif
+#if ESE_LOG_LEVEL > ESE_LOG_LEVEL_ERROR
+#  undef ALOGE
+#  define ALOGE(...) __ESE_LOG_DISCARD(__VA_ARGS__)
+#endif
+
 #endif  /* ESE_LOG_H_ */
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <string.h>
+
 #include <ese/ese.h>
 #include <gtest/gtest.h>
 
@@ -135,3 +137,113 @@ TEST_F(EseInterfaceTest, EseTransceiveNoOps) {
 };
 
 
+
+TEST_F(EseInterfaceTest, EseStatsHistogramBuckets) {
+  struct EseHistogram hist;
+  memset(&hist, 0, sizeof(hist));
+  ese_stats_record(&hist, 0);
+  ese_stats_record(&hist, 1);
+  ese_stats_record(&hist, 3);
+  ese_stats_record(&hist, 1000);
+  ese_stats_record(&hist, 1ULL << 40);
+  EXPECT_EQ(1U, hist.buckets[0]);
+  EXPECT_EQ(1U, hist.buckets[1]);
+  EXPECT_EQ(1U, hist.buckets[2]);
+  EXPECT_EQ(1U, hist.buckets[10]);  /* [512, 1024) */
+  EXPECT_EQ(1U, hist.buckets[ESE_STATS_HISTOGRAM_BUCKETS - 1]);
+  EXPECT_EQ(5U, hist.count);
+  EXPECT_EQ(ESE_UINT32_MAX, hist.max_usec);
+};
+
+TEST_F(EseInterfaceTest, EseStatsTransceive) {
+  struct EseStats stats;
+  EXPECT_EQ(0, ese_open(&ese_, NULL));
+  /* Failed exchanges are timed too. */
+  EXPECT_EQ(-1, ese_transceive(&ese_, NULL, 0, NULL, 0));
+  ese_get_stats(&ese_, &stats);
+  EXPECT_EQ(1U, stats.transceive_latency.count);
+  ese_reset_stats(&ese_);
+  ese_get_stats(&ese_, &stats);
+  EXPECT_EQ(0U, stats.transceive_latency.count);
+};
+
+/* Answers each APDU with a status word of its P1 P2. */
+static uint32_t BatchTransceive(struct EseInterface *, const struct EseSgBuffer *tx,
+                                uint32_t, struct EseSgBuffer *rx, uint32_t) {
+  rx[0].base[0] = tx[0].c_base[2];
+  rx[0].base[1] = tx[0].c_base[3];
+  return 2;
+}
+
+TEST_F(EseInterfaceTest, EseTransceiveBatch) {
+  struct EseOperations batch_ops = *ESE_HW_FAKE_ops;
+  batch_ops.transceive = &BatchTransceive;
+  struct EseInterface ese = ESE_INITIALIZER(ESE_HW_FAKE);
+  ese.ops = &batch_ops;
+  const uint8_t kOk[] = { 0x80, 0xca, 0x90, 0x00, 0x00 };
+  const uint8_t kFail[] = { 0x80, 0xca, 0x6a, 0x82, 0x00 };
+  uint8_t rx[4][2];
+  struct EseBatchEntry entries[4] = {
+    { kOk, sizeof(kOk), rx[0], 2, kEseBatchStopUnlessOk, 0 },
+    { kFail, sizeof(kFail), rx[1], 2, kEseBatchContinue, 0 },
+    { kFail, sizeof(kFail), rx[2], 2, kEseBatchStopUnlessOk, 0 },
+    { kOk, sizeof(kOk), rx[3], 2, kEseBatchContinue, 0 },
+  };
+  EXPECT_EQ(0, ese_open(&ese, NULL));
+  EXPECT_EQ(3, ese_transceive_batch(&ese, entries, 4));
+  EXPECT_EQ(2, entries[0].rx_len);
+  EXPECT_EQ(2, entries[1].rx_len);
+  EXPECT_EQ(2, entries[2].rx_len);
+  EXPECT_EQ(-1, entries[3].rx_len);
+  EXPECT_EQ(0x6a, rx[2][0]);
+  EXPECT_EQ(2, ese_transceive_batch(&ese, entries, 2));
+  EXPECT_EQ(-1, ese_transceive_batch(NULL, entries, 2));
+
+  /* An interface error stops the batch. */
+  batch_ops.transceive = NULL;
+  EXPECT_EQ(-1, ese_transceive_batch(&ese, entries, 2));
+  EXPECT_EQ(-1, entries[0].rx_len);
+  EXPECT_EQ(-1, entries[1].rx_len);
+  ese_close(&ese);
+};
+
+/* Runs entries until the first one with a status word of 6A 82. */
+static uint32_t BatchOp(struct EseInterface *, struct EseBatchEntry *entries,
+                        uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    entries[i].rx_buf[0] = entries[i].tx_buf[2];
+    entries[i].rx_buf[1] = entries[i].tx_buf[3];
+    entries[i].rx_len = 2;
+    if (ese_batch_entry_stops(&entries[i])) {
+      return i + 1;
+    }
+  }
+  return count;
+}
+
+TEST_F(EseInterfaceTest, EseTransceiveBatchOp) {
+  struct EseOperations batch_ops = *ESE_HW_FAKE_ops;
+  batch_ops.transceive = NULL;
+  batch_ops.transceive_batch = &BatchOp;
+  struct EseInterface ese = ESE_INITIALIZER(ESE_HW_FAKE);
+  ese.ops = &batch_ops;
+  const uint8_t kOk[] = { 0x80, 0xca, 0x90, 0x00, 0x00 };
+  const uint8_t kFail[] = { 0x80, 0xca, 0x6a, 0x82, 0x00 };
+  uint8_t rx[3][2];
+  struct EseBatchEntry entries[3] = {
+    { kOk, sizeof(kOk), rx[0], 2, kEseBatchStopUnlessOk, 0 },
+    { kFail, sizeof(kFail), rx[1], 2, kEseBatchStopUnlessOk, 0 },
+    { kOk, sizeof(kOk), rx[2], 2, kEseBatchContinue, 0 },
+  };
+  EXPECT_EQ(0, ese_open(&ese, NULL));
+  /* The operation replaces the per-entry transceive. */
+  EXPECT_EQ(2, ese_transceive_batch(&ese, entries, 3));
+  EXPECT_EQ(2, entries[1].rx_len);
+  EXPECT_EQ(-1, entries[2].rx_len);
+
+  /* A pending error stops the batch before it starts. */
+  ese_set_error(&ese, kEseGlobalErrorNoTransceive);
+  EXPECT_EQ(-1, ese_transceive_batch(&ese, entries, 3));
+  EXPECT_EQ(-1, entries[0].rx_len);
+  ese_close(&ese);
+};
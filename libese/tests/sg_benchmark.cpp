@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Drains a scatter-gather list in T=1 sized pieces, once by offset as
+ * teq1 used to and once with a cursor.  Args are the segment count and
+ * the total size.
+ */
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <ese/ese_sg.h>
+
+static const uint32_t kFrameSize = 254;
+
+class SgList {
+ public:
+  SgList(uint32_t segments, uint32_t total) : data_(total), sg_(segments) {
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < segments; ++i) {
+      const uint32_t len = total / segments + (i < total % segments ? 1 : 0);
+      sg_[i].base = data_.data() + offset;
+      sg_[i].len = len;
+      offset += len;
+    }
+  }
+  const struct EseSgBuffer *sg() const { return sg_.data(); }
+  uint32_t count() const { return sg_.size(); }
+  uint32_t total() const { return data_.size(); }
+
+ private:
+  std::vector<uint8_t> data_;
+  std::vector<struct EseSgBuffer> sg_;
+};
+
+static void BM_SgOffsetCopy(benchmark::State& state) {
+  const SgList list(state.range(0), state.range(1));
+  uint8_t frame[kFrameSize];
+  for (auto _ : state) {
+    uint32_t offset = 0;
+    while (offset < list.total()) {
+      offset += ese_sg_to_buf(list.sg(), list.count(), offset, sizeof(frame),
+                              frame);
+    }
+    benchmark::DoNotOptimize(frame);
+  }
+  state.SetBytesProcessed(state.iterations() * list.total());
+}
+BENCHMARK(BM_SgOffsetCopy)->ArgsProduct({{1, 16, 256}, {4096, 65536}});
+
+static void BM_SgCursorCopy(benchmark::State& state) {
+  const SgList list(state.range(0), state.range(1));
+  uint8_t frame[kFrameSize];
+  for (auto _ : state) {
+    struct EseSgCursor cursor;
+    ese_sg_cursor_init(&cursor, list.sg(), list.count());
+    while (ese_sg_cursor_to_buf(&cursor, sizeof(frame), frame)) {
+    }
+    benchmark::DoNotOptimize(frame);
+  }
+  state.SetBytesProcessed(state.iterations() * list.total());
+}
+BENCHMARK(BM_SgCursorCopy)->ArgsProduct({{1, 16, 256}, {4096, 65536}});
+
+BENCHMARK_MAIN();
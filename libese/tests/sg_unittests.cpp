@@ -127,3 +127,53 @@ TEST_F(ScatterGatherTest, ThreeFromBuf) {
   EXPECT_STREQ(reinterpret_cast<char *>(three), "HELLO");
 }
 
+
+TEST_F(ScatterGatherTest, CursorWalksSegments) {
+  uint8_t one[] = {'H', 'E', 'L'};
+  uint8_t two[1];
+  uint8_t three[] = {'L', 'O', ' '};
+  uint8_t four[] = "WORLD";
+  struct EseSgBuffer sg[] = {
+    { .base = one, .len = sizeof(one), },
+    { .base = two, .len = 0, },
+    { .base = three, .len = sizeof(three), },
+    { .base = four, .len = sizeof(four), },
+  };
+  struct EseSgCursor cursor;
+  uint8_t dst[256];
+  ese_sg_cursor_init(&cursor, sg, 4);
+  EXPECT_EQ(2U, ese_sg_cursor_to_buf(&cursor, 2, dst));
+  EXPECT_EQ(0, memcmp(dst, "HE", 2));
+  EXPECT_EQ(3U, ese_sg_cursor_advance(&cursor, 3));
+  // Contiguous chunks stop at segment boundaries.
+  struct EseSgBuffer chunk;
+  EXPECT_EQ(1U, ese_sg_cursor_next(&cursor, 10, &chunk));
+  EXPECT_EQ(&three[2], chunk.c_base);
+  EXPECT_EQ(4U, ese_sg_cursor_next(&cursor, 4, &chunk));
+  EXPECT_EQ(0, memcmp(chunk.c_base, "WORL", 4));
+  // Only what's left is returned.
+  EXPECT_EQ(2U, ese_sg_cursor_to_buf(&cursor, sizeof(dst), dst));
+  EXPECT_STREQ(reinterpret_cast<char *>(dst), "D");
+  EXPECT_EQ(0U, ese_sg_cursor_to_buf(&cursor, sizeof(dst), dst));
+}
+
+TEST_F(ScatterGatherTest, CursorFromBufMatchesOffsets) {
+  uint8_t one[3];
+  uint8_t two[3];
+  uint8_t three[6];
+  struct EseSgBuffer sg[] = {
+    { .base = one, .len = sizeof(one), },
+    { .base = two, .len = sizeof(two), },
+    { .base = three, .len = sizeof(three), },
+  };
+  const uint8_t src[] = "HELLO WORLD";
+  struct EseSgCursor cursor = ESE_SG_CURSOR_INIT(sg, 3);
+  // Filled in pieces, as a chained receive would.
+  EXPECT_EQ(4U, ese_sg_cursor_from_buf(&cursor, 4, src));
+  EXPECT_EQ(4U, ese_sg_cursor_from_buf(&cursor, 4, src + 4));
+  EXPECT_EQ(4U, ese_sg_cursor_from_buf(&cursor, 4, src + 8));
+  EXPECT_EQ(0U, ese_sg_cursor_from_buf(&cursor, 1, src));
+  EXPECT_EQ(0, memcmp(one, "HEL", 3));
+  EXPECT_EQ(0, memcmp(two, "LO ", 3));
+  EXPECT_STREQ(reinterpret_cast<char *>(three), "WORLD");
+}
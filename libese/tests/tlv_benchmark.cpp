@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Parses a PN80T cooldown reply and a load script certificate, once with
+ * the offset arithmetic the callers used before and once with ese_tlv.
+ * Then seeks a tag inside the certificate and past a whole script. The
+ * certificate and script benchmarks take the number of segments they
+ * arrive in.
+ */
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <ese/ese_tlv.h>
+
+// E5 holding the secure timer, attack counter and restricted mode penalty,
+// padded to the 32 bytes read back from the chip.
+static const uint8_t kCooldown[32] = {
+  0xe5, 0x12,
+  0xf1, 0x04, 0x00, 0x00, 0x00, 0x3c,
+  0xf2, 0x04, 0x00, 0x00, 0x00, 0x00,
+  0xf3, 0x04, 0x00, 0x00, 0x00, 0x02,
+};
+
+// 7F21 with a serial number, root and holder IDs, dates and a 128 byte
+// 5F37 signature, as at the head of each script in a load package.
+static std::vector<uint8_t> Certificate() {
+  std::vector<uint8_t> cert = {
+    0x7f, 0x21, 0x81, 0xb9,
+    0x93, 0x10, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+    0x42, 0x08, 0xa0, 0x00, 0x00, 0x03, 0x96, 0x54, 0x53, 0x00,
+    0x5f, 0x20, 0x04, 0x11, 0x22, 0x33, 0x44,
+    0x95, 0x02, 0x00, 0x80,
+    0x5f, 0x25, 0x04, 0x20, 0x17, 0x01, 0x01,
+    0x5f, 0x24, 0x04, 0x20, 0x27, 0x01, 0x01,
+    0x5f, 0x37, 0x81, 0x80,
+  };
+  cert.resize(cert.size() + 0x80, 0x5a);
+  return cert;
+}
+
+static uint32_t HandRolledCooldown(const uint8_t *rx_buf, uint32_t bytes_read) {
+  uint32_t max_wait = 0;
+  if (bytes_read >= 0x8 && rx_buf[0] == 0xe5 && rx_buf[1] == 0x12) {
+    const uint8_t *tag_ptr = &rx_buf[2];
+    while (tag_ptr < (rx_buf + bytes_read)) {
+      const uint8_t tag = *tag_ptr;
+      const uint8_t length = *(tag_ptr + 1);
+      if (length == sizeof(uint32_t)) {
+        uint32_t cooldown = (tag_ptr[2] << 24) | (tag_ptr[3] << 16) |
+                            (tag_ptr[4] << 8) | tag_ptr[5];
+        if (tag == 0xf3) {
+          cooldown *= 60;
+        }
+        if (tag >= 0xf1 && tag <= 0xf3 && cooldown > max_wait) {
+          max_wait = cooldown;
+        }
+      }
+      tag_ptr += 2 + length;
+    }
+  }
+  return max_wait;
+}
+
+static uint32_t TlvCooldown(const uint8_t *rx_buf, uint32_t bytes_read) {
+  const struct EseSgBuffer rx = {{const_cast<uint8_t *>(rx_buf)}, bytes_read};
+  struct EseTlvReader reader;
+  struct EseTlv tlv;
+  uint32_t max_wait = 0;
+  ese_tlv_reader_init(&reader, &rx, 1);
+  if (ese_tlv_next(&reader, &tlv) != kEseTlvOk || tlv.tag != 0xe5) {
+    return 0;
+  }
+  ese_tlv_children(&tlv, &reader);
+  while (ese_tlv_next(&reader, &tlv) == kEseTlvOk) {
+    uint32_t cooldown;
+    if (tlv.length != sizeof(uint32_t) || !ese_tlv_value_u32(&tlv, &cooldown)) {
+      continue;
+    }
+    if (tlv.tag == 0xf3) {
+      cooldown *= 60;
+    }
+    if (tlv.tag >= 0xf1 && tlv.tag <= 0xf3 && cooldown > max_wait) {
+      max_wait = cooldown;
+    }
+  }
+  return max_wait;
+}
+
+static void BM_CooldownHandRolled(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(HandRolledCooldown(kCooldown, sizeof(kCooldown)));
+  }
+}
+BENCHMARK(BM_CooldownHandRolled);
+
+static void BM_CooldownTlv(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(TlvCooldown(kCooldown, sizeof(kCooldown)));
+  }
+}
+BENCHMARK(BM_CooldownTlv);
+
+// A load script: the certificate, 64 commands and a trailing 61 status.
+static std::vector<uint8_t> Script() {
+  std::vector<uint8_t> script = Certificate();
+  for (int i = 0; i < 64; ++i) {
+    script.insert(script.end(), {0x40, 0x81, 0xf0});
+    script.resize(script.size() + 0xf0, static_cast<uint8_t>(i));
+  }
+  script.insert(script.end(), {0x61, 0x02, 0x90, 0x00});
+  return script;
+}
+
+static std::vector<struct EseSgBuffer> Split(const std::vector<uint8_t> &data,
+                                             uint32_t segments) {
+  std::vector<struct EseSgBuffer> sg(segments);
+  for (uint32_t i = 0; i < segments; ++i) {
+    const uint32_t start = i * data.size() / segments;
+    sg[i].c_base = data.data() + start;
+    sg[i].len = (i + 1) * data.size() / segments - start;
+  }
+  return sg;
+}
+
+// The Ala.cpp way: gather the segments into one buffer, then step over
+// each field with its length bytes. Returns the offset of |tag|'s value.
+static uint32_t HandRolledSeek(const std::vector<struct EseSgBuffer> &sg,
+                               std::vector<uint8_t> &flat, uint32_t offset,
+                               uint16_t tag) {
+  ese_sg_to_buf(sg.data(), sg.size(), 0, flat.size(), flat.data());
+  while (offset < flat.size()) {
+    const bool two_byte_tag = (flat[offset] & 0x1f) == 0x1f;
+    const uint16_t found = two_byte_tag ? (flat[offset] << 8) | flat[offset + 1]
+                                        : flat[offset];
+    offset += two_byte_tag ? 2 : 1;
+    uint32_t length = flat[offset++];
+    if (length & 0x80) {
+      uint8_t n = length & 0x7f;
+      for (length = 0; n; --n) {
+        length = (length << 8) | flat[offset++];
+      }
+    }
+    if (found == tag) {
+      return offset;
+    }
+    offset += length;
+  }
+  return offset;
+}
+
+// Finds |tag| at the top level, or inside the certificate when |nested|.
+static bool TlvSeek(const std::vector<struct EseSgBuffer> &sg, uint32_t tag,
+                    bool nested, struct EseTlv *tlv) {
+  struct EseTlvReader reader;
+  ese_tlv_reader_init(&reader, sg.data(), sg.size());
+  if (nested) {
+    if (ese_tlv_find(&reader, 0x7f21, tlv) != kEseTlvOk) {
+      return false;
+    }
+    ese_tlv_children(tlv, &reader);
+  }
+  return ese_tlv_find(&reader, tag, tlv) == kEseTlvOk;
+}
+
+// The signature inside the certificate.
+static void BM_CertificateHandRolled(benchmark::State &state) {
+  const std::vector<uint8_t> cert = Certificate();
+  const std::vector<struct EseSgBuffer> sg = Split(cert, state.range(0));
+  std::vector<uint8_t> flat(cert.size());
+  for (auto _ : state) {
+    // Past the 7F21 81 B9 header.
+    benchmark::DoNotOptimize(HandRolledSeek(sg, flat, 4, 0x5f37));
+  }
+}
+BENCHMARK(BM_CertificateHandRolled)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_CertificateTlv(benchmark::State &state) {
+  const std::vector<uint8_t> cert = Certificate();
+  const std::vector<struct EseSgBuffer> sg = Split(cert, state.range(0));
+  struct EseTlv tlv;
+  for (auto _ : state) {
+    if (!TlvSeek(sg, 0x5f37, true, &tlv)) {
+      state.SkipWithError("no signature");
+      return;
+    }
+    benchmark::DoNotOptimize(tlv.value);
+  }
+}
+BENCHMARK(BM_CertificateTlv)->Arg(1)->Arg(4)->Arg(16);
+
+// The status at the end of a 16 KiB script.
+static void BM_ScriptSeekHandRolled(benchmark::State &state) {
+  const std::vector<uint8_t> script = Script();
+  const std::vector<struct EseSgBuffer> sg = Split(script, state.range(0));
+  std::vector<uint8_t> flat(script.size());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(HandRolledSeek(sg, flat, 0, 0x61));
+  }
+}
+BENCHMARK(BM_ScriptSeekHandRolled)->Arg(1)->Arg(65);
+
+static void BM_ScriptSeekTlv(benchmark::State &state) {
+  const std::vector<uint8_t> script = Script();
+  const std::vector<struct EseSgBuffer> sg = Split(script, state.range(0));
+  struct EseTlv tlv;
+  for (auto _ : state) {
+    if (!TlvSeek(sg, 0x61, false, &tlv)) {
+      state.SkipWithError("no status");
+      return;
+    }
+    benchmark::DoNotOptimize(tlv.value);
+  }
+}
+BENCHMARK(BM_ScriptSeekTlv)->Arg(1)->Arg(65);
+
+BENCHMARK_MAIN();
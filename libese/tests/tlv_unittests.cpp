@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <ese/ese_tlv.h>
+#include <gtest/gtest.h>
+
+using ::testing::Test;
+
+namespace {
+
+/* A certificate in the shape of those in load scripts: 7F21 holding a
+ * serial number, a root ID, a holder ID, a date and a 5F37 signature long
+ * enough to need a two-byte length.
+ */
+std::vector<uint8_t> Certificate() {
+  std::vector<uint8_t> cert = {
+    0x7f, 0x21, 0x82, 0x01, 0x17,
+    0x93, 0x04, 0x01, 0x02, 0x03, 0x04,
+    0x42, 0x02, 0xaa, 0xbb,
+    0x5f, 0x20, 0x03, 0x11, 0x22, 0x33,
+    0x5f, 0x25, 0x01, 0x17,
+    0x5f, 0x37, 0x81, 0xff,
+  };
+  cert.resize(cert.size() + 0xff, 0x5a);
+  return cert;
+}
+
+/* Splits |data| into segments of |size| bytes. */
+std::vector<struct EseSgBuffer> Split(const std::vector<uint8_t> &data,
+                                      uint32_t size) {
+  std::vector<struct EseSgBuffer> sg;
+  for (uint32_t offset = 0; offset < data.size(); offset += size) {
+    struct EseSgBuffer seg;
+    seg.c_base = data.data() + offset;
+    seg.len = std::min<uint32_t>(size, data.size() - offset);
+    sg.push_back(seg);
+  }
+  return sg;
+}
+
+}  // namespace
+
+class TlvTest : public virtual Test {
+ public:
+  void Init(const std::vector<uint8_t> &data, uint32_t segment_size) {
+    sg_ = Split(data, segment_size);
+    ese_tlv_reader_init(&reader_, sg_.data(), sg_.size());
+  }
+
+  std::vector<struct EseSgBuffer> sg_;
+  struct EseTlvReader reader_;
+  struct EseTlv tlv_;
+};
+
+TEST_F(TlvTest, Primitives) {
+  const std::vector<uint8_t> data = {0x01, 0x02, 0xab, 0xcd, 0x02, 0x00,
+                                     0x03, 0x01, 0xef};
+  Init(data, data.size());
+  ASSERT_EQ(kEseTlvOk, ese_tlv_next(&reader_, &tlv_));
+  EXPECT_EQ(0x01u, tlv_.tag);
+  EXPECT_EQ(2u, tlv_.length);
+  EXPECT_FALSE(tlv_.constructed);
+  uint8_t value[4];
+  EXPECT_EQ(2u, ese_tlv_value_to_buf(&tlv_, sizeof(value), value));
+  EXPECT_EQ(0xab, value[0]);
+  EXPECT_EQ(0xcd, value[1]);
+  ASSERT_EQ(kEseTlvOk, ese_tlv_next(&reader_, &tlv_));
+  EXPECT_EQ(0x02u, tlv_.tag);
+  EXPECT_EQ(0u, tlv_.length);
+  ASSERT_EQ(kEseTlvOk, ese_tlv_next(&reader_, &tlv_));
+  uint32_t u32;
+  ASSERT_TRUE(ese_tlv_value_u32(&tlv_, &u32));
+  EXPECT_EQ(0xefu, u32);
+  EXPECT_EQ(kEseTlvEnd, ese_tlv_next(&reader_, &tlv_));
+}
+
+TEST_F(TlvTest, CertificateAcrossSegments) {
+  const std::vector<uint8_t> cert = Certificate();
+  for (uint32_t segment_size : {1u, 3u, 64u, 1024u}) {
+    Init(cert, segment_size);
+    ASSERT_EQ(kEseTlvOk, ese_tlv_next(&reader_, &tlv_));
+    EXPECT_EQ(0x7f21u, tlv_.tag);
+    EXPECT_TRUE(tlv_.constructed);
+    EXPECT_EQ(0x117u, tlv_.length);
+    EXPECT_EQ(kEseTlvEnd, ese_tlv_next(&reader_, &tlv_));
+
+    struct EseTlvReader children;
+    ese_tlv_children(&tlv_, &children);
+    const uint32_t tags[] = {0x93, 0x42, 0x5f20, 0x5f25, 0x5f37};
+    const uint32_t lengths[] = {4, 2, 3, 1, 0xff};
+    for (size_t i = 0; i < sizeof(tags) / sizeof(tags[0]); ++i) {
+      ASSERT_EQ(kEseTlvOk, ese_tlv_next(&children, &tlv_)) << segment_size;
+      EXPECT_EQ(tags[i], tlv_.tag);
+      EXPECT_EQ(lengths[i], tlv_.length);
+    }
+    EXPECT_EQ(kEseTlvEnd, ese_tlv_next(&children, &tlv_));
+  }
+}
+
+TEST_F(TlvTest, FindSkipsValues) {
+  const std::vector<uint8_t> cert = Certificate();
+  Init(cert, 7);
+  struct EseTlvReader children;
+  ASSERT_EQ(kEseTlvOk, ese_tlv_find(&reader_, 0x7f21, &tlv_));
+  ese_tlv_children(&tlv_, &children);
+  ASSERT_EQ(kEseTlvOk, ese_tlv_find(&children, 0x5f20, &tlv_));
+  uint32_t holder;
+  ASSERT_TRUE(ese_tlv_value_u32(&tlv_, &holder));
+  EXPECT_EQ(0x112233u, holder);
+  ASSERT_EQ(kEseTlvOk, ese_tlv_find(&children, 0x5f37, &tlv_));
+  struct EseSgCursor value = tlv_.value;
+  struct EseSgBuffer chunk;
+  /* The signature starts at byte 29, one into the fifth segment. */
+  EXPECT_EQ(6u, ese_sg_cursor_next(&value, tlv_.length, &chunk));
+  EXPECT_EQ(0x5a, chunk.c_base[0]);
+  /* Earlier tags are behind the reader. */
+  EXPECT_EQ(kEseTlvEnd, ese_tlv_find(&children, 0x93, &tlv_));
+}
+
+TEST_F(TlvTest, Malformed) {
+  const std::vector<std::vector<uint8_t>> bad = {
+    {0x01},                          /* No length. */
+    {0x01, 0x03, 0x00, 0x00},        /* Value past the end. */
+    {0x01, 0x80, 0x00, 0x00},        /* Indefinite length. */
+    {0x01, 0x85, 0, 0, 0, 0, 1, 0},  /* Five length bytes. */
+    {0x01, 0x82, 0x00},              /* Length past the end. */
+    {0x1f, 0x81},                    /* Tag past the end. */
+    {0x1f, 0x81, 0x82, 0x83, 0x04},  /* Five tag bytes. */
+  };
+  for (const auto &data : bad) {
+    Init(data, 1);
+    EXPECT_EQ(kEseTlvMalformed, ese_tlv_next(&reader_, &tlv_))
+        << "first byte 0x" << std::hex << int(data[1]);
+  }
+}
+
+TEST_F(TlvTest, ChildrenStayInsideTheirParent) {
+  /* The child claims three bytes but its parent only has two left. */
+  const std::vector<uint8_t> data = {0x21, 0x03, 0x01, 0x03, 0xaa,
+                                     0xbb, 0xcc};
+  Init(data, data.size());
+  ASSERT_EQ(kEseTlvOk, ese_tlv_next(&reader_, &tlv_));
+  struct EseTlvReader children;
+  ese_tlv_children(&tlv_, &children);
+  EXPECT_EQ(kEseTlvMalformed, ese_tlv_next(&children, &tlv_));
+}
+
+TEST_F(TlvTest, ValueU32) {
+  const std::vector<uint8_t> data = {0x01, 0x04, 0x00, 0x00, 0x02, 0x58,
+                                     0x02, 0x05, 1, 2, 3, 4, 5};
+  Init(data, 3);
+  uint32_t value;
+  ASSERT_EQ(kEseTlvOk, ese_tlv_next(&reader_, &tlv_));
+  ASSERT_TRUE(ese_tlv_value_u32(&tlv_, &value));
+  EXPECT_EQ(600u, value);
+  ASSERT_EQ(kEseTlvOk, ese_tlv_next(&reader_, &tlv_));
+  EXPECT_FALSE(ese_tlv_value_u32(&tlv_, &value));
+}
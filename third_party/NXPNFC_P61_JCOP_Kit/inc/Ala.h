@@ -19,6 +19,7 @@
 #define NXP_LS_AID
 #include "data_types.h"
 #include "IChannel.h"
+#include "ScriptReader.h"
 #include <stdio.h>
 
 typedef struct Ala_ChannelInfo
@@ -40,7 +41,7 @@ typedef struct Ala_TranscieveInfo
 #if(NXP_LDR_SVC_VER_2 == TRUE)
 typedef struct Ala_ImageInfo
 {
-    FILE                 *fp;
+    Script_Reader_t      script;
     int                  fls_size;
     char                 fls_path[384];
     int                  bytes_read;
@@ -61,7 +62,7 @@ typedef enum
 #else
 typedef struct Ala_ImageInfo
 {
-    FILE                 *fp;
+    Script_Reader_t      script;
     int                  fls_size;
     char                 fls_path[256];
     int                  bytes_read;
@@ -268,7 +269,7 @@ tJBL_STATUS ALA_Check_KeyIdentifier(Ala_ImageInfo_t *Os_info, tJBL_STATUS status
 #else
 tJBL_STATUS ALA_Check_KeyIdentifier(Ala_ImageInfo_t *Os_info, tJBL_STATUS status, Ala_TranscieveInfo_t *pTranscv_Info);
 #endif
-tJBL_STATUS ALA_ReadScript(Ala_ImageInfo_t *Os_info, UINT8 *read_buf);
+tJBL_STATUS ALA_ReadScript(Ala_ImageInfo_t *Os_info, UINT8 *read_buf, INT32 max);
 
 tJBL_STATUS Process_EseResponse(Ala_TranscieveInfo_t *pTranscv_Info, INT32 recv_len, Ala_ImageInfo_t *Os_info);
 
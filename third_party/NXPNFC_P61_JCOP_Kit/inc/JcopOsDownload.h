@@ -16,6 +16,7 @@
 
 #include "data_types.h"
 #include "IChannel.h"
+#include "ScriptReader.h"
 #include <stdio.h>
 
 typedef struct JcopOs_TranscieveInfo
@@ -37,7 +38,7 @@ typedef struct JcopOs_Version_Info
 }JcopOs_Version_Info_t;
 typedef struct JcopOs_ImageInfo
 {
-    FILE *fp;
+    Script_Reader_t script;
     int   fls_size;
     char  fls_path[256];
     int   index;
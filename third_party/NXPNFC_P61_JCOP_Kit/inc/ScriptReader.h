@@ -0,0 +1,97 @@
+ /*
+  * Copyright (C) 2017 The Android Open Source Project
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *      http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef SCRIPT_READER_H_
+#define SCRIPT_READER_H_
+
+#include <stddef.h>
+#include "data_types.h"
+
+/*
+ * Reads the command scripts fed to the Loader Service (ALA) and to the JCOP
+ * OS update from a memory mapping of the file.
+ *
+ * Two formats are accepted:
+ *  - text, as NXP ships them: ASCII hex, two digits per byte, with any
+ *    whitespace between bytes. Records are delimited by their own framing.
+ *  - binary, as written by jcop_script_convert: an 8 byte header
+ *    ('N' 'X' 'S' 'C', version, framing, 0, 0) then one record after another,
+ *    each a 2 byte big-endian length followed by the record's bytes.
+ *
+ * Either way the caller gets one record at a time:
+ *  - SCRIPT_FRAMING_ALA: a BER-TLV line; tag (one byte, or two when the low
+ *    five bits of the first are set), 1 to 3 length bytes, then the value.
+ *  - SCRIPT_FRAMING_APDU: a command APDU; the 4 byte header, Lc, then Lc
+ *    bytes of data. Lc 00 is followed by a 2 byte extended length.
+ */
+
+#define SCRIPT_MAGIC_0        'N'
+#define SCRIPT_MAGIC_1        'X'
+#define SCRIPT_MAGIC_2        'S'
+#define SCRIPT_MAGIC_3        'C'
+#define SCRIPT_VERSION        0x01
+#define SCRIPT_HEADER_SIZE    8
+#define SCRIPT_RECORD_MAX     0xFFFF
+/* Mapped pages are given back once this many bytes behind the reader. */
+#define SCRIPT_RELEASE_WINDOW (256 * 1024)
+
+typedef enum
+{
+    SCRIPT_FRAMING_ALA  = 0x01,
+    SCRIPT_FRAMING_APDU = 0x02
+}Script_Framing;
+
+typedef struct Script_Reader
+{
+    const UINT8 *base;
+    size_t       size;
+    bool         mapped;
+    const UINT8 *released;
+    const UINT8 *pos;
+    const UINT8 *end;
+    bool         binary;
+    UINT8        framing;
+}Script_Reader_t;
+
+/* Maps |path|. Returns STATUS_FILE_NOT_FOUND if it cannot be opened. */
+tJBL_STATUS ScriptReader_Open(Script_Reader_t *reader, const char *path);
+
+/* Reads from |len| bytes at |data|, which must outlive the reader. */
+tJBL_STATUS ScriptReader_OpenBuffer(Script_Reader_t *reader, const UINT8 *data, size_t len);
+
+void ScriptReader_Close(Script_Reader_t *reader);
+
+/* True once only trailing whitespace is left. */
+bool ScriptReader_AtEnd(const Script_Reader_t *reader);
+
+/* Bytes of the file consumed so far and in total. */
+size_t ScriptReader_Offset(const Script_Reader_t *reader);
+size_t ScriptReader_Size(const Script_Reader_t *reader);
+
+/*
+ * Copies the next record, framed as |framing|, into |buf|. Returns its
+ * length, 0 at the end of the script, or -1 if the record is malformed, is
+ * longer than |max| or the file was converted for the other framing.
+ */
+INT32 ScriptReader_Next(Script_Reader_t *reader, Script_Framing framing,
+                        UINT8 *buf, INT32 max);
+
+/*
+ * Decodes |count| bytes of hex from |*pos|, skipping whitespace between
+ * bytes, and moves |*pos| past them. Returns false on anything else.
+ */
+bool ScriptReader_DecodeHex(const UINT8 **pos, const UINT8 *end, UINT8 *out, size_t count);
+
+#endif /* SCRIPT_READER_H_ */
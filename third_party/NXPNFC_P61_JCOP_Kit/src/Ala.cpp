@@ -817,29 +817,13 @@ tJBL_STATUS ALA_loadapplet(Ala_ImageInfo_t *Os_info, tJBL_STATUS status, Ala_Tra
         ALOGE("%s: invalid parameter", fn);
         return status;
     }
-    Os_info->fp = fopen(Os_info->fls_path, "r");
-
-    if (Os_info->fp == NULL) {
-        ALOGE("Error opening OS image file <%s> for reading: %s",
-                    Os_info->fls_path, strerror(errno));
+    if(ScriptReader_Open(&Os_info->script, Os_info->fls_path) != STATUS_OK)
+    {
+        ALOGE("Error opening OS image file <%s> for reading", Os_info->fls_path);
         return status;
     }
-    wResult = fseek(Os_info->fp, 0L, SEEK_END);
-    if (wResult) {
-        ALOGE("Error seeking end OS image file %s", strerror(errno));
-        goto exit;
-    }
-    Os_info->fls_size = ftell(Os_info->fp);
+    Os_info->fls_size = ScriptReader_Size(&Os_info->script);
     ALOGE("fls_size=%d", Os_info->fls_size);
-    if (Os_info->fls_size < 0) {
-        ALOGE("Error ftelling file %s", strerror(errno));
-        goto exit;
-    }
-    wResult = fseek(Os_info->fp, 0L, SEEK_SET);
-    if (wResult) {
-        ALOGE("Error seeking start image file %s", strerror(errno));
-        goto exit;
-    }
 #if(NXP_LDR_SVC_VER_2 == TRUE)
     status = ALA_Check_KeyIdentifier(Os_info, status, pTranscv_Info,
         NULL, STATUS_FAILED, 0);
@@ -850,7 +834,7 @@ tJBL_STATUS ALA_loadapplet(Ala_ImageInfo_t *Os_info, tJBL_STATUS status, Ala_Tra
     {
         goto exit;
     }
-    while(!feof(Os_info->fp) &&
+    while(!ScriptReader_AtEnd(&Os_info->script) &&
             (Os_info->bytes_read < Os_info->fls_size))
     {
         len_byte = 0x00;
@@ -864,7 +848,7 @@ tJBL_STATUS ALA_loadapplet(Ala_ImageInfo_t *Os_info, tJBL_STATUS status, Ala_Tra
 #endif
         memset(temp_buf, 0, sizeof(temp_buf));
         ALOGE("%s; Start of line processing", fn);
-        status = ALA_ReadScript(Os_info, temp_buf);
+        status = ALA_ReadScript(Os_info, temp_buf, sizeof(temp_buf));
         if(status != STATUS_OK)
         {
             goto exit;
@@ -995,7 +979,7 @@ tJBL_STATUS ALA_loadapplet(Ala_ImageInfo_t *Os_info, tJBL_STATUS status, Ala_Tra
             else
             {
                 memset(temp_buf, 0, sizeof(temp_buf));
-                status = ALA_ReadScript(Os_info, temp_buf);
+                status = ALA_ReadScript(Os_info, temp_buf, sizeof(temp_buf));
                 if(status != STATUS_OK)
                 {
                     ALOGE("%s; Next Tag has to TAG 60 not found", fn);
@@ -1025,11 +1009,11 @@ tJBL_STATUS ALA_loadapplet(Ala_ImageInfo_t *Os_info, tJBL_STATUS status, Ala_Tra
     }
     ALA_UpdateExeStatus(LS_SUCCESS_STATUS);
 #endif
-    wResult = fclose(Os_info->fp);
+    ScriptReader_Close(&Os_info->script);
     ALOGE("%s exit;End of Load Applet; status=0x%x",fn, status);
     return status;
 exit:
-    wResult = fclose(Os_info->fp);
+    ScriptReader_Close(&Os_info->script);
 #if(NXP_LDR_SVC_VER_2 == TRUE)
     if(Os_info->bytes_wrote == 0xAA)
     {
@@ -1082,7 +1066,7 @@ tJBL_STATUS ALA_Check_KeyIdentifier(Ala_ImageInfo_t *Os_info, tJBL_STATUS status
     ALOGD("%s: enter", fn);
 
 #if(NXP_LDR_SVC_VER_2 == TRUE)
-    while(!feof(Os_info->fp) &&
+    while(!ScriptReader_AtEnd(&Os_info->script) &&
             (Os_info->bytes_read < Os_info->fls_size))
     {
         offset = 0x00;
@@ -1097,7 +1081,7 @@ tJBL_STATUS ALA_Check_KeyIdentifier(Ala_ImageInfo_t *Os_info, tJBL_STATUS status
         else
         {
             /*If the 7F21 TAG is not read: Before TAG 40*/
-            status = ALA_ReadScript(Os_info, read_buf);
+            status = ALA_ReadScript(Os_info, read_buf, sizeof(read_buf));
         }
         if(status != STATUS_OK)
             return status;
@@ -1123,12 +1107,12 @@ tJBL_STATUS ALA_Check_KeyIdentifier(Ala_ImageInfo_t *Os_info, tJBL_STATUS status
     if(certf_found == STATUS_OK)
     {
 #else
-        while(!feof(Os_info->fp))
+        while(!ScriptReader_AtEnd(&Os_info->script))
         {
 #endif
         offset  = 0x00;
         wLen    = 0;
-        status  = ALA_ReadScript(Os_info, read_buf);
+        status  = ALA_ReadScript(Os_info, read_buf, sizeof(read_buf));
         if(status != STATUS_OK)
             return status;
 #if(NXP_LDR_SVC_VER_2 == TRUE)
@@ -1297,45 +1281,32 @@ tJBL_STATUS ALA_Check_KeyIdentifier(Ala_ImageInfo_t *Os_info, tJBL_STATUS status
 **
 ** Function:        ALA_ReadScript
 **
-** Description:     Reads the current line if the script
+** Description:     Reads the next line of the script, text or binary, into
+**                  |read_buf|, which holds |max| bytes
 **
 ** Returns:         Success if ok.
 **
 *******************************************************************************/
-tJBL_STATUS ALA_ReadScript(Ala_ImageInfo_t *Os_info, UINT8 *read_buf)
+tJBL_STATUS ALA_ReadScript(Ala_ImageInfo_t *Os_info, UINT8 *read_buf, INT32 max)
 {
     static const char fn[]="ALA_ReadScript";
-    INT32 wCount, wLen, wIndex = 0;
-    UINT8 len_byte = 0;
-    int wResult = 0;
+    INT32 wLen;
     tJBL_STATUS status = STATUS_FAILED;
     INT32 lenOff = 1;
 
     ALOGD("%s: enter", fn);
 
-    for(wCount =0; (wCount < 2 && !feof(Os_info->fp)); wCount++, wIndex++)
+    wLen = ScriptReader_Next(&Os_info->script, SCRIPT_FRAMING_ALA, read_buf, max);
+    Os_info->bytes_read = ScriptReader_Offset(&Os_info->script);
+    if(wLen <= 0)
     {
-        wResult = FSCANF_BYTE(Os_info->fp,"%2X",(unsigned int*)&read_buf[wIndex]);
+        ALOGE("%s: Exit Read Script failed", fn);
+        return status;
     }
-    if(wResult == 0)
-        return STATUS_FAILED;
-
-    Os_info->bytes_read = Os_info->bytes_read + (wCount*2);
 
 #if(NXP_LDR_SVC_VER_2 == TRUE)
     if((read_buf[0]==0x7f) && (read_buf[1]==0x21))
     {
-        for(wCount =0; (wCount < 1 && !feof(Os_info->fp)); wCount++, wIndex++)
-        {
-            wResult = FSCANF_BYTE(Os_info->fp,"%2X",(unsigned int*)&read_buf[wIndex]);
-        }
-        if(wResult == 0)
-        {
-            ALOGE("%s: Exit Read Script failed in 7F21 ", fn);
-            return STATUS_FAILED;
-        }
-        /*Read_Script from wCount*2 to wCount*1 */
-        Os_info->bytes_read = Os_info->bytes_read + (wCount*2);
         lenOff = 2;
     }
     else if((read_buf[0] == 0x40)||(read_buf[0] == 0x60))
@@ -1353,86 +1324,12 @@ tJBL_STATUS ALA_ReadScript(Ala_ImageInfo_t *Os_info, UINT8 *read_buf)
     if(read_buf[lenOff] == 0x00)
     {
         ALOGE("Invalid length zero");
-        len_byte = 0x00;
         return STATUS_FAILED;
     }
-    else if((read_buf[lenOff] & 0x80) == 0x80)
-    {
-        len_byte = read_buf[lenOff] & 0x0F;
-        len_byte = len_byte +1; //1 byte added for byte 0x81
-
-        ALOGD("%s: Length byte Read from 0x80 is 0x%x ", fn, len_byte);
-
-        if(len_byte == 0x02)
-        {
-            for(wCount =0; (wCount < 1 && !feof(Os_info->fp)); wCount++, wIndex++)
-            {
-                wResult = FSCANF_BYTE(Os_info->fp,"%2X",(unsigned int*)&read_buf[wIndex]);
-            }
-            if(wResult == 0)
-            {
-                ALOGE("%s: Exit Read Script failed in length 0x02 ", fn);
-                return STATUS_FAILED;
-            }
-
-            wLen = read_buf[lenOff+1];
-            Os_info->bytes_read = Os_info->bytes_read + (wCount*2);
-            ALOGD("%s: Length of Read Script in len_byte= 0x02 is 0x%lx ", fn, wLen);
-        }
-        else if(len_byte == 0x03)
-        {
-            for(wCount =0; (wCount < 2 && !feof(Os_info->fp)); wCount++, wIndex++)
-            {
-                wResult = FSCANF_BYTE(Os_info->fp,"%2X",(unsigned int*)&read_buf[wIndex]);
-            }
-            if(wResult == 0)
-            {
-                ALOGE("%s: Exit Read Script failed in length 0x03 ", fn);
-                return STATUS_FAILED;
-            }
-
-            Os_info->bytes_read = Os_info->bytes_read + (wCount*2);
-            wLen = read_buf[lenOff+1]; //Length of the packet send to ALA
-            wLen = ((wLen << 8) | (read_buf[lenOff+2]));
-            ALOGD("%s: Length of Read Script in len_byte= 0x03 is 0x%lx ", fn, wLen);
-        }
-        else
-        {
-            /*Need to provide the support if length is more than 2 bytes*/
-            ALOGE("Length recived is greater than 3");
-            return STATUS_FAILED;
-        }
-    }
-    else
-    {
-        len_byte = 0x01;
-        wLen = read_buf[lenOff];
-        ALOGE("%s: Length of Read Script in len_byte= 0x01 is 0x%lx ", fn, wLen);
-    }
-
-
-    for(wCount =0; (wCount < wLen && !feof(Os_info->fp)); wCount++, wIndex++)
-    {
-        wResult = FSCANF_BYTE(Os_info->fp,"%2X",(unsigned int*)&read_buf[wIndex]);
-    }
-
-    if(wResult == 0)
-    {
-        ALOGE("%s: Exit Read Script failed in fscanf function ", fn);
-        return status;
-    }
-    else
-    {
-#if(NXP_LDR_SVC_VER_2 == TRUE)
-        Os_info->bytes_read = Os_info->bytes_read + (wCount*2)+1; //not sure why 2 added
-#else
-        Os_info->bytes_read = Os_info->bytes_read + (wCount*2)+2; //not sure why 2 added
-#endif
-        status = STATUS_OK;
-    }
+    status = STATUS_OK;
 
-    ALOGD("%s: exit: status=0x%x; Num of bytes read=%d and index=%ld",
-    fn, status, Os_info->bytes_read,wIndex);
+    ALOGD("%s: exit: status=0x%x; Num of bytes read=%d and len=%ld",
+    fn, status, Os_info->bytes_read, wLen);
 
     return status;
 }
@@ -437,60 +437,19 @@ tJBL_STATUS JcopOsDwnld::load_JcopOS_image(JcopOs_ImageInfo_t *Os_info, tJBL_STA
         ALOGE("%s: invalid parameter", fn);
         return status;
     }
-    Os_info->fp = fopen(Os_info->fls_path, "r+");
-
-    if (Os_info->fp == NULL) {
-        ALOGE("Error opening OS image file <%s> for reading: %s",
-                    Os_info->fls_path, strerror(errno));
-        return STATUS_FILE_NOT_FOUND;
-    }
-    wResult = fseek(Os_info->fp, 0L, SEEK_END);
-    if (wResult) {
-        ALOGE("Error seeking end OS image file %s", strerror(errno));
-        goto exit;
-    }
-    Os_info->fls_size = ftell(Os_info->fp);
-    if (Os_info->fls_size < 0) {
-        ALOGE("Error ftelling file %s", strerror(errno));
-        goto exit;
+    wResult = ScriptReader_Open(&Os_info->script, Os_info->fls_path);
+    if (wResult != STATUS_OK) {
+        ALOGE("Error opening OS image file <%s> for reading", Os_info->fls_path);
+        return wResult;
     }
-    wResult = fseek(Os_info->fp, 0L, SEEK_SET);
-    if (wResult) {
-        ALOGE("Error seeking start image file %s", strerror(errno));
-        goto exit;
-    }
-    while(!feof(Os_info->fp))
+    Os_info->fls_size = ScriptReader_Size(&Os_info->script);
+    while(!ScriptReader_AtEnd(&Os_info->script))
     {
         ALOGE("%s; Start of line processing", fn);
 
-        wIndex=0;
-        wLen=0;
-        wCount=0;
-        memset(pTranscv_Info->sSendData,0x00,JCOP_MAX_BUF_SIZE);
-        pTranscv_Info->sSendlength=0;
-
-        ALOGE("%s; wIndex = 0", fn);
-        for(wCount =0; (wCount < 5 && !feof(Os_info->fp)); wCount++, wIndex++)
-        {
-            wResult = FSCANF_BYTE(Os_info->fp,"%2X",&pTranscv_Info->sSendData[wIndex]);
-        }
-        if(wResult != 0)
-        {
-            wLen = pTranscv_Info->sSendData[4];
-            ALOGE("%s; Read 5byes success & len=%d", fn,wLen);
-            if(wLen == 0x00)
-            {
-                ALOGE("%s: Extended APDU", fn);
-                wResult = FSCANF_BYTE(Os_info->fp,"%2X",&pTranscv_Info->sSendData[wIndex++]);
-                wResult = FSCANF_BYTE(Os_info->fp,"%2X",&pTranscv_Info->sSendData[wIndex++]);
-                wLen = ((pTranscv_Info->sSendData[5] << 8) | (pTranscv_Info->sSendData[6]));
-            }
-            for(wCount =0; (wCount < wLen && !feof(Os_info->fp)); wCount++, wIndex++)
-            {
-                wResult = FSCANF_BYTE(Os_info->fp,"%2X",&pTranscv_Info->sSendData[wIndex]);
-            }
-        }
-        else
+        wIndex = ScriptReader_Next(&Os_info->script, SCRIPT_FRAMING_APDU,
+                                   pTranscv_Info->sSendData, JCOP_MAX_BUF_SIZE);
+        if(wIndex < 0)
         {
             ALOGE("%s: JcopOs image Read failed", fn);
             goto exit;
@@ -553,8 +512,8 @@ tJBL_STATUS JcopOsDwnld::load_JcopOS_image(JcopOs_ImageInfo_t *Os_info, tJBL_STA
 
 exit:
     mchannel->doeSE_JcopDownLoadReset();
-    ALOGE("%s close fp and exit; status= 0x%X", fn,status);
-    wResult = fclose(Os_info->fp);
+    ALOGE("%s close script and exit; status= 0x%X", fn,status);
+    ScriptReader_Close(&Os_info->script);
     return status;
 }
 
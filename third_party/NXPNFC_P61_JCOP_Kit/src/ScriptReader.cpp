@@ -0,0 +1,364 @@
+ /*
+  * Copyright (C) 2017 The Android Open Source Project
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *      http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <log/log.h>
+#include <ScriptReader.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Nibble value of each character; 0x80 for anything that is not hex. */
+static const UINT8 kHexValue[256] = {
+#define X 0x80
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, X, X, X, X, X, X,
+    X,10,11,12,13,14,15, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X,10,11,12,13,14,15, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+#undef X
+};
+
+/* Bytes decoded per step of the fast path; it takes twice as many digits. */
+#define HEX_BLOCK 8
+
+static inline bool isSpace(UINT8 c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline const UINT8* skipSpace(const UINT8 *pos, const UINT8 *end)
+{
+    while(pos < end && isSpace(*pos))
+        pos++;
+    return pos;
+}
+
+/*******************************************************************************
+**
+** Function:        ScriptReader_DecodeHex
+**
+** Description:     Decodes |count| bytes of ASCII hex. Runs of digits go
+**                  HEX_BLOCK bytes at a time through the lookup table with a
+**                  single validity check per block; there is no vectorized
+**                  decoder, which was dropped to keep the kit portable.
+**                  Whitespace between bytes drops to the per byte path.
+**
+** Returns:         True if all |count| bytes were decoded.
+**
+*******************************************************************************/
+bool ScriptReader_DecodeHex(const UINT8 **pos, const UINT8 *end, UINT8 *out, size_t count)
+{
+    const UINT8 *p = *pos;
+    while(count > 0)
+    {
+        if(count >= HEX_BLOCK && (size_t)(end - p) >= 2 * HEX_BLOCK)
+        {
+            UINT8 bad = 0;
+            for(int i = 0; i < HEX_BLOCK; i++)
+            {
+                UINT8 hi = kHexValue[p[2 * i]];
+                UINT8 lo = kHexValue[p[2 * i + 1]];
+                bad |= hi | lo;
+                out[i] = (UINT8)((hi << 4) | lo);
+            }
+            if(!(bad & 0x80))
+            {
+                p += 2 * HEX_BLOCK;
+                out += HEX_BLOCK;
+                count -= HEX_BLOCK;
+                continue;
+            }
+        }
+        p = skipSpace(p, end);
+        if(end - p < 2)
+            return false;
+        UINT8 hi = kHexValue[p[0]];
+        UINT8 lo = kHexValue[p[1]];
+        if((hi | lo) & 0x80)
+            return false;
+        *out++ = (UINT8)((hi << 4) | lo);
+        p += 2;
+        count--;
+    }
+    *pos = p;
+    return true;
+}
+
+static tJBL_STATUS ScriptReader_Start(Script_Reader_t *reader)
+{
+    static const char fn[] = "ScriptReader_Start";
+    const UINT8 *p = reader->base;
+    reader->pos = p;
+    reader->end = p + reader->size;
+    reader->binary = false;
+    reader->framing = 0;
+    if(reader->size >= SCRIPT_HEADER_SIZE &&
+       p[0] == SCRIPT_MAGIC_0 && p[1] == SCRIPT_MAGIC_1 &&
+       p[2] == SCRIPT_MAGIC_2 && p[3] == SCRIPT_MAGIC_3)
+    {
+        if(p[4] != SCRIPT_VERSION ||
+           (p[5] != SCRIPT_FRAMING_ALA && p[5] != SCRIPT_FRAMING_APDU))
+        {
+            ALOGE("%s: unsupported script version 0x%X framing 0x%X", fn, p[4], p[5]);
+            return STATUS_FAILED;
+        }
+        reader->binary = true;
+        reader->framing = p[5];
+        reader->pos = p + SCRIPT_HEADER_SIZE;
+    }
+    else
+    {
+        reader->pos = skipSpace(p, reader->end);
+    }
+    return STATUS_OK;
+}
+
+/*******************************************************************************
+**
+** Function:        ScriptReader_Open
+**
+** Description:     Maps the script at |path| read only and works out whether
+**                  it is text or binary.
+**
+** Returns:         STATUS_OK, STATUS_FILE_NOT_FOUND if the file cannot be
+**                  opened or STATUS_FAILED.
+**
+*******************************************************************************/
+tJBL_STATUS ScriptReader_Open(Script_Reader_t *reader, const char *path)
+{
+    static const char fn[] = "ScriptReader_Open";
+    struct stat st;
+    tJBL_STATUS status;
+
+    memset(reader, 0, sizeof(*reader));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        ALOGE("%s: Error opening script <%s> for reading: %s", fn, path, strerror(errno));
+        return STATUS_FILE_NOT_FOUND;
+    }
+    if(fstat(fd, &st) != 0)
+    {
+        ALOGE("%s: Error sizing script <%s>: %s", fn, path, strerror(errno));
+        close(fd);
+        return STATUS_FAILED;
+    }
+    if(st.st_size > 0)
+    {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED)
+        {
+            ALOGE("%s: Error mapping script <%s>: %s", fn, path, strerror(errno));
+            close(fd);
+            return STATUS_FAILED;
+        }
+        /*
+         * Read once, front to back. Keep large page cache folios mapped a
+         * page at a time, or ScriptReader_Release() cannot drop them.
+         */
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+#ifdef MADV_NOHUGEPAGE
+        madvise(map, st.st_size, MADV_NOHUGEPAGE);
+#endif
+        reader->base = (const UINT8*)map;
+        reader->size = st.st_size;
+        reader->mapped = true;
+        reader->released = reader->base;
+    }
+    close(fd);
+
+    status = ScriptReader_Start(reader);
+    if(status != STATUS_OK)
+        ScriptReader_Close(reader);
+    return status;
+}
+
+tJBL_STATUS ScriptReader_OpenBuffer(Script_Reader_t *reader, const UINT8 *data, size_t len)
+{
+    memset(reader, 0, sizeof(*reader));
+    reader->base = data;
+    reader->size = len;
+    return ScriptReader_Start(reader);
+}
+
+void ScriptReader_Close(Script_Reader_t *reader)
+{
+    if(reader->mapped)
+        munmap((void*)reader->base, reader->size);
+    memset(reader, 0, sizeof(*reader));
+}
+
+bool ScriptReader_AtEnd(const Script_Reader_t *reader)
+{
+    return reader->pos >= reader->end;
+}
+
+size_t ScriptReader_Offset(const Script_Reader_t *reader)
+{
+    return reader->pos - reader->base;
+}
+
+size_t ScriptReader_Size(const Script_Reader_t *reader)
+{
+    return reader->size;
+}
+
+/*
+ * The script is read once, so pages already consumed are dropped from the
+ * mapping rather than left to count against us until the update ends.
+ */
+static void ScriptReader_Release(Script_Reader_t *reader)
+{
+    if(!reader->mapped || reader->pos - reader->released < SCRIPT_RELEASE_WINDOW)
+        return;
+    size_t page = getpagesize();
+    const UINT8 *upto = reader->base + ((reader->pos - reader->base) & ~(page - 1));
+    madvise((void*)reader->released, upto - reader->released, MADV_DONTNEED);
+    reader->released = upto;
+}
+
+/* Frames a text record; leaves the length of its header and value. */
+static bool ScriptReader_TextHeader(const UINT8 **p, const UINT8 *end, Script_Framing framing,
+                                    UINT8 *buf, INT32 *hdr, INT32 *len)
+{
+    INT32 n = 0;
+    if(framing == SCRIPT_FRAMING_APDU)
+    {
+        if(!ScriptReader_DecodeHex(p, end, buf, 5))
+            return false;
+        n = 5;
+        *len = buf[4];
+        if(*len == 0x00)
+        {
+            if(!ScriptReader_DecodeHex(p, end, buf + n, 2))
+                return false;
+            *len = (buf[5] << 8) | buf[6];
+            n += 2;
+        }
+        *hdr = n;
+        return true;
+    }
+
+    if(!ScriptReader_DecodeHex(p, end, buf, 2))
+        return false;
+    n = 2;
+    if((buf[0] & 0x1F) == 0x1F)
+    {
+        if(!ScriptReader_DecodeHex(p, end, buf + n, 1))
+            return false;
+        n++;
+    }
+    UINT8 first = buf[n - 1];
+    if(first == 0x81 || first == 0x82)
+    {
+        INT32 extra = first & 0x0F;
+        if(!ScriptReader_DecodeHex(p, end, buf + n, extra))
+            return false;
+        *len = buf[n];
+        if(extra == 2)
+            *len = (*len << 8) | buf[n + 1];
+        n += extra;
+    }
+    else if(first & 0x80)
+    {
+        return false;
+    }
+    else
+    {
+        *len = first;
+    }
+    *hdr = n;
+    return true;
+}
+
+/*******************************************************************************
+**
+** Function:        ScriptReader_Next
+**
+** Description:     Copies the next record of the script into |buf|.
+**
+** Returns:         The record's length, 0 at the end or -1 on error.
+**
+*******************************************************************************/
+INT32 ScriptReader_Next(Script_Reader_t *reader, Script_Framing framing, UINT8 *buf, INT32 max)
+{
+    static const char fn[] = "ScriptReader_Next";
+    const UINT8 *p = reader->pos;
+    const UINT8 *end = reader->end;
+    INT32 hdr = 0, len = 0;
+
+    if(p >= end)
+        return 0;
+
+    if(reader->binary)
+    {
+        if(reader->framing != framing)
+        {
+            ALOGE("%s: script was converted for framing 0x%X, not 0x%X", fn,
+                    reader->framing, framing);
+            return -1;
+        }
+        if(end - p < 2)
+        {
+            ALOGE("%s: truncated record length", fn);
+            return -1;
+        }
+        len = (p[0] << 8) | p[1];
+        p += 2;
+        if(len == 0 || len > max || end - p < len)
+        {
+            ALOGE("%s: record of %ld bytes does not fit", fn, len);
+            return -1;
+        }
+        memcpy(buf, p, len);
+        reader->pos = p + len;
+        ScriptReader_Release(reader);
+        return len;
+    }
+
+    /* The longest header is the extended APDU's 7 bytes. */
+    if(max < 7 || !ScriptReader_TextHeader(&p, end, framing, buf, &hdr, &len))
+    {
+        ALOGE("%s: malformed record at offset %zu", fn, ScriptReader_Offset(reader));
+        return -1;
+    }
+    if(len > max - hdr)
+    {
+        ALOGE("%s: record of %ld bytes does not fit", fn, len);
+        return -1;
+    }
+    if(!ScriptReader_DecodeHex(&p, end, buf + hdr, len))
+    {
+        ALOGE("%s: truncated record at offset %zu", fn, ScriptReader_Offset(reader));
+        return -1;
+    }
+    reader->pos = skipSpace(p, end);
+    ScriptReader_Release(reader);
+    return hdr + len;
+}
@@ -0,0 +1,166 @@
+ /*
+  * Copyright (C) 2017 The Android Open Source Project
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *      http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  * Time to parse a JCOP OS update image the size NXP ships (about 1 MB of
+  * APDUs, 2 MB as text) through the fscanf() loop the loaders used to run and
+  * through ScriptReader, from text and from the converted binary.
+  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ScriptReader.h>
+
+namespace {
+
+#ifdef __ANDROID__
+const char kTmpDir[] = "/data/local/tmp";
+#else
+const char kTmpDir[] = "/tmp";
+#endif
+
+const int kApdus = 4400;
+const int kApduData = 239;
+const INT32 kBufSize = 10240;
+
+struct Image {
+    std::string text;
+    std::string binary;
+    size_t textSize = 0;
+    size_t binarySize = 0;
+
+    ~Image() {
+        if (!text.empty()) {
+            unlink(text.c_str());
+            unlink(binary.c_str());
+        }
+    }
+};
+
+std::string writeTemp(const std::string& name, const std::vector<UINT8>& bytes) {
+    std::string path = std::string(kTmpDir) + "/" + name + "XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        abort();
+    }
+    if (write(fd, bytes.data(), bytes.size()) != (ssize_t)bytes.size()) {
+        abort();
+    }
+    close(fd);
+    return path;
+}
+
+// One LOAD per line, as the update images are laid out.
+const Image& image() {
+    static Image image;
+    if (!image.text.empty()) {
+        return image;
+    }
+    static const char kHex[] = "0123456789ABCDEF";
+    std::vector<UINT8> text;
+    std::vector<UINT8> binary = {SCRIPT_MAGIC_0, SCRIPT_MAGIC_1, SCRIPT_MAGIC_2, SCRIPT_MAGIC_3,
+                                 SCRIPT_VERSION, SCRIPT_FRAMING_APDU, 0, 0};
+    for (int i = 0; i < kApdus; i++) {
+        std::vector<UINT8> apdu = {0x80, 0xE8, (UINT8)(i == kApdus - 1 ? 0x80 : 0x00),
+                                   (UINT8)i, kApduData};
+        for (int j = 0; j < kApduData; j++) {
+            apdu.push_back((UINT8)(i * 31 + j * 7));
+        }
+        for (UINT8 b : apdu) {
+            text.push_back(kHex[b >> 4]);
+            text.push_back(kHex[b & 0xF]);
+        }
+        text.push_back('\n');
+        binary.push_back((UINT8)(apdu.size() >> 8));
+        binary.push_back((UINT8)apdu.size());
+        binary.insert(binary.end(), apdu.begin(), apdu.end());
+    }
+    image.text = writeTemp("jcop_text", text);
+    image.binary = writeTemp("jcop_bin", binary);
+    image.textSize = text.size();
+    image.binarySize = binary.size();
+    return image;
+}
+
+// The loop load_JcopOS_image() used to run: one fscanf("%2X") per byte.
+void BM_ParseFscanf(benchmark::State& state) {
+    const Image& img = image();
+    std::vector<UINT8> buf(kBufSize);
+    for (auto _ : state) {
+        FILE* fp = fopen(img.text.c_str(), "r");
+        int apdus = 0;
+        while (!feof(fp)) {
+            unsigned int v = 0;
+            int n = 0;
+            for (int i = 0; i < 5 && fscanf(fp, "%2X", &v) == 1; i++) {
+                buf[n++] = (UINT8)v;
+            }
+            if (n < 5) {
+                break;
+            }
+            for (int i = 0; i < buf[4] && fscanf(fp, "%2X", &v) == 1; i++) {
+                buf[n++] = (UINT8)v;
+            }
+            apdus++;
+        }
+        fclose(fp);
+        if (apdus != kApdus) {
+            state.SkipWithError("wrong number of APDUs");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * img.textSize);
+}
+BENCHMARK(BM_ParseFscanf)->Unit(benchmark::kMillisecond);
+
+void parse(benchmark::State& state, const std::string& path, size_t size) {
+    std::vector<UINT8> buf(kBufSize);
+    for (auto _ : state) {
+        Script_Reader_t reader;
+        if (ScriptReader_Open(&reader, path.c_str()) != STATUS_OK) {
+            state.SkipWithError("unable to open the script");
+            break;
+        }
+        int apdus = 0;
+        while (ScriptReader_Next(&reader, SCRIPT_FRAMING_APDU, buf.data(), kBufSize) > 0) {
+            apdus++;
+        }
+        ScriptReader_Close(&reader);
+        if (apdus != kApdus) {
+            state.SkipWithError("wrong number of APDUs");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+void BM_ParseText(benchmark::State& state) {
+    parse(state, image().text, image().textSize);
+}
+BENCHMARK(BM_ParseText)->Unit(benchmark::kMillisecond);
+
+void BM_ParseBinary(benchmark::State& state) {
+    parse(state, image().binary, image().binarySize);
+}
+BENCHMARK(BM_ParseBinary)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,306 @@
+ /*
+  * Copyright (C) 2017 The Android Open Source Project
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *      http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ScriptReader.h>
+
+namespace {
+
+#ifdef __ANDROID__
+const char kTmpDir[] = "/data/local/tmp";
+#else
+const char kTmpDir[] = "/tmp";
+#endif
+
+// The size of the buffers Ala.cpp reads Loader Service records into.
+const INT32 kAlaBufSize = 1024;
+
+std::vector<UINT8> bytes(const std::string& s) {
+    return std::vector<UINT8>(s.begin(), s.end());
+}
+
+std::vector<UINT8> binaryHeader(UINT8 framing) {
+    return {SCRIPT_MAGIC_0, SCRIPT_MAGIC_1, SCRIPT_MAGIC_2, SCRIPT_MAGIC_3,
+            SCRIPT_VERSION, framing, 0, 0};
+}
+
+void appendRecord(std::vector<UINT8>* script, const std::vector<UINT8>& record) {
+    script->push_back((UINT8)(record.size() >> 8));
+    script->push_back((UINT8)record.size());
+    script->insert(script->end(), record.begin(), record.end());
+}
+
+std::string hex(const std::vector<UINT8>& data) {
+    static const char kHex[] = "0123456789ABCDEF";
+    std::string out;
+    for (UINT8 b : data) {
+        out.push_back(kHex[b >> 4]);
+        out.push_back(kHex[b & 0xF]);
+    }
+    return out;
+}
+
+class ScriptReaderTest : public ::testing::Test {
+protected:
+    void TearDown() override { ScriptReader_Close(&reader_); }
+
+    tJBL_STATUS open(const std::vector<UINT8>& script) {
+        script_ = script;
+        return ScriptReader_OpenBuffer(&reader_, script_.data(), script_.size());
+    }
+
+    // Reads the next record into |record_|, returning ScriptReader_Next()'s result.
+    INT32 next(Script_Framing framing, INT32 max = kAlaBufSize) {
+        record_.assign(max, 0);
+        INT32 len = ScriptReader_Next(&reader_, framing, record_.data(), max);
+        record_.resize(len > 0 ? len : 0);
+        return len;
+    }
+
+    std::vector<UINT8> script_;
+    std::vector<UINT8> record_;
+    Script_Reader_t reader_;
+};
+
+/* Text */
+
+TEST_F(ScriptReaderTest, textAlaRecords) {
+    // One byte tag, two byte tag, then the 0x81 and 0x82 long lengths.
+    ASSERT_EQ(STATUS_OK, open(bytes("40 02 AB CD\n"
+                                    "7F21 03 010203\n"
+                                    "61 81 01 EE\n"
+                                    "60820002FFFF\n")));
+    EXPECT_FALSE(reader_.binary);
+    ASSERT_EQ(4, next(SCRIPT_FRAMING_ALA));
+    EXPECT_EQ((std::vector<UINT8>{0x40, 0x02, 0xAB, 0xCD}), record_);
+    ASSERT_EQ(6, next(SCRIPT_FRAMING_ALA));
+    EXPECT_EQ((std::vector<UINT8>{0x7F, 0x21, 0x03, 0x01, 0x02, 0x03}), record_);
+    ASSERT_EQ(4, next(SCRIPT_FRAMING_ALA));
+    EXPECT_EQ((std::vector<UINT8>{0x61, 0x81, 0x01, 0xEE}), record_);
+    ASSERT_EQ(6, next(SCRIPT_FRAMING_ALA));
+    EXPECT_EQ((std::vector<UINT8>{0x60, 0x82, 0x00, 0x02, 0xFF, 0xFF}), record_);
+    EXPECT_TRUE(ScriptReader_AtEnd(&reader_));
+    EXPECT_EQ(0, next(SCRIPT_FRAMING_ALA));
+    EXPECT_EQ(script_.size(), ScriptReader_Offset(&reader_));
+}
+
+TEST_F(ScriptReaderTest, textApduRecords) {
+    // A short APDU, then one with an extended Lc.
+    ASSERT_EQ(STATUS_OK, open(bytes("80E8000003 0a0b0c\n"
+                                    "80E80080 00 0002 1122\n")));
+    ASSERT_EQ(8, next(SCRIPT_FRAMING_APDU));
+    EXPECT_EQ((std::vector<UINT8>{0x80, 0xE8, 0x00, 0x00, 0x03, 0x0A, 0x0B, 0x0C}), record_);
+    ASSERT_EQ(9, next(SCRIPT_FRAMING_APDU));
+    EXPECT_EQ((std::vector<UINT8>{0x80, 0xE8, 0x00, 0x80, 0x00, 0x00, 0x02, 0x11, 0x22}),
+              record_);
+    EXPECT_EQ(0, next(SCRIPT_FRAMING_APDU));
+}
+
+TEST_F(ScriptReaderTest, textLongRecordTakesTheFastPath) {
+    std::vector<UINT8> apdu = {0x80, 0xE8, 0x00, 0x00, 200};
+    for (int i = 0; i < 200; i++) {
+        apdu.push_back((UINT8)(i * 7));
+    }
+    ASSERT_EQ(STATUS_OK, open(bytes(hex(apdu) + "\n")));
+    ASSERT_EQ((INT32)apdu.size(), next(SCRIPT_FRAMING_APDU));
+    EXPECT_EQ(apdu, record_);
+}
+
+TEST_F(ScriptReaderTest, textWithCrlf) {
+    ASSERT_EQ(STATUS_OK, open(bytes("\r\n40 02 AB CD\r\n"
+                                    "41 01 EF\r\n\r\n")));
+    ASSERT_EQ(4, next(SCRIPT_FRAMING_ALA));
+    EXPECT_EQ((std::vector<UINT8>{0x40, 0x02, 0xAB, 0xCD}), record_);
+    ASSERT_EQ(3, next(SCRIPT_FRAMING_ALA));
+    EXPECT_EQ((std::vector<UINT8>{0x41, 0x01, 0xEF}), record_);
+    EXPECT_TRUE(ScriptReader_AtEnd(&reader_));
+    EXPECT_EQ(0, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, textTruncatedValue) {
+    ASSERT_EQ(STATUS_OK, open(bytes("40 04 AB CD\n")));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, textTruncatedHeader) {
+    ASSERT_EQ(STATUS_OK, open(bytes("80E800")));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_APDU));
+}
+
+TEST_F(ScriptReaderTest, textOddDigit) {
+    ASSERT_EQ(STATUS_OK, open(bytes("40 02 AB C\n")));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, textNotHex) {
+    ASSERT_EQ(STATUS_OK, open(bytes("40 02 AB XY\n")));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, textMalformedLength) {
+    // 0x83 is not a length this reader accepts.
+    ASSERT_EQ(STATUS_OK, open(bytes("40 83 000001 AB\n")));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, textRecordLargerThanAlaBuffer) {
+    std::vector<UINT8> record = {0x40, 0x82, 0x04, 0x4C};
+    record.resize(record.size() + 1100, 0x5A);
+    ASSERT_EQ(STATUS_OK, open(bytes(hex(record))));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, textRecordFillingAlaBuffer) {
+    std::vector<UINT8> record = {0x40, 0x82, 0x03, 0xFC};
+    record.resize(kAlaBufSize, 0x5A);
+    ASSERT_EQ(STATUS_OK, open(bytes(hex(record))));
+    ASSERT_EQ(kAlaBufSize, next(SCRIPT_FRAMING_ALA));
+    EXPECT_EQ(record, record_);
+}
+
+TEST_F(ScriptReaderTest, textBufferTooSmallForAHeader) {
+    ASSERT_EQ(STATUS_OK, open(bytes("40 02 AB CD\n")));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA, 6));
+}
+
+TEST_F(ScriptReaderTest, emptyScript) {
+    ASSERT_EQ(STATUS_OK, open(bytes(" \r\n")));
+    EXPECT_TRUE(ScriptReader_AtEnd(&reader_));
+    EXPECT_EQ(0, next(SCRIPT_FRAMING_ALA));
+}
+
+/* Binary */
+
+TEST_F(ScriptReaderTest, binaryAlaRecords) {
+    std::vector<UINT8> script = binaryHeader(SCRIPT_FRAMING_ALA);
+    appendRecord(&script, {0x40, 0x02, 0xAB, 0xCD});
+    appendRecord(&script, {0x7F, 0x21, 0x01, 0x00});
+    ASSERT_EQ(STATUS_OK, open(script));
+    EXPECT_TRUE(reader_.binary);
+    ASSERT_EQ(4, next(SCRIPT_FRAMING_ALA));
+    EXPECT_EQ((std::vector<UINT8>{0x40, 0x02, 0xAB, 0xCD}), record_);
+    ASSERT_EQ(4, next(SCRIPT_FRAMING_ALA));
+    EXPECT_EQ((std::vector<UINT8>{0x7F, 0x21, 0x01, 0x00}), record_);
+    EXPECT_TRUE(ScriptReader_AtEnd(&reader_));
+    EXPECT_EQ(0, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, binaryApduRecords) {
+    std::vector<UINT8> script = binaryHeader(SCRIPT_FRAMING_APDU);
+    appendRecord(&script, {0x80, 0xE8, 0x00, 0x00, 0x01, 0x0A});
+    ASSERT_EQ(STATUS_OK, open(script));
+    ASSERT_EQ(6, next(SCRIPT_FRAMING_APDU));
+    EXPECT_EQ((std::vector<UINT8>{0x80, 0xE8, 0x00, 0x00, 0x01, 0x0A}), record_);
+    EXPECT_EQ(0, next(SCRIPT_FRAMING_APDU));
+}
+
+TEST_F(ScriptReaderTest, binaryUnsupportedVersion) {
+    std::vector<UINT8> script = binaryHeader(SCRIPT_FRAMING_ALA);
+    script[4] = SCRIPT_VERSION + 1;
+    appendRecord(&script, {0x40, 0x00});
+    EXPECT_EQ(STATUS_FAILED, open(script));
+}
+
+TEST_F(ScriptReaderTest, binaryUnknownFraming) {
+    std::vector<UINT8> script = binaryHeader(0x03);
+    appendRecord(&script, {0x40, 0x00});
+    EXPECT_EQ(STATUS_FAILED, open(script));
+}
+
+TEST_F(ScriptReaderTest, binaryConvertedForTheOtherFraming) {
+    std::vector<UINT8> script = binaryHeader(SCRIPT_FRAMING_APDU);
+    appendRecord(&script, {0x80, 0xE8, 0x00, 0x00, 0x00});
+    ASSERT_EQ(STATUS_OK, open(script));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, binaryTruncatedLength) {
+    std::vector<UINT8> script = binaryHeader(SCRIPT_FRAMING_ALA);
+    script.push_back(0x00);
+    ASSERT_EQ(STATUS_OK, open(script));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, binaryTruncatedRecord) {
+    std::vector<UINT8> script = binaryHeader(SCRIPT_FRAMING_ALA);
+    appendRecord(&script, {0x40, 0x02, 0xAB, 0xCD});
+    script.pop_back();
+    ASSERT_EQ(STATUS_OK, open(script));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, binaryEmptyRecord) {
+    std::vector<UINT8> script = binaryHeader(SCRIPT_FRAMING_ALA);
+    appendRecord(&script, {});
+    ASSERT_EQ(STATUS_OK, open(script));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, binaryRecordLargerThanAlaBuffer) {
+    std::vector<UINT8> script = binaryHeader(SCRIPT_FRAMING_ALA);
+    appendRecord(&script, std::vector<UINT8>(kAlaBufSize + 1, 0x5A));
+    ASSERT_EQ(STATUS_OK, open(script));
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, binaryRecordFillingAlaBuffer) {
+    std::vector<UINT8> script = binaryHeader(SCRIPT_FRAMING_ALA);
+    appendRecord(&script, std::vector<UINT8>(kAlaBufSize, 0x5A));
+    ASSERT_EQ(STATUS_OK, open(script));
+    EXPECT_EQ(kAlaBufSize, next(SCRIPT_FRAMING_ALA));
+}
+
+TEST_F(ScriptReaderTest, shortMagicIsText) {
+    // Too short to hold a header, so it is read as (malformed) text.
+    ASSERT_EQ(STATUS_OK, open(bytes("NXSC")));
+    EXPECT_FALSE(reader_.binary);
+    EXPECT_EQ(-1, next(SCRIPT_FRAMING_ALA));
+}
+
+/* Files */
+
+TEST(ScriptReaderFileTest, missingFile) {
+    Script_Reader_t reader;
+    EXPECT_EQ(STATUS_FILE_NOT_FOUND,
+              ScriptReader_Open(&reader, "/nonexistent/jcop_script_reader_test"));
+}
+
+TEST(ScriptReaderFileTest, readsAMappedFile) {
+    std::string path = std::string(kTmpDir) + "/jcop_script_testXXXXXX";
+    int fd = mkstemp(&path[0]);
+    ASSERT_GE(fd, 0);
+    const std::string text = "40 02 AB CD\r\n41 01 EF\r\n";
+    ASSERT_EQ((ssize_t)text.size(), write(fd, text.data(), text.size()));
+    close(fd);
+
+    Script_Reader_t reader;
+    ASSERT_EQ(STATUS_OK, ScriptReader_Open(&reader, path.c_str()));
+    unlink(path.c_str());
+    EXPECT_EQ(text.size(), ScriptReader_Size(&reader));
+    UINT8 buf[kAlaBufSize];
+    EXPECT_EQ(4, ScriptReader_Next(&reader, SCRIPT_FRAMING_ALA, buf, sizeof(buf)));
+    EXPECT_EQ(3, ScriptReader_Next(&reader, SCRIPT_FRAMING_ALA, buf, sizeof(buf)));
+    EXPECT_EQ(0, ScriptReader_Next(&reader, SCRIPT_FRAMING_ALA, buf, sizeof(buf)));
+    ScriptReader_Close(&reader);
+}
+
+}  // namespace
@@ -0,0 +1,98 @@
+ /*
+  * Copyright (C) 2017 The Android Open Source Project
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *      http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  * Converts an ASCII hex Loader Service or JCOP OS update script to the
+  * binary form read by ScriptReader, so the device maps it instead of
+  * parsing text:
+  *
+  *   jcop_script_convert --ala|--jcop <script.txt> <script.bin>
+  */
+#include <ScriptReader.h>
+#include <stdio.h>
+#include <string.h>
+
+static int usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s --ala|--jcop <script.txt> <script.bin>\n", argv0);
+    return 2;
+}
+
+int main(int argc, char *argv[])
+{
+    Script_Framing framing;
+    Script_Reader_t reader;
+    static UINT8 record[SCRIPT_RECORD_MAX];
+    INT32 len;
+    unsigned long records = 0;
+
+    if(argc != 4)
+        return usage(argv[0]);
+    if(!strcmp(argv[1], "--ala"))
+        framing = SCRIPT_FRAMING_ALA;
+    else if(!strcmp(argv[1], "--jcop"))
+        framing = SCRIPT_FRAMING_APDU;
+    else
+        return usage(argv[0]);
+
+    if(ScriptReader_Open(&reader, argv[2]) != STATUS_OK)
+    {
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[2]);
+        return 1;
+    }
+    if(reader.binary)
+    {
+        fprintf(stderr, "%s: %s is already binary\n", argv[0], argv[2]);
+        ScriptReader_Close(&reader);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[3], "wb");
+    if(out == NULL)
+    {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], argv[3]);
+        ScriptReader_Close(&reader);
+        return 1;
+    }
+    const UINT8 header[SCRIPT_HEADER_SIZE] = {
+        SCRIPT_MAGIC_0, SCRIPT_MAGIC_1, SCRIPT_MAGIC_2, SCRIPT_MAGIC_3,
+        SCRIPT_VERSION, (UINT8)framing, 0x00, 0x00
+    };
+    fwrite(header, 1, sizeof(header), out);
+    while((len = ScriptReader_Next(&reader, framing, record, sizeof(record))) > 0)
+    {
+        const UINT8 prefix[2] = {(UINT8)(len >> 8), (UINT8)len};
+        fwrite(prefix, 1, sizeof(prefix), out);
+        fwrite(record, 1, len, out);
+        records++;
+    }
+    if(len < 0)
+    {
+        fprintf(stderr, "%s: %s: malformed record %lu at offset %zu\n", argv[0], argv[2],
+                records + 1, ScriptReader_Offset(&reader));
+    }
+    ScriptReader_Close(&reader);
+    bool written = !ferror(out);
+    if(fclose(out) != 0)
+        written = false;
+    if(!written || len < 0)
+    {
+        if(!written)
+            fprintf(stderr, "%s: error writing %s\n", argv[0], argv[3]);
+        remove(argv[3]);
+        return 1;
+    }
+    printf("%lu records\n", records);
+    return 0;
+}
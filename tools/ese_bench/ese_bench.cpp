@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * End-to-end ese_transceive() and ese_transceive_sg() benchmarks against the
+ * in-process simulated card in libese-hw-sim. The card echoes each command,
+ * so every run checks its own replies. See README.md for usage.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ese/ese.h>
+#include <ese/hw/sim/sim.h>
+ESE_INCLUDE_HW(ESE_HW_SIM);
+
+namespace {
+
+std::vector<uint8_t> Payload(size_t len) {
+  std::vector<uint8_t> data(len);
+  for (size_t i = 0; i < len; ++i) {
+    data[i] = static_cast<uint8_t>(i * 131 + 7);
+  }
+  return data;
+}
+
+// Splits |buf| into |segs| nearly equal segments.
+std::vector<struct EseSgBuffer> Segments(uint8_t *buf, size_t len, size_t segs) {
+  std::vector<struct EseSgBuffer> sg(segs);
+  size_t offset = 0;
+  for (size_t i = 0; i < segs; ++i) {
+    const size_t end = len * (i + 1) / segs;
+    sg[i].base = buf + offset;
+    sg[i].len = static_cast<uint32_t>(end - offset);
+    offset = end;
+  }
+  return sg;
+}
+
+// Opens the simulated card and records the latency of each exchange.
+class Run {
+ public:
+  Run(benchmark::State &state, const struct EseSimConfig &config)
+      : state_(state), config_(config), ese_(ESE_INITIALIZER(ESE_HW_SIM)) {
+    latencies_.reserve(1 << 16);
+  }
+  ~Run() { ese_close(&ese_); }
+
+  bool Open() {
+    if (ese_open(&ese_, &config_) < 0) {
+      state_.SkipWithError("unable to open the simulated card");
+      return false;
+    }
+    return true;
+  }
+
+  // Times |exchange|, which returns the bytes received or < 0.
+  template <typename Exchange>
+  bool Time(Exchange exchange, int expected) {
+    const auto start = std::chrono::steady_clock::now();
+    const int recvd = exchange(&ese_);
+    latencies_.push_back(std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count());
+    if (recvd == expected && !ese_error(&ese_)) {
+      return true;
+    }
+    // The host gave up on the card; start a new session as a caller would.
+    ++failures_;
+    frames_ += ese_sim_stats(&ese_)->frames_received;
+    ese_close(&ese_);
+    ese_init(&ese_, ESE_HW_SIM);
+    return Open();
+  }
+
+  void Report(size_t bytes_per_apdu) {
+    if (latencies_.empty()) {
+      return;
+    }
+    std::sort(latencies_.begin(), latencies_.end());
+    const auto percentile = [this](double p) {
+      return latencies_[static_cast<size_t>(p * (latencies_.size() - 1))];
+    };
+    const double apdus = static_cast<double>(latencies_.size());
+    state_.counters["p50_us"] = percentile(0.50);
+    state_.counters["p90_us"] = percentile(0.90);
+    state_.counters["p99_us"] = percentile(0.99);
+    state_.counters["max_us"] = latencies_.back();
+    state_.counters["frames_per_apdu"] =
+        (frames_ + ese_sim_stats(&ese_)->frames_received) / apdus;
+    state_.counters["failures"] = failures_;
+    state_.SetBytesProcessed(static_cast<int64_t>(apdus * bytes_per_apdu));
+  }
+
+ private:
+  benchmark::State &state_;
+  struct EseSimConfig config_;
+  struct EseInterface ese_;
+  std::vector<double> latencies_;
+  double frames_ = 0;
+  uint32_t failures_ = 0;
+};
+
+// Echoes a |len| byte APDU with ese_transceive().
+void Transceive(benchmark::State &state, size_t len,
+                const struct EseSimConfig &config) {
+  const std::vector<uint8_t> tx = Payload(len);
+  std::vector<uint8_t> rx(len + 2);
+  Run run(state, config);
+  if (!run.Open()) {
+    return;
+  }
+  const auto exchange = [&](struct EseInterface *ese) {
+    return ese_transceive(ese, tx.data(), static_cast<uint32_t>(tx.size()),
+                          rx.data(), static_cast<uint32_t>(rx.size()));
+  };
+  if (!run.Time(exchange, static_cast<int>(rx.size())) ||
+      memcmp(rx.data(), tx.data(), len) != 0) {
+    state.SkipWithError("echo mismatch");
+    return;
+  }
+  for (auto _ : state) {
+    if (!run.Time(exchange, static_cast<int>(rx.size()))) {
+      return;
+    }
+  }
+  run.Report(tx.size() + rx.size());
+}
+
+// Sizes: case 1, short maximum (4 + 1 + 255), chained, and extended up to
+// the 64 KiB maximum (7 + 65535).
+void BM_Transceive(benchmark::State &state) {
+  Transceive(state, state.range(0), EseSimConfig());
+}
+BENCHMARK(BM_Transceive)
+    ->Arg(4)->Arg(64)->Arg(260)->Arg(1024)->Arg(4096)->Arg(16384)
+    ->Arg(65542);
+
+// Splits both directions into range(1) segments.
+void BM_TransceiveSg(benchmark::State &state) {
+  const size_t len = state.range(0);
+  const size_t segs = state.range(1);
+  std::vector<uint8_t> tx = Payload(len);
+  std::vector<uint8_t> rx(len + 2);
+  const std::vector<struct EseSgBuffer> tx_sg = Segments(tx.data(), tx.size(), segs);
+  std::vector<struct EseSgBuffer> rx_sg = Segments(rx.data(), rx.size(), segs);
+  Run run(state, EseSimConfig());
+  if (!run.Open()) {
+    return;
+  }
+  const auto exchange = [&](struct EseInterface *ese) {
+    return ese_transceive_sg(ese, tx_sg.data(), static_cast<uint32_t>(segs),
+                             rx_sg.data(), static_cast<uint32_t>(segs));
+  };
+  if (!run.Time(exchange, static_cast<int>(rx.size())) ||
+      memcmp(rx.data(), tx.data(), len) != 0) {
+    state.SkipWithError("echo mismatch");
+    return;
+  }
+  for (auto _ : state) {
+    if (!run.Time(exchange, static_cast<int>(rx.size()))) {
+      return;
+    }
+  }
+  run.Report(tx.size() + rx.size());
+}
+BENCHMARK(BM_TransceiveSg)
+    ->Args({260, 1})->Args({260, 4})->Args({260, 16})
+    ->Args({4096, 1})->Args({4096, 4})->Args({4096, 16});
+
+// The card asks for range(0) waiting time extensions before each reply.
+void BM_TransceiveWtx(benchmark::State &state) {
+  struct EseSimConfig config = {};
+  config.wtx_count = static_cast<uint32_t>(state.range(0));
+  Transceive(state, 64, config);
+}
+BENCHMARK(BM_TransceiveWtx)->Arg(0)->Arg(1)->Arg(4);
+
+// range(1) frames per million from the card arrive with a bad LRC.
+void BM_TransceiveErrors(benchmark::State &state) {
+  struct EseSimConfig config = {};
+  config.lrc_error_ppm = static_cast<uint32_t>(state.range(1));
+  config.seed = 1;
+  Transceive(state, state.range(0), config);
+}
+BENCHMARK(BM_TransceiveErrors)
+    ->Args({64, 0})->Args({64, 10000})->Args({64, 100000})
+    ->Args({4096, 0})->Args({4096, 10000})->Args({4096, 100000});
+
+// range(1) frames per million from the host reach the card with a parity
+// error.
+void BM_TransceiveParityErrors(benchmark::State &state) {
+  struct EseSimConfig config = {};
+  config.parity_error_ppm = static_cast<uint32_t>(state.range(1));
+  config.seed = 1;
+  Transceive(state, state.range(0), config);
+}
+BENCHMARK(BM_TransceiveParityErrors)
+    ->Args({64, 10000})->Args({4096, 10000});
+
+// range(1) frames per million are lost, each costing the host a 1 ms BWT.
+void BM_TransceiveDrops(benchmark::State &state) {
+  struct EseSimConfig config = {};
+  config.drop_ppm = static_cast<uint32_t>(state.range(1));
+  config.bwt_us = 1000;
+  config.seed = 1;
+  Transceive(state, state.range(0), config);
+}
+BENCHMARK(BM_TransceiveDrops)
+    ->Args({64, 1000})->Args({64, 10000})->Args({4096, 10000})
+    ->UseRealTime();
+
+// A 1 MHz SPI bus (8 us a byte) and range(1) us of card processing per APDU.
+void BM_TransceiveBus(benchmark::State &state) {
+  struct EseSimConfig config = {};
+  config.byte_time_ns = 8000;
+  config.think_time_us = static_cast<uint32_t>(state.range(1));
+  Transceive(state, state.range(0), config);
+}
+BENCHMARK(BM_TransceiveBus)
+    ->Args({64, 0})->Args({64, 1000})->Args({260, 0})->Args({4096, 0})
+    ->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();